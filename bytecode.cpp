@@ -0,0 +1,180 @@
+#include "include/bytecode.h"
+
+const char *Bytecode::type_name(const Type &type) {
+    switch (type) {
+        case Type::kMove: return "mov";
+        case Type::kMoveInteger: return "movi";
+        case Type::kMoveReal: return "movr";
+        case Type::kIntegerToReal: return "i2r";
+        case Type::kCheck: return "check";
+        case Type::kVarInteger: return "vari";
+        case Type::kVarReal: return "varr";
+        case Type::kVarIntegerArray: return "varia";
+        case Type::kVarRealArray: return "varra";
+        case Type::kLoadIntegerArray: return "ldia";
+        case Type::kLoadRealArray: return "ldra";
+        case Type::kStoreIntegerArray: return "stia";
+        case Type::kStoreRealArray: return "stra";
+        case Type::kAddInteger: return "addi";
+        case Type::kAddReal: return "addr";
+        case Type::kSubInteger: return "subi";
+        case Type::kSubReal: return "subr";
+        case Type::kMulInteger: return "muli";
+        case Type::kMulReal: return "mulr";
+        case Type::kDivInteger: return "divi";
+        case Type::kDivReal: return "divr";
+        case Type::kCompareEqualInteger: return "cmpeqi";
+        case Type::kCompareEqualReal: return "cmpeqr";
+        case Type::kCompareNotEqualInteger: return "cmpnei";
+        case Type::kCompareNotEqualReal: return "cmpner";
+        case Type::kCompareGreaterThanInteger: return "cmpgti";
+        case Type::kCompareGreaterThanReal: return "cmpgtr";
+        case Type::kCompareLessThanInteger: return "cmplti";
+        case Type::kCompareLessThanReal: return "cmpltr";
+        case Type::kCompareGreaterEqualInteger: return "cmpgei";
+        case Type::kCompareGreaterEqualReal: return "cmpger";
+        case Type::kCompareLessEqualInteger: return "cmplei";
+        case Type::kCompareLessEqualReal: return "cmpler";
+        case Type::kJump: return "jmp";
+        case Type::kJumpZero: return "jz";
+        case Type::kJumpNotZero: return "jnz";
+        case Type::kJumpZeroEqualInteger: return "jzeqi";
+        case Type::kJumpZeroEqualReal: return "jzeqr";
+        case Type::kJumpZeroNotEqualInteger: return "jznei";
+        case Type::kJumpZeroNotEqualReal: return "jzner";
+        case Type::kJumpZeroGreaterThanInteger: return "jzgti";
+        case Type::kJumpZeroGreaterThanReal: return "jzgtr";
+        case Type::kJumpZeroLessThanInteger: return "jzlti";
+        case Type::kJumpZeroLessThanReal: return "jzltr";
+        case Type::kJumpZeroGreaterEqualInteger: return "jzgei";
+        case Type::kJumpZeroGreaterEqualReal: return "jzger";
+        case Type::kJumpZeroLessEqualInteger: return "jzlei";
+        case Type::kJumpZeroLessEqualReal: return "jzler";
+        case Type::kCall: return "call";
+        case Type::kReturn: return "ret";
+        case Type::kPrint: return "print";
+        case Type::kReadInt: return "readi";
+        case Type::kReadReal: return "readr";
+        case Type::kReadIntArray: return "readia";
+        case Type::kReadRealArray: return "readra";
+        case Type::kHalt: return "halt";
+    }
+    return "none";
+}
+
+// 寄存器显示为 r0, 全局变量显示为 g0, 常量直接显示其值
+void BytecodeProgram::print_operand(std::ostream &os, const int &operand) const {
+    if (is_local_operand(operand)) {
+        os << "r" << operand;
+    } else if (!is_constant_operand(operand)) {
+        os << "g" << ~operand;
+    } else {
+        const Value &value = constants_[~operand - global_size_];
+        if (value.type() == Value::Type::kReal) {
+            os << value.real_value();
+        } else {
+            os << value.int_value();
+        }
+    }
+}
+
+void BytecodeProgram::print_code(std::ostream &os, const int &pc) const {
+    const Bytecode &code = code_[pc];
+    os << Bytecode::type_name(code.type());
+    switch (code.type()) {
+        case Bytecode::Type::kMove:
+        case Bytecode::Type::kMoveInteger:
+        case Bytecode::Type::kMoveReal:
+        case Bytecode::Type::kIntegerToReal:
+        case Bytecode::Type::kVarIntegerArray:
+        case Bytecode::Type::kVarRealArray:
+        case Bytecode::Type::kReadIntArray:
+        case Bytecode::Type::kReadRealArray:
+            os << " ";
+            print_operand(os, code.a());
+            os << ", ";
+            print_operand(os, code.b());
+            break;
+        case Bytecode::Type::kCheck:
+            os << " ";
+            print_operand(os, code.a());
+            os << ", " << name(code.b());
+            break;
+        case Bytecode::Type::kVarInteger:
+        case Bytecode::Type::kVarReal:
+        case Bytecode::Type::kReturn:
+        case Bytecode::Type::kPrint:
+        case Bytecode::Type::kReadInt:
+        case Bytecode::Type::kReadReal:
+            os << " ";
+            print_operand(os, code.a());
+            break;
+        case Bytecode::Type::kJump:
+            os << " " << code.a();
+            break;
+        case Bytecode::Type::kJumpZero:
+        case Bytecode::Type::kJumpNotZero:
+            os << " ";
+            print_operand(os, code.a());
+            os << ", " << code.b();
+            break;
+        case Bytecode::Type::kJumpZeroEqualInteger:
+        case Bytecode::Type::kJumpZeroEqualReal:
+        case Bytecode::Type::kJumpZeroNotEqualInteger:
+        case Bytecode::Type::kJumpZeroNotEqualReal:
+        case Bytecode::Type::kJumpZeroGreaterThanInteger:
+        case Bytecode::Type::kJumpZeroGreaterThanReal:
+        case Bytecode::Type::kJumpZeroLessThanInteger:
+        case Bytecode::Type::kJumpZeroLessThanReal:
+        case Bytecode::Type::kJumpZeroGreaterEqualInteger:
+        case Bytecode::Type::kJumpZeroGreaterEqualReal:
+        case Bytecode::Type::kJumpZeroLessEqualInteger:
+        case Bytecode::Type::kJumpZeroLessEqualReal:
+            os << " ";
+            print_operand(os, code.a());
+            os << ", ";
+            print_operand(os, code.b());
+            os << ", " << code.c();
+            break;
+        case Bytecode::Type::kCall: {
+            const BytecodeFunction &callee = functions_[code.b()];
+            os << " ";
+            print_operand(os, code.a());
+            os << ", $" << callee.name() << "(";
+            for (int i = 0; i < (int)callee.parameters().size(); ++i) {
+                if (i > 0) {
+                    os << ", ";
+                }
+                print_operand(os, arguments_[code.c() + i]);
+            }
+            os << ")";
+            break;
+        }
+        case Bytecode::Type::kHalt:
+            break;
+        default:
+            os << " ";
+            print_operand(os, code.a());
+            os << ", ";
+            print_operand(os, code.b());
+            os << ", ";
+            print_operand(os, code.c());
+            break;
+    }
+}
+
+std::ostream &operator << (std::ostream &os, const BytecodeProgram &program) {
+    int function = 0;
+    for (int pc = 0; pc < program.size(); ++pc) {
+        while (function < (int)program.functions_.size() && program.functions_[function].entry() == pc) {
+            const BytecodeFunction &current = program.functions_[function];
+            os << "FUNC @" << current.name() << ": (寄存器 " << current.registers() << ")" << std::endl;
+            ++function;
+        }
+
+        os << pc << ":\t\t|     ";
+        program.print_code(os, pc);
+        os << std::endl;
+    }
+    return os;
+}
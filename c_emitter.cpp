@@ -0,0 +1,880 @@
+#include <iomanip>
+#include <algorithm>
+#include "include/c_emitter.h"
+
+void CEmitter::emit(std::ostream &os) {
+    // 与栈式虚拟机一致, 全局语句执行完毕后调用主函数
+    ir_.add(PCode(PCode::Type::kCall, "main"));
+
+    Linker linker(ir_);
+    linker.link();
+    ir_ = linker.ir();
+    constants_ = linker.constants();
+    functions_ = linker.functions();
+    global_types_.assign((unsigned long)linker.global_size(), Value::Type::kNone);
+    top_types_.assign((unsigned long)linker.global_size(), Value::Type::kNone);
+
+    emit_prelude(os);
+    emit_globals(os);
+    emit_prototypes(os);
+    for (int i = 0; i < (int)functions_.size(); ++i) {
+        emit_function(os, i);
+    }
+    emit_entry(os);
+}
+
+void CEmitter::emit_prelude(std::ostream &os) const {
+    os << "/* 由 cmm 生成, 编译: cc -O2 -o program program.c -lm */\n"
+          "#include <stdio.h>\n"
+          "#include <stdlib.h>\n"
+          "#include <string.h>\n"
+          "#include <math.h>\n"
+          "#include <ctype.h>\n"
+          "#include <errno.h>\n"
+          "\n"
+          "#if defined(__GNUC__)\n"
+          "#define CMM_NORETURN __attribute__((noreturn))\n"
+          "#define CMM_UNLIKELY(x) __builtin_expect(!!(x), 0)\n"
+          "#define CMM_UNUSED __attribute__((unused))\n"
+          "#else\n"
+          "#define CMM_NORETURN\n"
+          "#define CMM_UNLIKELY(x) (x)\n"
+          "#define CMM_UNUSED\n"
+          "#endif\n"
+          "\n"
+          "static inline CMM_NORETURN void cmm_fail(int line, const char *message) {\n"
+          "    printf(\"[中间代码错误] 第 %d 行: %s\\n\", line, message);\n"
+          "    exit(1);\n"
+          "}\n"
+          "\n"
+          "static inline int cmm_index(int index, int size, int line) {\n"
+          "    if (CMM_UNLIKELY((unsigned)index >= (unsigned)size)) {\n"
+          "        cmm_fail(line, \"数组下标越界\");\n"
+          "    }\n"
+          "    return index;\n"
+          "}\n"
+          "\n"
+          "static inline int cmm_div_int(int left, int right, int line) {\n"
+          "    if (CMM_UNLIKELY(right == 0)) {\n"
+          "        cmm_fail(line, \"除数不能为 0\");\n"
+          "    }\n"
+          "    return right == -1 ? (int)(0u - (unsigned)left) : left / right;\n"
+          "}\n"
+          "\n"
+          "static inline double cmm_div_real(double left, double right, int line) {\n"
+          "    if (CMM_UNLIKELY(fabs(right) < 1e-8)) {\n"
+          "        cmm_fail(line, \"除数不能为 0\");\n"
+          "    }\n"
+          "    return left / right;\n"
+          "}\n"
+          "\n"
+          "static inline void *cmm_alloc(void *array, int size, size_t element, int line) {\n"
+          "    if (size < 0) {\n"
+          "        cmm_fail(line, \"数组大小不合法\");\n"
+          "    }\n"
+          "    array = realloc(array, (size > 0 ? (size_t)size : 1) * element);\n"
+          "    if (array == NULL) {\n"
+          "        cmm_fail(line, \"内存不足\");\n"
+          "    }\n"
+          "    memset(array, 0, (size_t)size * element);\n"
+          "    return array;\n"
+          "}\n"
+          "\n"
+          "/* 与虚拟机一致: 输入按空白分隔为记号, 记号不合法时报告其字节偏移, 输入结束后的读取得到 0 */\n"
+          "static long cmm_input_offset = 0;\n"
+          "static long cmm_token_offset = 0;\n"
+          "static char *cmm_token = NULL;\n"
+          "static size_t cmm_token_capacity = 0;\n"
+          "\n"
+          "static inline int cmm_next_token(void) {\n"
+          "    size_t size = 0;\n"
+          "    int c = getchar();\n"
+          "    while (c != EOF && isspace(c)) {\n"
+          "        ++cmm_input_offset;\n"
+          "        c = getchar();\n"
+          "    }\n"
+          "    if (c == EOF) {\n"
+          "        return 0;\n"
+          "    }\n"
+          "    cmm_token_offset = cmm_input_offset;\n"
+          "    for (; c != EOF && !isspace(c); c = getchar()) {\n"
+          "        if (size + 1 >= cmm_token_capacity) {\n"
+          "            cmm_token_capacity = cmm_token_capacity > 0 ? cmm_token_capacity * 2 : 64;\n"
+          "            cmm_token = (char *)realloc(cmm_token, cmm_token_capacity);\n"
+          "            if (cmm_token == NULL) {\n"
+          "                cmm_fail(0, \"内存不足\");\n"
+          "            }\n"
+          "        }\n"
+          "        cmm_token[size++] = (char)c;\n"
+          "        ++cmm_input_offset;\n"
+          "    }\n"
+          "    if (c != EOF) {\n"
+          "        ungetc(c, stdin);\n"
+          "    }\n"
+          "    cmm_token[size] = '\\0';\n"
+          "    return 1;\n"
+          "}\n"
+          "\n"
+          "static inline CMM_NORETURN void cmm_input_fail(int line, const char *reason) {\n"
+          "    char message[160];\n"
+          "    snprintf(message, sizeof(message), \"输入中偏移 %ld 字节处的 \\\"%.32s%s\\\" %s\", cmm_token_offset, cmm_token,\n"
+          "             strlen(cmm_token) > 32 ? \"...\" : \"\", reason);\n"
+          "    cmm_fail(line, message);\n"
+          "}\n"
+          "\n"
+          "static inline int cmm_read_int(int line) {\n"
+          "    const char *p;\n"
+          "    long long value = 0;\n"
+          "    int is_negative;\n"
+          "    if (!cmm_next_token()) {\n"
+          "        return 0;\n"
+          "    }\n"
+          "    p = cmm_token;\n"
+          "    is_negative = *p == '-';\n"
+          "    if (*p == '+' || *p == '-') {\n"
+          "        ++p;\n"
+          "    }\n"
+          "    if (*p == '\\0') {\n"
+          "        cmm_input_fail(line, \"不是合法的整数\");\n"
+          "    }\n"
+          "    for (; *p != '\\0'; ++p) {\n"
+          "        if (*p < '0' || *p > '9') {\n"
+          "            cmm_input_fail(line, \"不是合法的整数\");\n"
+          "        }\n"
+          "        value = value * 10 + (*p - '0');\n"
+          "        if (value > 2147483648LL) {\n"
+          "            cmm_input_fail(line, \"超出整数的范围\");\n"
+          "        }\n"
+          "    }\n"
+          "    if (!is_negative && value > 2147483647LL) {\n"
+          "        cmm_input_fail(line, \"超出整数的范围\");\n"
+          "    }\n"
+          "    return (int)(is_negative ? -value : value);\n"
+          "}\n"
+          "\n"
+          "/* 与虚拟机一致: 依次尝试 15, 16, 17 位有效数字, 取最短的能还原为原值的表示 */\n"
+          "static inline void cmm_print_real(double value) {\n"
+          "    char buffer[32];\n"
+          "    int precision;\n"
+          "    for (precision = 15; precision < 17; ++precision) {\n"
+          "        snprintf(buffer, sizeof(buffer), \"%.*g\", precision, value);\n"
+          "        if (strtod(buffer, NULL) == value) {\n"
+          "            break;\n"
+          "        }\n"
+          "    }\n"
+          "    printf(\"%.*g\\n\", precision, value);\n"
+          "}\n"
+          "\n"
+          "static inline double cmm_read_real(int line) {\n"
+          "    const char *p;\n"
+          "    int has_digit = 0;\n"
+          "    double value;\n"
+          "    if (!cmm_next_token()) {\n"
+          "        return 0.0;\n"
+          "    }\n"
+          "    p = cmm_token;\n"
+          "    if (*p == '+' || *p == '-') {\n"
+          "        ++p;\n"
+          "    }\n"
+          "    for (; *p >= '0' && *p <= '9'; ++p) {\n"
+          "        has_digit = 1;\n"
+          "    }\n"
+          "    if (*p == '.') {\n"
+          "        for (++p; *p >= '0' && *p <= '9'; ++p) {\n"
+          "            has_digit = 1;\n"
+          "        }\n"
+          "    }\n"
+          "    if (!has_digit) {\n"
+          "        cmm_input_fail(line, \"不是合法的实数\");\n"
+          "    }\n"
+          "    if (*p == 'e' || *p == 'E') {\n"
+          "        ++p;\n"
+          "        if (*p == '+' || *p == '-') {\n"
+          "            ++p;\n"
+          "        }\n"
+          "        if (*p < '0' || *p > '9') {\n"
+          "            cmm_input_fail(line, \"不是合法的实数\");\n"
+          "        }\n"
+          "        while (*p >= '0' && *p <= '9') {\n"
+          "            ++p;\n"
+          "        }\n"
+          "    }\n"
+          "    if (*p != '\\0') {\n"
+          "        cmm_input_fail(line, \"不是合法的实数\");\n"
+          "    }\n"
+          "    errno = 0;\n"
+          "    value = strtod(cmm_token, NULL);\n"
+          "    if (errno == ERANGE && (value > 1.0 || value < -1.0)) {\n"
+          "        cmm_input_fail(line, \"超出实数的范围\");\n"
+          "    }\n"
+          "    return value;\n"
+          "}\n"
+          "\n";
+}
+
+void CEmitter::emit_globals(std::ostream &os) {
+    // 函数中按全局变量最后一次定义的类型访问
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        const PCode &code = ir_.at(pos);
+        if (code.type() == PCode::Type::kStartFunc) {
+            pos = code.target();
+            continue;
+        }
+        if (code.first_address().frame() != Address::Frame::kGlobal) {
+            continue;
+        }
+        switch (code.type()) {
+            case PCode::Type::kVarInteger:
+                global_types_[code.first_address().slot()] = Value::Type::kInt;
+                global_scalars_.insert(name(code.first_address(), Value::Type::kInt));
+                break;
+            case PCode::Type::kVarReal:
+                global_types_[code.first_address().slot()] = Value::Type::kReal;
+                global_scalars_.insert(name(code.first_address(), Value::Type::kReal));
+                break;
+            case PCode::Type::kVarIntegerArray:
+                global_types_[code.first_address().slot()] = Value::Type::kIntArray;
+                break;
+            case PCode::Type::kVarRealArray:
+                global_types_[code.first_address().slot()] = Value::Type::kRealArray;
+                break;
+            default:
+                break;
+        }
+    }
+    in_function_ = false;
+    collect(0, ir_.size() - 1);
+
+    for (const std::string &scalar : global_scalars_) {
+        if (scalar.back() == 'i') {
+            os << "static int " << scalar << ";\n";
+            os << "static char " << scalar << "_set;\n";
+        } else {
+            os << "static double " << scalar << ";\n";
+        }
+    }
+    for (const std::pair<const std::string, ArrayInfo> &array : global_arrays_) {
+        const char *element = is_integer_array(array.first) ? "int" : "double";
+        if (array.second.is_dynamic) {
+            os << "static " << element << " *" << array.first << ";\n";
+        } else {
+            os << "static " << element << " " << array.first << "[" << std::max(array.second.capacity, 1) << "];\n";
+        }
+        os << "static int " << array.first << "_n;\n";
+    }
+    os << "\n";
+}
+
+// 源程序中可能定义了从未调用的函数, 原型标记为 CMM_UNUSED
+void CEmitter::emit_prototypes(std::ostream &os) const {
+    for (int i = 0; i < (int)functions_.size(); ++i) {
+        os << "static CMM_UNUSED " << type_name(return_type(i)) << " " << function_name(functions_[i].name()) << "(";
+        std::vector<std::pair<int, Value::Type> > parameters = this->parameters(i);
+        for (int j = 0; j < (int)parameters.size(); ++j) {
+            os << (j > 0 ? ", " : "") << type_name(parameters[j].second) << " " << name(Address(Address::Frame::kLocal, parameters[j].first), parameters[j].second);
+        }
+        os << (parameters.empty() ? "void" : "") << ");\n";
+    }
+    os << "\n";
+}
+
+void CEmitter::emit_function(std::ostream &os, const int &index) {
+    const LinkedFunction &function = functions_[index];
+    in_function_ = true;
+    local_types_.assign((unsigned long)function.frame_size(), Value::Type::kNone);
+    stack_.clear();
+    temps_.clear();
+    scalars_.clear();
+    parameters_.clear();
+    arrays_.clear();
+    targets_.clear();
+    current_return_type_ = return_type(index);
+    collect(function.start() + 1, function.end());
+
+    std::vector<std::pair<int, Value::Type> > parameters = this->parameters(index);
+    for (const std::pair<int, Value::Type> &parameter : parameters) {
+        parameters_.insert(name(Address(Address::Frame::kLocal, parameter.first), parameter.second));
+    }
+
+    // 先翻译函数体, 以便收集需要声明的变量
+    std::ostringstream body;
+    emit_body(body, function.start() + 1, function.end());
+
+    os << "static " << type_name(return_type(index)) << " " << function_name(function.name()) << "(";
+    for (int j = 0; j < (int)parameters.size(); ++j) {
+        os << (j > 0 ? ", " : "") << type_name(parameters[j].second) << " " << name(Address(Address::Frame::kLocal, parameters[j].first), parameters[j].second);
+    }
+    os << (parameters.empty() ? "void" : "") << ") {\n";
+    emit_declarations(os);
+    os << body.str();
+    os << "}\n\n";
+}
+
+void CEmitter::emit_entry(std::ostream &os) {
+    in_function_ = false;
+    local_types_.clear();
+    stack_.clear();
+    temps_.clear();
+    scalars_.clear();
+    parameters_.clear();
+    arrays_.clear();
+    targets_.clear();
+    collect(0, ir_.size() - 1);
+
+    std::ostringstream body;
+    emit_body(body, 0, ir_.size() - 1);
+
+    os << "int main(void) {\n";
+    emit_declarations(os);
+    os << "    static char output[1 << 16];\n";
+    os << "    setvbuf(stdout, output, _IOFBF, sizeof(output));\n";
+    os << body.str();
+    os << "    return 0;\n";
+    os << "}\n";
+}
+
+// 变量在函数开头声明并初始化, 翻译后的代码中 goto 不会越过任何初始化
+// 源程序中只赋值不读取的变量与被丢弃的返回值在 C 中同样只写不读, 标记为 CMM_UNUSED 以免编译器警告
+void CEmitter::emit_declarations(std::ostream &os) {
+    for (const std::string &temp : temps_) {
+        os << "    CMM_UNUSED " << (temp.back() == 'i' ? "int " : "double ") << temp << (temp.back() == 'i' ? " = 0;\n" : " = 0.0;\n");
+    }
+    for (const std::string &scalar : scalars_) {
+        if (scalar.back() == 'i') {
+            os << "    CMM_UNUSED int " << scalar << " = 0;\n";
+        } else {
+            os << "    CMM_UNUSED double " << scalar << " = 0.0;\n";
+        }
+    }
+    for (const std::string &scalar : scalars_) {
+        if (scalar.back() == 'i') {
+            os << "    CMM_UNUSED char " << scalar << "_set = " << (parameters_.count(scalar) ? 1 : 0) << ";\n";
+        }
+    }
+    for (const std::string &parameter : parameters_) {
+        if (parameter.back() == 'i' && !scalars_.count(parameter)) {
+            os << "    CMM_UNUSED char " << parameter << "_set = 1;\n";
+        }
+    }
+    for (const std::pair<const std::string, ArrayInfo> &array : arrays_) {
+        const char *element = is_integer_array(array.first) ? "int" : "double";
+        if (array.second.is_dynamic) {
+            os << "    " << element << " *" << array.first << " = NULL;\n";
+        } else {
+            os << "    " << element << " " << array.first << "[" << std::max(array.second.capacity, 1) << "];\n";
+        }
+        os << "    CMM_UNUSED int " << array.first << "_n = 0;\n";
+    }
+}
+
+void CEmitter::emit_body(std::ostream &os, const int &begin, const int &end) {
+    for (int pos = begin; pos <= end; ++pos) {
+        const PCode &code = ir_.at(pos);
+        if (code.type() == PCode::Type::kStartFunc) {
+            pos = code.target();
+            continue;
+        }
+        if (targets_.count(pos)) {
+            os << "L" << pos << ":;\n";
+        }
+        emit_instruction(os, pos);
+    }
+}
+
+void CEmitter::emit_instruction(std::ostream &os, const int &pos) {
+    const PCode &code = ir_.at(pos);
+
+    switch (code.type()) {
+        case PCode::Type::kNone:
+        case PCode::Type::kStartFunc:
+        case PCode::Type::kLabel:
+        case PCode::Type::kEnterScope:
+        case PCode::Type::kLeaveScope:
+        case PCode::Type::kExit:
+        case PCode::Type::kAnd:
+        case PCode::Type::kOr:
+        case PCode::Type::kNot:
+        case PCode::Type::kNegative:
+            break;
+        case PCode::Type::kArgInteger:
+        case PCode::Type::kArgIntegerArray:
+            // 形参由调用者传入
+            declare(code.first_address(), Value::Type::kInt);
+            break;
+        case PCode::Type::kArgReal:
+        case PCode::Type::kArgRealArray:
+            declare(code.first_address(), Value::Type::kReal);
+            break;
+        case PCode::Type::kVarInteger: {
+            declare(code.first_address(), Value::Type::kInt);
+            std::string target = variable(code.first_address());
+            os << "    " << target << " = 0;\n";
+            os << "    " << target << "_set = 0;\n";
+            break;
+        }
+        case PCode::Type::kVarReal:
+            declare(code.first_address(), Value::Type::kReal);
+            os << "    " << variable(code.first_address()) << " = 0.0;\n";
+            break;
+        case PCode::Type::kVarIntegerArray:
+        case PCode::Type::kVarRealArray: {
+            bool is_integer = code.type() == PCode::Type::kVarIntegerArray;
+            declare(code.first_address(), is_integer ? Value::Type::kIntArray : Value::Type::kRealArray);
+            std::string target = variable(code.first_address());
+            const ArrayInfo &info = array_info(target);
+            std::string size = integer_operand(code.second_address());
+            const char *element = is_integer ? "int" : "double";
+            if (info.is_dynamic) {
+                os << "    " << target << "_n = " << size << ";\n";
+                os << "    " << target << " = (" << element << " *)cmm_alloc(" << target << ", " << target << "_n, sizeof(" << element << "), " << pos << ");\n";
+            } else {
+                os << "    " << target << "_n = " << size << ";\n";
+                os << "    memset(" << target << ", 0, sizeof(" << element << ") * " << size << ");\n";
+            }
+            break;
+        }
+        case PCode::Type::kPushInteger:
+        case PCode::Type::kPushReal: {
+            Value::Type type = code.type() == PCode::Type::kPushInteger ? Value::Type::kInt : Value::Type::kReal;
+            int depth = (int)stack_.size();
+            if (code.first_address().frame() == Address::Frame::kConstant) {
+                os << "    " << temp(depth, type) << " = " << literal(constants_[code.first_address().slot()]) << ";\n";
+            } else {
+                Value::Type declared = scalar_type(declared_type(code.first_address()));
+                std::string source = variable(code.first_address());
+                if (declared == Value::Type::kInt) {
+                    os << "    if (CMM_UNLIKELY(!" << source << "_set)) {\n";
+                    os << "        cmm_fail(" << pos << ", " << quote("变量 \"" + code.first() + "\" 未初始化而直接使用") << ");\n";
+                    os << "    }\n";
+                }
+                os << "    " << temp(depth, type) << " = " << convert(source, declared, type) << ";\n";
+            }
+            push(type);
+            break;
+        }
+        case PCode::Type::kPushIntegerArray:
+        case PCode::Type::kPushRealArray: {
+            Value::Type type = code.type() == PCode::Type::kPushIntegerArray ? Value::Type::kInt : Value::Type::kReal;
+            Value::Type declared = element_type(declared_type(code.first_address()));
+            int depth = (int)stack_.size();
+            os << "    " << temp(depth, type) << " = " << convert(element(code, pos), declared, type) << ";\n";
+            push(type);
+            break;
+        }
+        case PCode::Type::kPop:
+            pop(pos);
+            break;
+        case PCode::Type::kPopInteger:
+        case PCode::Type::kPopReal: {
+            Value::Type type = pop(pos);
+            Value::Type declared = scalar_type(declared_type(code.first_address()));
+            std::string target = variable(code.first_address());
+            os << "    " << target << " = " << convert(temp((int)stack_.size(), type), type, declared) << ";\n";
+            if (declared == Value::Type::kInt) {
+                os << "    " << target << "_set = 1;\n";
+            }
+            break;
+        }
+        case PCode::Type::kPopIntegerArray:
+        case PCode::Type::kPopRealArray: {
+            Value::Type type = pop(pos);
+            Value::Type declared = element_type(declared_type(code.first_address()));
+            os << "    " << element(code, pos) << " = " << convert(temp((int)stack_.size(), type), type, declared) << ";\n";
+            break;
+        }
+        case PCode::Type::kCompareEqualInteger:
+        case PCode::Type::kCompareEqualReal:
+            emit_compare(os, pos, "==");
+            break;
+        case PCode::Type::kCompareNotEqualInteger:
+        case PCode::Type::kCompareNotEqualReal:
+            emit_compare(os, pos, "!=");
+            break;
+        case PCode::Type::kCompareGreaterThanInteger:
+        case PCode::Type::kCompareGreaterThanReal:
+            emit_compare(os, pos, ">");
+            break;
+        case PCode::Type::kCompareLessThanInteger:
+        case PCode::Type::kCompareLessThanReal:
+            emit_compare(os, pos, "<");
+            break;
+        case PCode::Type::kCompareGreaterEqualInteger:
+        case PCode::Type::kCompareGreaterEqualReal:
+            emit_compare(os, pos, ">=");
+            break;
+        case PCode::Type::kCompareLessEqualInteger:
+        case PCode::Type::kCompareLessEqualReal:
+            emit_compare(os, pos, "<=");
+            break;
+        case PCode::Type::kAddInteger:
+            emit_typed(os, pos, "+", Value::Type::kInt);
+            break;
+        case PCode::Type::kAddReal:
+            emit_typed(os, pos, "+", Value::Type::kReal);
+            break;
+        case PCode::Type::kSubInteger:
+            emit_typed(os, pos, "-", Value::Type::kInt);
+            break;
+        case PCode::Type::kSubReal:
+            emit_typed(os, pos, "-", Value::Type::kReal);
+            break;
+        case PCode::Type::kMulInteger:
+            emit_typed(os, pos, "*", Value::Type::kInt);
+            break;
+        case PCode::Type::kMulReal:
+            emit_typed(os, pos, "*", Value::Type::kReal);
+            break;
+        case PCode::Type::kDivInteger:
+            emit_typed(os, pos, "/", Value::Type::kInt);
+            break;
+        case PCode::Type::kDivReal:
+            emit_typed(os, pos, "/", Value::Type::kReal);
+            break;
+        case PCode::Type::kIntegerToReal: {
+            Value::Type type = pop(pos);
+            int depth = (int)stack_.size();
+            os << "    " << temp(depth, Value::Type::kReal) << " = " << convert(temp(depth, type), type, Value::Type::kReal) << ";\n";
+            push(Value::Type::kReal);
+            break;
+        }
+        case PCode::Type::kJump:
+            os << "    goto L" << code.target() << ";\n";
+            break;
+        case PCode::Type::kJumpZero:
+        case PCode::Type::kJumpNotZero: {
+            Value::Type type = pop(pos);
+            const char *op = code.type() == PCode::Type::kJumpZero ? " == " : " != ";
+            os << "    if (" << temp((int)stack_.size(), type) << op << (type == Value::Type::kReal ? "0.0" : "0") << ") {\n";
+            os << "        goto L" << code.target() << ";\n";
+            os << "    }\n";
+            break;
+        }
+        case PCode::Type::kPrint: {
+            Value::Type type = pop(pos);
+            if (type == Value::Type::kInt) {
+                os << "    printf(\"%d\\n\", " << temp((int)stack_.size(), type) << ");\n";
+            } else {
+                os << "    cmm_print_real(" << temp((int)stack_.size(), type) << ");\n";
+            }
+            break;
+        }
+        case PCode::Type::kReadInt:
+        case PCode::Type::kReadReal: {
+            Value::Type declared = scalar_type(declared_type(code.first_address()));
+            std::string target = variable(code.first_address());
+            os << "    " << target << " = " << (declared == Value::Type::kInt ? "cmm_read_int(" : "cmm_read_real(") << pos << ")" << ";\n";
+            if (declared == Value::Type::kInt) {
+                os << "    " << target << "_set = 1;\n";
+            }
+            break;
+        }
+        case PCode::Type::kReadIntArray:
+        case PCode::Type::kReadRealArray: {
+            // 与栈式虚拟机一致, 先读入再检查下标
+            Value::Type declared = element_type(declared_type(code.first_address()));
+            os << "    {\n";
+            os << "        " << type_name(declared) << " input = " << (declared == Value::Type::kInt ? "cmm_read_int(" : "cmm_read_real(") << pos << ")" << ";\n";
+            os << "        " << element(code, pos) << " = input;\n";
+            os << "    }\n";
+            break;
+        }
+        // 尾调用由 C 编译器优化, 按普通调用输出, 由其后的 ret 返回
+        case PCode::Type::kCall:
+        case PCode::Type::kTailCall:
+            emit_call(os, pos, code);
+            break;
+        case PCode::Type::kReturn: {
+            Value::Type type = pop(pos);
+            emit_return(os, convert(temp((int)stack_.size(), type), type, current_return_type_));
+            break;
+        }
+        case PCode::Type::kEndFunc:
+            // 函数末尾没有 return 时按返回类型返回 0
+            emit_return(os, code.second() == "real" ? "0.0" : "0");
+            break;
+        // 超级指令只在栈式虚拟机装载时由链接后的中间代码融合得到, 不会出现在输入的中间代码中
+        case PCode::Type::kIncrementInteger:
+        case PCode::Type::kDecrementInteger:
+        case PCode::Type::kMoveInteger:
+        case PCode::Type::kMoveReal:
+        case PCode::Type::kCompareEqualJumpZero:
+        case PCode::Type::kCompareNotEqualJumpZero:
+        case PCode::Type::kCompareGreaterThanJumpZero:
+        case PCode::Type::kCompareLessThanJumpZero:
+        case PCode::Type::kCompareGreaterEqualJumpZero:
+        case PCode::Type::kCompareLessEqualJumpZero:
+            throw simulator_error(pos, "意外的超级指令, C 代码只能由未融合的中间代码生成");
+    }
+}
+
+// 静态类型特化的运算, 整数加减乘按无符号数计算以得到与虚拟机一致的回绕结果
+void CEmitter::emit_typed(std::ostream &os, const int &pos, const std::string &op, const Value::Type &type) {
+    Value::Type right_type = pop(pos);
+    Value::Type left_type = pop(pos);
+    int depth = (int)stack_.size();
+    std::string left = convert(temp(depth, left_type), left_type, type);
+    std::string right = convert(temp(depth + 1, right_type), right_type, type);
+    std::string result = temp(depth, type);
+
+    if (type == Value::Type::kInt) {
+        if (op == "/") {
+            os << "    " << result << " = cmm_div_int(" << left << ", " << right << ", " << pos << ");\n";
+        } else {
+            os << "    " << result << " = (int)((unsigned)" << left << " " << op << " (unsigned)" << right << ");\n";
+        }
+    } else if (op == "/") {
+        os << "    " << result << " = cmm_div_real(" << left << ", " << right << ", " << pos << ");\n";
+    } else {
+        os << "    " << result << " = " << left << " " << op << " " << right << ";\n";
+    }
+    push(type);
+}
+
+// 比较运算: 两个整数直接比较, 否则按实数比较
+void CEmitter::emit_compare(std::ostream &os, const int &pos, const std::string &op) {
+    Value::Type right_type = pop(pos);
+    Value::Type left_type = pop(pos);
+    int depth = (int)stack_.size();
+    Value::Type type = left_type == Value::Type::kInt && right_type == Value::Type::kInt ? Value::Type::kInt : Value::Type::kReal;
+    std::string left = convert(temp(depth, left_type), left_type, type);
+    std::string right = convert(temp(depth + 1, right_type), right_type, type);
+    os << "    " << temp(depth, Value::Type::kInt) << " = " << left << " " << op << " " << right << ";\n";
+    push(Value::Type::kInt);
+}
+
+void CEmitter::emit_call(std::ostream &os, const int &pos, const PCode &code) {
+    int index = code.target();
+    std::vector<std::pair<int, Value::Type> > parameters = this->parameters(index);
+    int base = (int)stack_.size() - (int)parameters.size();
+    if (base < 0) {
+        throw simulator_error(pos, "函数 \"" + code.first() + "\" 的实参数量不足");
+    }
+
+    // 实参按形参类型转换
+    std::string arguments;
+    for (int i = 0; i < (int)parameters.size(); ++i) {
+        Value::Type type = stack_[base + i];
+        arguments += (i > 0 ? ", " : "") + convert(temp(base + i, type), type, parameters[i].second);
+    }
+    stack_.resize((unsigned long)base);
+
+    Value::Type type = return_type(index);
+    os << "    " << temp(base, type) << " = " << function_name(code.first()) << "(" << arguments << ");\n";
+    push(type);
+}
+
+// 返回前释放堆上分配的数组
+void CEmitter::emit_return(std::ostream &os, const std::string &value) {
+    if (!in_function_) {
+        return;
+    }
+    for (const std::pair<const std::string, ArrayInfo> &array : arrays_) {
+        if (array.second.is_dynamic) {
+            os << "    free(" << array.first << ");\n";
+        }
+    }
+    os << "    return " << value << ";\n";
+}
+
+void CEmitter::collect(const int &begin, const int &end) {
+    for (int pos = begin; pos <= end; ++pos) {
+        const PCode &code = ir_.at(pos);
+        if (code.type() == PCode::Type::kStartFunc) {
+            pos = code.target();
+            continue;
+        }
+        switch (code.type()) {
+            case PCode::Type::kJump:
+            case PCode::Type::kJumpZero:
+            case PCode::Type::kJumpNotZero:
+                targets_.insert(code.target());
+                break;
+            case PCode::Type::kVarIntegerArray:
+            case PCode::Type::kVarRealArray: {
+                const Address &address = code.first_address();
+                bool is_global = address.frame() == Address::Frame::kGlobal;
+                std::map<std::string, ArrayInfo> &arrays = is_global ? global_arrays_ : arrays_;
+                Value::Type type = code.type() == PCode::Type::kVarIntegerArray ? Value::Type::kIntArray : Value::Type::kRealArray;
+                std::string array = name(address, type);
+                if (!arrays.count(array)) {
+                    arrays[array] = ArrayInfo{false, 0};
+                }
+
+                // 大小为常量且不超过上限时使用定长数组, 同一数组的多次定义取最大的大小
+                ArrayInfo &info = arrays[array];
+                int limit = is_global ? kMaxStaticArray : kMaxStackArray;
+                if (code.second_address().frame() != Address::Frame::kConstant) {
+                    info.is_dynamic = true;
+                } else {
+                    int size = constants_[code.second_address().slot()].int_value();
+                    if (size > limit) {
+                        info.is_dynamic = true;
+                    }
+                    info.capacity = std::max(info.capacity, size);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+const CEmitter::ArrayInfo &CEmitter::array_info(const std::string &array) const {
+    std::map<std::string, ArrayInfo>::const_iterator it = arrays_.find(array);
+    if (it != arrays_.end()) {
+        return it->second;
+    }
+    return global_arrays_.at(array);
+}
+
+std::vector<std::pair<int, Value::Type> > CEmitter::parameters(const int &index) const {
+    // 形参按出栈顺序声明, 按实参入栈顺序排列
+    const LinkedFunction &function = functions_[index];
+    std::vector<std::pair<int, Value::Type> > parameters;
+    for (int pos = function.start() + 1; pos < function.end(); ++pos) {
+        const PCode &code = ir_.at(pos);
+        if (code.type() == PCode::Type::kArgReal || code.type() == PCode::Type::kArgRealArray) {
+            parameters.push_back(std::make_pair(code.first_address().slot(), Value::Type::kReal));
+        } else if (code.type() == PCode::Type::kArgInteger || code.type() == PCode::Type::kArgIntegerArray) {
+            parameters.push_back(std::make_pair(code.first_address().slot(), Value::Type::kInt));
+        } else {
+            break;
+        }
+    }
+    return std::vector<std::pair<int, Value::Type> >(parameters.rbegin(), parameters.rend());
+}
+
+Value::Type CEmitter::return_type(const int &index) const {
+    return ir_.at(functions_[index].end()).second() == "real" ? Value::Type::kReal : Value::Type::kInt;
+}
+
+std::string CEmitter::function_name(const std::string &name) {
+    return "cmm_" + name;
+}
+
+std::string CEmitter::temp(const int &depth, const Value::Type &type) {
+    std::string temp = "s" + std::to_string(depth) + "_" + suffix(type);
+    temps_.insert(temp);
+    return temp;
+}
+
+void CEmitter::push(const Value::Type &type) {
+    stack_.push_back(type);
+}
+
+Value::Type CEmitter::pop(const int &pos) {
+    if (stack_.empty()) {
+        throw simulator_error(pos, "栈为空, 无法取出栈顶元素");
+    }
+    Value::Type type = stack_.back();
+    stack_.pop_back();
+    return type;
+}
+
+std::string CEmitter::name(const Address &address, const Value::Type &type) {
+    return (address.frame() == Address::Frame::kGlobal ? "g" : "l") + std::to_string(address.slot()) + "_" + suffix(type);
+}
+
+std::string CEmitter::variable(const Address &address) {
+    Value::Type type = declared_type(address);
+    if (type == Value::Type::kNone) {
+        type = Value::Type::kInt;
+    }
+    std::string variable = name(address, type);
+    if (address.frame() == Address::Frame::kLocal && (type == Value::Type::kInt || type == Value::Type::kReal) && !parameters_.count(variable)) {
+        scalars_.insert(variable);
+    }
+    return variable;
+}
+
+Value::Type CEmitter::declared_type(const Address &address) const {
+    if (address.frame() == Address::Frame::kLocal) {
+        return address.slot() < (int)local_types_.size() ? local_types_[address.slot()] : Value::Type::kNone;
+    }
+    return in_function_ ? global_types_[address.slot()] : top_types_[address.slot()];
+}
+
+void CEmitter::declare(const Address &address, const Value::Type &type) {
+    if (address.frame() == Address::Frame::kLocal) {
+        if (address.slot() >= (int)local_types_.size()) {
+            local_types_.resize((unsigned long)address.slot() + 1, Value::Type::kNone);
+        }
+        local_types_[address.slot()] = type;
+    } else {
+        top_types_[address.slot()] = type;
+    }
+}
+
+std::string CEmitter::integer_operand(const Address &address) {
+    if (address.frame() == Address::Frame::kConstant) {
+        return literal(constants_[address.slot()]);
+    }
+    Value::Type type = scalar_type(declared_type(address));
+    return convert(variable(address), type, Value::Type::kInt);
+}
+
+std::string CEmitter::element(const PCode &code, const int &pos) {
+    std::string array = variable(code.first_address());
+    return array + "[cmm_index(" + integer_operand(code.second_address()) + ", " + array + "_n, " + std::to_string(pos) + ")]";
+}
+
+std::string CEmitter::literal(const Symbol &symbol) {
+    if (symbol.type() != Symbol::Type::kReal) {
+        return std::to_string(symbol.int_value());
+    }
+    std::ostringstream buffer;
+    buffer << std::setprecision(17) << symbol.real_value();
+    std::string text = buffer.str();
+    if (text.find_first_of(".eni") == std::string::npos) {
+        text += ".0";
+    }
+    return text;
+}
+
+std::string CEmitter::quote(const std::string &text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+std::string CEmitter::convert(const std::string &value, const Value::Type &from, const Value::Type &to) {
+    if (from == to) {
+        return value;
+    }
+    return (to == Value::Type::kInt ? "(int)" : "(double)") + value;
+}
+
+bool CEmitter::is_integer_array(const std::string &array) {
+    return array.size() >= 2 && array.compare(array.size() - 2, 2, "ia") == 0;
+}
+
+Value::Type CEmitter::scalar_type(const Value::Type &type) {
+    return type == Value::Type::kReal ? Value::Type::kReal : Value::Type::kInt;
+}
+
+Value::Type CEmitter::element_type(const Value::Type &type) {
+    return type == Value::Type::kRealArray ? Value::Type::kReal : Value::Type::kInt;
+}
+
+const char *CEmitter::type_name(const Value::Type &type) {
+    return type == Value::Type::kReal ? "double" : "int";
+}
+
+const char *CEmitter::suffix(const Value::Type &type) {
+    switch (type) {
+        case Value::Type::kReal:
+            return "r";
+        case Value::Type::kIntArray:
+            return "ia";
+        case Value::Type::kRealArray:
+            return "ra";
+        default:
+            return "i";
+    }
+}
@@ -0,0 +1,177 @@
+#include <chrono>
+#include <exception>
+#include <sstream>
+#include "include/cmm.h"
+#include "include/lexer.h"
+#include "include/parser.h"
+#include "include/semantic.h"
+#include "include/inliner.h"
+#include "include/simulator.h"
+#include "include/exceptions.h"
+
+namespace cmm {
+
+static Diagnostic make_diagnostic(const Diagnostic::Severity &severity, const Diagnostic::Stage &stage, const int &row, const int &col, const std::string &message) {
+    Diagnostic diagnostic;
+    diagnostic.severity = severity;
+    diagnostic.stage = stage;
+    diagnostic.row = row;
+    diagnostic.col = col;
+    diagnostic.message = message;
+    return diagnostic;
+}
+
+std::string Diagnostic::text() const {
+    std::stringstream buffer;
+    switch (stage) {
+        case Stage::kLexer:
+        case Stage::kParser:
+            buffer << "第 " << row << " 行 第 " << col << " 列: " << message;
+            break;
+        case Stage::kSemantic:
+            buffer << (severity == Severity::kError ? "[错误]" : "[警告]") << " 第 " << row << " 行 第 " << col << " 列: " << message;
+            break;
+        case Stage::kLinker:
+        case Stage::kRuntime:
+            buffer << "[中间代码错误] 第 " << row << " 行: " << message;
+            break;
+        case Stage::kInternal:
+            buffer << "[内部错误] " << message;
+            break;
+    }
+    return buffer.str();
+}
+
+Program::Program() : inlined_calls_(0) { }
+
+bool Program::is_ok() const {
+    return compiled_ != nullptr;
+}
+
+const std::vector<Diagnostic> &Program::diagnostics() const {
+    return diagnostics_;
+}
+
+const IR &Program::ir() const {
+    return ir_;
+}
+
+int Program::inlined_calls() const {
+    return inlined_calls_;
+}
+
+const CompiledProgram &Program::compiled() const {
+    return *compiled_;
+}
+
+const Program::Listing &Program::listing() const {
+    return listing_;
+}
+
+Program compile(const std::string &source, const CompileOptions &options) {
+    Program program;
+    try {
+        Lexer lexer(source);
+        Parser parser(lexer, 2);
+        parser.parse_program();
+        if (options.listing) {
+            std::stringstream buffer;
+            parser.print_ast(buffer);
+            program.listing_.syntax_tree = buffer.str();
+        }
+
+        Semantic semantic(parser.ast());
+        bool is_analysed = true;
+        try {
+            semantic.analyse();
+        } catch (const scope_critical_error &e) {
+            is_analysed = false;
+        }
+        // 先列出全部错误, 再列出全部警告
+        for (const std::pair<Position, std::string> &error : semantic.error_messages()) {
+            program.diagnostics_.push_back(make_diagnostic(Diagnostic::Severity::kError, Diagnostic::Stage::kSemantic, error.first.row(), error.first.col(), error.second));
+        }
+        for (const std::pair<Position, std::string> &warning : semantic.warning_messages()) {
+            program.diagnostics_.push_back(make_diagnostic(Diagnostic::Severity::kWarning, Diagnostic::Stage::kSemantic, warning.first.row(), warning.first.col(), warning.second));
+        }
+        if (!is_analysed) {
+            return program;
+        }
+
+        program.ir_ = semantic.ir();
+        if (options.listing) {
+            std::stringstream buffer;
+            buffer << program.ir_;
+            program.listing_.ir = buffer.str();
+        }
+        // 在链接前的中间代码上内联小函数, 之后的各种执行方式都使用内联后的结果
+        if (options.inline_budget > 0) {
+            Inliner inliner(program.ir_, options.inline_budget);
+            inliner.run();
+            program.ir_ = inliner.ir();
+            program.inlined_calls_ = (int)inliner.inlined_calls().size();
+            if (options.listing) {
+                std::stringstream buffer;
+                inliner.print_report(buffer);
+                program.listing_.inline_report = buffer.str();
+            }
+        }
+
+        program.compiled_ = std::make_shared<const CompiledProgram>(program.ir_, options.fusion);
+    } catch (const lexer_exception &e) {
+        program.diagnostics_.push_back(make_diagnostic(Diagnostic::Severity::kError, Diagnostic::Stage::kLexer, e.position().row(), e.position().col(), e.message()));
+    } catch (const parser_exception &e) {
+        program.diagnostics_.push_back(make_diagnostic(Diagnostic::Severity::kError, Diagnostic::Stage::kParser, e.position().row(), e.position().col(), e.message()));
+    } catch (const simulator_error &e) {
+        program.diagnostics_.push_back(make_diagnostic(Diagnostic::Severity::kError, Diagnostic::Stage::kLinker, e.line(), 0, e.message()));
+    } catch (const std::exception &e) {
+        // 其余内部错误 (如中间代码中不合法的数字) 同样记为诊断, 不抛给宿主程序
+        program.diagnostics_.push_back(make_diagnostic(Diagnostic::Severity::kError, Diagnostic::Stage::kInternal, 0, 0, e.what()));
+    }
+    return program;
+}
+
+RunResult run(const Program &program, std::istream &input, std::ostream &output, const RunOptions &options) {
+    RunResult result;
+    if (!program.is_ok()) {
+        return result;
+    }
+
+    try {
+        Simulator simulator(program.compiled());
+        simulator.set_input(input);
+        simulator.set_output(output);
+        simulator.set_memory_limit(options.memory_limit);
+        if (options.time_limit > 0) {
+            simulator.set_deadline(Simulator::Clock::now() + std::chrono::milliseconds(options.time_limit));
+        }
+        try {
+            simulator.load();
+            if (options.fuel > 0) {
+                simulator.run_for(options.fuel);
+            } else {
+                simulator.resume();
+            }
+            if (simulator.pause_reason() == Simulator::Pause::kFuel) {
+                result.status = RunResult::Status::kOutOfFuel;
+            } else if (simulator.pause_reason() == Simulator::Pause::kDeadline) {
+                result.status = RunResult::Status::kTimeout;
+            } else {
+                result.status = RunResult::Status::kFinished;
+            }
+            result.position = simulator.line();
+        } catch (const simulator_error &e) {
+            result.status = RunResult::Status::kRuntimeError;
+            result.position = e.line();
+            result.diagnostics.push_back(make_diagnostic(Diagnostic::Severity::kError, Diagnostic::Stage::kRuntime, e.line(), 0, e.message()));
+        }
+        result.peak_memory = simulator.memory().peak();
+    } catch (const std::exception &e) {
+        // 其余内部错误 (如内存不足) 同样记为诊断, 不抛给宿主程序
+        result.status = RunResult::Status::kRuntimeError;
+        result.diagnostics.push_back(make_diagnostic(Diagnostic::Severity::kError, Diagnostic::Stage::kInternal, 0, 0, e.what()));
+    }
+    return result;
+}
+
+}
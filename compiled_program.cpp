@@ -0,0 +1,54 @@
+#include "include/compiled_program.h"
+#include "include/fusion.h"
+#include "include/snapshot.h"
+
+CompiledProgram::CompiledProgram(const IR &ir, const bool &fusion) : global_size_(0), is_fused_(fusion), fingerprint_(0) {
+    // 添加主函数调用
+    IR program = ir;
+    program.add(PCode(PCode::Type::kCall, "main"));
+
+    // 将变量名链接为 (帧, 槽位) 地址, 解码字面量, 并将 Label 和函数名解析为位置
+    // 之后删除 Label 与块标记, 顺序执行时不必再逐条跳过它们
+    Linker linker(program);
+    linker.link();
+    linker.strip();
+    ir_ = linker.ir();
+    lines_ = linker.lines();
+    if (fusion) {
+        Fusion fusion_pass(ir_);
+        fusion_pass.fuse();
+        ir_ = fusion_pass.ir();
+    }
+    constants_ = linker.constants();
+    functions_ = linker.functions();
+    global_size_ = linker.global_size();
+    fingerprint_ = SnapshotWriter::fingerprint(ir_);
+}
+
+const IR &CompiledProgram::ir() const {
+    return ir_;
+}
+
+const std::vector<Symbol> &CompiledProgram::constants() const {
+    return constants_;
+}
+
+const std::vector<LinkedFunction> &CompiledProgram::functions() const {
+    return functions_;
+}
+
+int CompiledProgram::global_size() const {
+    return global_size_;
+}
+
+int CompiledProgram::line(const int &pos) const {
+    return lines_[pos];
+}
+
+bool CompiledProgram::is_fused() const {
+    return is_fused_;
+}
+
+unsigned long long CompiledProgram::fingerprint() const {
+    return fingerprint_;
+}
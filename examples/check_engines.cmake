@@ -0,0 +1,27 @@
+# 在各种执行方式下运行同一个程序, 比较 "运行结果:" 之后的输出, 以栈式虚拟机的结果为准
+# 用法: cmake -DCMM=<cmm 可执行文件> -DSOURCE=<源码> [-DJIT=ON] -P check_engines.cmake
+
+function(run_engine result)
+    execute_process(COMMAND ${CMM} ${ARGN} ${SOURCE} OUTPUT_VARIABLE output RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "cmm ${ARGN} ${SOURCE} 退出码为 ${status}")
+    endif()
+    string(FIND "${output}" "运行结果:" position)
+    if(position EQUAL -1)
+        message(FATAL_ERROR "cmm ${ARGN} ${SOURCE} 没有输出运行结果")
+    endif()
+    string(SUBSTRING "${output}" ${position} -1 output)
+    set(${result} "${output}" PARENT_SCOPE)
+endfunction()
+
+run_engine(expected --engine=stack --dispatch=switch)
+set(engines "--engine=stack" "--engine=register")
+if(JIT)
+    list(APPEND engines "--jit")
+endif()
+foreach(engine ${engines})
+    run_engine(actual ${engine})
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "${engine} 的运行结果与栈式虚拟机不同:\n${actual}\n应为:\n${expected}")
+    endif()
+endforeach()
@@ -0,0 +1,137 @@
+#include "include/fusion.h"
+
+Fusion::Fusion(const IR &ir) : ir_(ir), fused_count_(0) { }
+
+void Fusion::fuse() {
+    fused_count_ = 0;
+    for (int pos = 0; pos < ir_.size(); ) {
+        if (fuse_increment(pos) || fuse_compare_jump(pos) || fuse_move(pos)) {
+            ++fused_count_;
+            pos += length(ir_.at(pos).type());
+        } else {
+            ++pos;
+        }
+    }
+}
+
+const IR &Fusion::ir() const {
+    return ir_;
+}
+
+int Fusion::fused_count() const {
+    return fused_count_;
+}
+
+int Fusion::length(const PCode::Type &type) {
+    switch (type) {
+        case PCode::Type::kIncrementInteger:
+        case PCode::Type::kDecrementInteger:
+        case PCode::Type::kCompareEqualJumpZero:
+        case PCode::Type::kCompareNotEqualJumpZero:
+        case PCode::Type::kCompareGreaterThanJumpZero:
+        case PCode::Type::kCompareLessThanJumpZero:
+        case PCode::Type::kCompareGreaterEqualJumpZero:
+        case PCode::Type::kCompareLessEqualJumpZero:
+            return 4;
+        case PCode::Type::kMoveInteger:
+        case PCode::Type::kMoveReal:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+// pushi a; pushi b; addi|subi; popi a
+bool Fusion::fuse_increment(const int &pos) {
+    if (!is(pos, PCode::Type::kPushInteger) || !is(pos + 1, PCode::Type::kPushInteger) || !is(pos + 3, PCode::Type::kPopInteger)) {
+        return false;
+    }
+
+    PCode::Type type;
+    if (is(pos + 2, PCode::Type::kAddInteger)) {
+        type = PCode::Type::kIncrementInteger;
+    } else if (is(pos + 2, PCode::Type::kSubInteger)) {
+        type = PCode::Type::kDecrementInteger;
+    } else {
+        return false;
+    }
+
+    PCode &code = ir_.at(pos);
+    const PCode &operand = ir_.at(pos + 1);
+    if (code.first_address().frame() == Address::Frame::kConstant || !same_address(code.first_address(), ir_.at(pos + 3).first_address())) {
+        return false;
+    }
+
+    code.set(type, code.first(), operand.first());
+    code.set_second_address(operand.first_address());
+    return true;
+}
+
+// pushi a; pushi b; cmp<op>i; jz L
+bool Fusion::fuse_compare_jump(const int &pos) {
+    if (!is(pos, PCode::Type::kPushInteger) || !is(pos + 1, PCode::Type::kPushInteger) || !is(pos + 3, PCode::Type::kJumpZero)) {
+        return false;
+    }
+
+    PCode::Type type;
+    switch (ir_.at(pos + 2).type()) {
+        case PCode::Type::kCompareEqualInteger:
+            type = PCode::Type::kCompareEqualJumpZero;
+            break;
+        case PCode::Type::kCompareNotEqualInteger:
+            type = PCode::Type::kCompareNotEqualJumpZero;
+            break;
+        case PCode::Type::kCompareGreaterThanInteger:
+            type = PCode::Type::kCompareGreaterThanJumpZero;
+            break;
+        case PCode::Type::kCompareLessThanInteger:
+            type = PCode::Type::kCompareLessThanJumpZero;
+            break;
+        case PCode::Type::kCompareGreaterEqualInteger:
+            type = PCode::Type::kCompareGreaterEqualJumpZero;
+            break;
+        case PCode::Type::kCompareLessEqualInteger:
+            type = PCode::Type::kCompareLessEqualJumpZero;
+            break;
+        default:
+            return false;
+    }
+
+    PCode &code = ir_.at(pos);
+    const PCode &operand = ir_.at(pos + 1);
+    const PCode &jump = ir_.at(pos + 3);
+    code.set(type, code.first(), operand.first(), jump.first());
+    code.set_second_address(operand.first_address());
+    code.set_target(jump.target());
+    return true;
+}
+
+// pushi b; popi a 或 pushr b; popr a
+bool Fusion::fuse_move(const int &pos) {
+    PCode::Type type;
+    if (is(pos, PCode::Type::kPushInteger) && is(pos + 1, PCode::Type::kPopInteger)) {
+        type = PCode::Type::kMoveInteger;
+    } else if (is(pos, PCode::Type::kPushReal) && is(pos + 1, PCode::Type::kPopReal)) {
+        type = PCode::Type::kMoveReal;
+    } else {
+        return false;
+    }
+
+    // 融合后 first 为目标, second 为来源
+    PCode &code = ir_.at(pos);
+    const PCode &target = ir_.at(pos + 1);
+    std::string source_name = code.first();
+    Address source = code.first_address();
+    code.set(type, target.first(), source_name);
+    code.set_first_address(target.first_address());
+    code.set_second_address(source);
+    return true;
+}
+
+bool Fusion::is(const int &pos, const PCode::Type &type) const {
+    return pos < ir_.size() && ir_.at(pos).type() == type;
+}
+
+bool Fusion::same_address(const Address &first, const Address &second) {
+    return first.frame() == second.frame() && first.slot() == second.slot();
+}
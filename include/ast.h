@@ -11,6 +11,17 @@ public:
 
     AbstractSyntaxNode(const Token &token, AbstractSyntaxNode *parent = nullptr) : token_(token), parent_(parent) { }
 
+    AbstractSyntaxNode(const AbstractSyntaxNode &) = delete;
+
+    AbstractSyntaxNode &operator = (const AbstractSyntaxNode &) = delete;
+
+    // 结点拥有其子结点, 随根结点一并释放
+    ~AbstractSyntaxNode() {
+        for (std::vector<AbstractSyntaxNode *>::iterator it = children_.begin(); it != children_.end(); ++it) {
+            delete *it;
+        }
+    }
+
     AbstractSyntaxNode *add_child(AbstractSyntaxNode *child) {
         children_.push_back(child);
         return children_.back();
@@ -48,21 +59,21 @@ public:
         return parent_;
     }
 
-    void print(const int &indent = 0) const {
+    void print(std::ostream &os = std::cout, const int &indent = 0) const {
         for (int i = 0; i < indent; ++i) {
             if (i == indent - 4) {
-                std::cout << "┗";
+                os << "┗";
             } else if (i > indent - 4) {
-                std::cout << "━";
+                os << "━";
             } else if (i % 4 == 0) {
-                std::cout << "┃";
+                os << "┃";
             } else {
-                std::cout << " ";
+                os << " ";
             }
         }
-        std::cout << "Token: \"" << token_.content() << "\"<\"" << token_.type_name() << "\"> (Children: " << children_.size() << ")" << std::endl;
+        os << "Token: \"" << token_.content() << "\"<\"" << token_.type_name() << "\"> (Children: " << children_.size() << ")" << std::endl;
         for (std::vector<AbstractSyntaxNode *>::const_iterator it = children_.begin(); it != children_.end(); ++it) {
-            (*it)->print(indent + 4);
+            (*it)->print(os, indent + 4);
         }
     }
 
@@ -0,0 +1,312 @@
+#ifndef CMM_BYTECODE_H
+#define CMM_BYTECODE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include "value.h"
+
+// 寄存器虚拟机的三地址指令
+// 操作数为非负数时表示当前帧中的寄存器, 为负数时按位取反后表示全局区 (全局变量之后紧接常量池) 中的位置
+class Bytecode {
+public:
+    enum class Type {
+        kMove = 0,                       // mov a, b                  a = b
+        kMoveInteger,                    // movi a, b                 a = (int)b
+        kMoveReal,                       // movr a, b                 a = (real)b
+        kIntegerToReal,                  // i2r a, b                  a = (real)b, b 一定为 int
+        kCheck,                          // check a, b                变量 a 未赋值时报错, b 为变量名编号
+
+        kVarInteger,                     // vari a
+        kVarReal,                        // varr a
+        kVarIntegerArray,                // varia a, b                b 为数组大小
+        kVarRealArray,                   // varra a, b
+
+        kLoadIntegerArray,               // ldia a, b, c              a = b[c]
+        kLoadRealArray,                  // ldra a, b, c
+        kStoreIntegerArray,              // stia a, b, c              a[b] = (int)c
+        kStoreRealArray,                 // stra a, b, c              a[b] = (real)c
+
+        // 按静态类型特化的运算, 执行时不检查操作数类型
+        kAddInteger,                     // addi a, b, c              a = b + c
+        kAddReal,                        // addr a, b, c
+        kSubInteger,                     // subi a, b, c
+        kSubReal,                        // subr a, b, c
+        kMulInteger,                     // muli a, b, c
+        kMulReal,                        // mulr a, b, c
+        kDivInteger,                     // divi a, b, c
+        kDivReal,                        // divr a, b, c
+
+        kCompareEqualInteger,            // cmpeqi a, b, c            a = b == c
+        kCompareEqualReal,               // cmpeqr a, b, c
+        kCompareNotEqualInteger,         // cmpnei a, b, c
+        kCompareNotEqualReal,            // cmpner a, b, c
+        kCompareGreaterThanInteger,      // cmpgti a, b, c
+        kCompareGreaterThanReal,         // cmpgtr a, b, c
+        kCompareLessThanInteger,         // cmplti a, b, c
+        kCompareLessThanReal,            // cmpltr a, b, c
+        kCompareGreaterEqualInteger,     // cmpgei a, b, c
+        kCompareGreaterEqualReal,        // cmpger a, b, c
+        kCompareLessEqualInteger,        // cmplei a, b, c
+        kCompareLessEqualReal,           // cmpler a, b, c
+
+        kJump,                           // jmp a
+        kJumpZero,                       // jz a, b                   a 为 0 时跳转至 b
+        kJumpNotZero,                    // jnz a, b
+
+        kJumpZeroEqualInteger,           // jzeqi a, b, c             (a == b) 为 0 时跳转至 c
+        kJumpZeroEqualReal,              // jzeqr a, b, c
+        kJumpZeroNotEqualInteger,        // jznei a, b, c
+        kJumpZeroNotEqualReal,           // jzner a, b, c
+        kJumpZeroGreaterThanInteger,     // jzgti a, b, c
+        kJumpZeroGreaterThanReal,        // jzgtr a, b, c
+        kJumpZeroLessThanInteger,        // jzlti a, b, c
+        kJumpZeroLessThanReal,           // jzltr a, b, c
+        kJumpZeroGreaterEqualInteger,    // jzgei a, b, c
+        kJumpZeroGreaterEqualReal,       // jzger a, b, c
+        kJumpZeroLessEqualInteger,       // jzlei a, b, c
+        kJumpZeroLessEqualReal,          // jzler a, b, c
+
+        kCall,                           // call a, b, c              a = 函数 b (实参列表位于 c)
+        kReturn,                         // ret a
+
+        kPrint,                          // print a
+        kReadInt,                        // readi a
+        kReadReal,                       // readr a
+        kReadIntArray,                   // readia a, b
+        kReadRealArray,                  // readra a, b
+
+        kHalt,                           // halt
+    };
+
+    Bytecode(const Type &type, const int &a = 0, const int &b = 0, const int &c = 0) : type_(type), a_(a), b_(b), c_(c) { }
+
+    const Type &type() const {
+        return type_;
+    }
+
+    int a() const {
+        return a_;
+    }
+
+    int b() const {
+        return b_;
+    }
+
+    int c() const {
+        return c_;
+    }
+
+    void set_a(const int &a) {
+        a_ = a;
+    }
+
+    void set_b(const int &b) {
+        b_ = b;
+    }
+
+    void set_c(const int &c) {
+        c_ = c;
+    }
+
+    // 指令名称
+    static const char *type_name(const Type &type);
+
+private:
+    Type type_;
+    int a_;
+    int b_;
+    int c_;
+};
+
+// 寄存器虚拟机中的函数
+class BytecodeFunction {
+public:
+    BytecodeFunction(const std::string &name, const int &frame_size) :
+            name_(name), entry_(0), frame_size_(frame_size), registers_(frame_size), return_type_(Value::Type::kInt) { }
+
+    const std::string &name() const {
+        return name_;
+    }
+
+    // 函数第一条指令的位置
+    int entry() const {
+        return entry_;
+    }
+
+    // 变量所占的寄存器数量, 其后为临时寄存器
+    int frame_size() const {
+        return frame_size_;
+    }
+
+    // 帧中寄存器总数
+    int registers() const {
+        return registers_;
+    }
+
+    // 返回值类型
+    const Value::Type &return_type() const {
+        return return_type_;
+    }
+
+    // 按实参顺序排列的形参寄存器与类型
+    const std::vector<std::pair<int, Value::Type> > &parameters() const {
+        return parameters_;
+    }
+
+    void set_entry(const int &entry) {
+        entry_ = entry;
+    }
+
+    void set_registers(const int &registers) {
+        registers_ = registers;
+    }
+
+    void set_return_type(const Value::Type &return_type) {
+        return_type_ = return_type;
+    }
+
+    void add_parameter(const int &reg, const Value::Type &type) {
+        parameters_.push_back(std::pair<int, Value::Type>(reg, type));
+    }
+
+private:
+    std::string name_;
+    int entry_;
+    int frame_size_;
+    int registers_;
+    Value::Type return_type_;
+    std::vector<std::pair<int, Value::Type> > parameters_;
+};
+
+// 寄存器虚拟机程序
+class BytecodeProgram {
+public:
+    BytecodeProgram() : global_size_(0), entry_function_(0) { }
+
+    // 操作数编码
+    static int local_operand(const int &slot) {
+        return slot;
+    }
+
+    static int global_operand(const int &index) {
+        return ~index;
+    }
+
+    static bool is_local_operand(const int &operand) {
+        return operand >= 0;
+    }
+
+    int constant_operand(const int &index) const {
+        return ~(global_size_ + index);
+    }
+
+    bool is_constant_operand(const int &operand) const {
+        return operand < 0 && ~operand >= global_size_;
+    }
+
+    // 添加一条指令, line 为其对应的中间代码位置
+    int add(const Bytecode &code, const int &line) {
+        code_.push_back(code);
+        lines_.push_back(line);
+        return (int)code_.size() - 1;
+    }
+
+    const Bytecode &at(const int &pc) const {
+        return code_[pc];
+    }
+
+    Bytecode &at(const int &pc) {
+        return code_[pc];
+    }
+
+    int size() const {
+        return (int)code_.size();
+    }
+
+    const std::vector<Bytecode> &code() const {
+        return code_;
+    }
+
+    // 指令对应的中间代码位置, 用于报错
+    int line(const int &pc) const {
+        return lines_[pc];
+    }
+
+    int add_function(const BytecodeFunction &function) {
+        functions_.push_back(function);
+        return (int)functions_.size() - 1;
+    }
+
+    const std::vector<BytecodeFunction> &functions() const {
+        return functions_;
+    }
+
+    BytecodeFunction &function(const int &index) {
+        return functions_[index];
+    }
+
+    // 添加一组实参, 返回其在实参表中的位置
+    int add_arguments(const std::vector<int> &arguments) {
+        int offset = (int)arguments_.size();
+        arguments_.insert(arguments_.end(), arguments.begin(), arguments.end());
+        return offset;
+    }
+
+    const std::vector<int> &arguments() const {
+        return arguments_;
+    }
+
+    int add_name(const std::string &name) {
+        names_.push_back(name);
+        return (int)names_.size() - 1;
+    }
+
+    const std::string &name(const int &index) const {
+        return names_[index];
+    }
+
+    int global_size() const {
+        return global_size_;
+    }
+
+    void set_global_size(const int &global_size) {
+        global_size_ = global_size;
+    }
+
+    const std::vector<Value> &constants() const {
+        return constants_;
+    }
+
+    void set_constants(const std::vector<Value> &constants) {
+        constants_ = constants;
+    }
+
+    // 程序入口, 即全局语句所在的函数
+    int entry_function() const {
+        return entry_function_;
+    }
+
+    void set_entry_function(const int &entry_function) {
+        entry_function_ = entry_function;
+    }
+
+    // 输出 pc 处的一条指令, 不含位置与换行
+    void print_code(std::ostream &os, const int &pc) const;
+
+    friend std::ostream &operator << (std::ostream &os, const BytecodeProgram &program);
+
+private:
+    std::vector<Bytecode> code_;
+    std::vector<int> lines_;
+    std::vector<BytecodeFunction> functions_;
+    std::vector<int> arguments_;
+    std::vector<std::string> names_;
+    std::vector<Value> constants_;
+    int global_size_;
+    int entry_function_;
+
+    void print_operand(std::ostream &os, const int &operand) const;
+};
+
+#endif //CMM_BYTECODE_H
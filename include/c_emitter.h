@@ -0,0 +1,140 @@
+#ifndef CMM_C_EMITTER_H
+#define CMM_C_EMITTER_H
+
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "ir.h"
+#include "linker.h"
+#include "symbol.h"
+#include "value.h"
+#include "exceptions.h"
+
+// 将链接后的栈式中间代码翻译为独立的 C 程序, 供系统的 C 编译器编译
+// 语义分析生成的中间代码在每个位置的栈深度和栈中元素类型都是静态确定的, 因此栈中第 n 个元素翻译为按类型区分的局部变量 s<n>_i / s<n>_r,
+// 变量按 (帧, 槽位, 类型) 翻译为 C 变量, 数组翻译为 C 数组, Label 翻译为 goto 目标. 运行时错误的信息与栈式虚拟机一致
+class CEmitter {
+public:
+    CEmitter(const IR &ir) : ir_(ir), current_return_type_(Value::Type::kInt), in_function_(false) { }
+
+    // 添加主函数调用, 链接并输出 C 代码
+    void emit(std::ostream &os);
+
+private:
+    // 数组的存储方式
+    struct ArrayInfo {
+        bool is_dynamic;                 // 大小不是常量或超出栈上数组的上限时在堆上分配
+        int capacity;                    // 栈上或静态数组的容量
+    };
+
+    // 栈上数组的最大元素个数, 更大的局部数组在堆上分配以免栈溢出
+    static const int kMaxStackArray = 16384;
+
+    // 静态数组的最大元素个数
+    static const int kMaxStaticArray = 1 << 22;
+
+    IR ir_;
+    std::vector<Symbol> constants_;
+    std::vector<LinkedFunction> functions_;
+    std::vector<Value::Type> global_types_;        // 全局变量在函数中可见的类型
+    std::vector<Value::Type> local_types_;         // 当前位置每个槽位最近一次定义的类型
+    std::vector<Value::Type> top_types_;           // 翻译全局语句时每个全局槽位最近一次定义的类型
+    std::vector<Value::Type> stack_;               // 编译期的栈, 记录每个元素的静态类型
+    std::set<std::string> temps_;                  // 当前函数用到的栈变量
+    std::set<std::string> scalars_;                // 当前函数用到的局部变量
+    std::set<std::string> parameters_;             // 当前函数的形参
+    std::map<std::string, ArrayInfo> arrays_;      // 当前函数用到的局部数组
+    std::set<std::string> global_scalars_;
+    std::map<std::string, ArrayInfo> global_arrays_;
+    std::set<int> targets_;                        // 当前函数中的跳转目标
+    Value::Type current_return_type_;
+    bool in_function_;
+
+    // 输出运行时支持函数
+    void emit_prelude(std::ostream &os) const;
+
+    // 输出全局变量
+    void emit_globals(std::ostream &os);
+
+    // 输出函数原型
+    void emit_prototypes(std::ostream &os) const;
+
+    // 输出函数定义
+    void emit_function(std::ostream &os, const int &index);
+
+    // 输出由全局语句组成的 main 函数
+    void emit_entry(std::ostream &os);
+
+    // 输出当前函数的局部变量声明
+    void emit_declarations(std::ostream &os);
+
+    // 翻译 [begin, end] 之间的中间代码, 跳过其中的函数定义
+    void emit_body(std::ostream &os, const int &begin, const int &end);
+
+    // 翻译一条中间代码
+    void emit_instruction(std::ostream &os, const int &pos);
+
+    void emit_typed(std::ostream &os, const int &pos, const std::string &op, const Value::Type &type);
+
+    void emit_compare(std::ostream &os, const int &pos, const std::string &op);
+
+    void emit_call(std::ostream &os, const int &pos, const PCode &code);
+
+    void emit_return(std::ostream &os, const std::string &value);
+
+    // 收集 [begin, end] 之间的跳转目标与数组定义, 决定数组的存储方式
+    void collect(const int &begin, const int &end);
+
+    const ArrayInfo &array_info(const std::string &array) const;
+
+    // 函数的形参, 按实参入栈顺序排列
+    std::vector<std::pair<int, Value::Type> > parameters(const int &index) const;
+
+    Value::Type return_type(const int &index) const;
+
+    static std::string function_name(const std::string &name);
+
+    // 栈中第 depth 个元素, 按类型区分
+    std::string temp(const int &depth, const Value::Type &type);
+
+    void push(const Value::Type &type);
+
+    Value::Type pop(const int &pos);
+
+    // 变量地址对应的 C 变量名, 按类型区分
+    static std::string name(const Address &address, const Value::Type &type);
+
+    // 按变量当前定义的类型获取 C 变量名, 并记录需要声明的局部变量
+    std::string variable(const Address &address);
+
+    Value::Type declared_type(const Address &address) const;
+
+    void declare(const Address &address, const Value::Type &type);
+
+    // 数组下标或大小: 常量直接输出, 变量按 int 读取
+    std::string integer_operand(const Address &address);
+
+    // 带下标检查的数组元素
+    std::string element(const PCode &code, const int &pos);
+
+    static std::string literal(const Symbol &symbol);
+
+    static std::string quote(const std::string &text);
+
+    static std::string convert(const std::string &value, const Value::Type &from, const Value::Type &to);
+
+    static bool is_integer_array(const std::string &array);
+
+    static Value::Type scalar_type(const Value::Type &type);
+
+    static Value::Type element_type(const Value::Type &type);
+
+    static const char *type_name(const Value::Type &type);
+
+    static const char *suffix(const Value::Type &type);
+};
+
+#endif //CMM_C_EMITTER_H
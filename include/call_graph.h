@@ -0,0 +1,181 @@
+#ifndef CMM_CALL_GRAPH_H
+#define CMM_CALL_GRAPH_H
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+
+// 函数级的调用图剖析, 在函数调用与返回时维护一个影子调用栈:
+// 1. 以调用上下文树记录每条完整调用路径上的自身耗时, 按 Brendan Gregg 的折叠栈格式输出, 可直接交给火焰图工具
+// 2. 按 调用者 -> 被调用者 的边统计调用次数, 包含耗时与自身耗时. 递归调用时只有最外层的调用计入边的包含耗时, 避免重复计算
+class CallGraphProfiler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    CallGraphProfiler() : enabled_(false) { }
+
+    bool is_enabled() const {
+        return enabled_;
+    }
+
+    // 开始记录, names 为按编号排列的函数名, 全局语句作为调用栈的根
+    void reset(const bool &enabled, const std::vector<std::string> &names) {
+        enabled_ = enabled;
+        names_ = names;
+        nodes_.clear();
+        stack_.clear();
+        edges_.clear();
+        if (enabled) {
+            nodes_.push_back(Node{kGlobal, -1, std::map<int, int>(), 0, 0});
+            stack_.push_back(Activation{0, Clock::now(), 0, nullptr});
+        }
+    }
+
+    // 调用编号为 function 的函数
+    void enter(const int &function) {
+        Activation &caller = stack_.back();
+        int node;
+        std::map<int, int>::const_iterator it = nodes_[caller.node].children.find(function);
+        if (it != nodes_[caller.node].children.end()) {
+            node = it->second;
+        } else {
+            node = (int)nodes_.size();
+            nodes_[caller.node].children[function] = node;
+            nodes_.push_back(Node{function, caller.node, std::map<int, int>(), 0, 0});
+        }
+        ++nodes_[node].calls;
+
+        Edge *edge = &edges_[std::make_pair(nodes_[caller.node].function, function)];
+        ++edge->calls;
+        ++edge->active;
+        stack_.push_back(Activation{node, Clock::now(), 0, edge});
+    }
+
+    // 从当前函数返回
+    void leave() {
+        if (stack_.size() > 1) {
+            close(Clock::now());
+        }
+    }
+
+    // 运行结束, 关闭仍未返回的函数 (出错时) 与全局语句
+    void finish() {
+        if (!enabled_) {
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        while (!stack_.empty()) {
+            close(now);
+        }
+    }
+
+    // 输出折叠栈: 每条调用路径一行, 函数名以分号分隔, 之后为该路径上的自身耗时 (纳秒)
+    void print_folded(std::ostream &os) const {
+        if (nodes_.empty()) {
+            return;
+        }
+        // 深度优先遍历调用上下文树, 路径字符串随遍历增减, 深递归时无需为每个结点重新拼接整条路径
+        std::vector<std::pair<int, unsigned long> > pending(1, std::make_pair(0, 0ul));
+        std::string path;
+        while (!pending.empty()) {
+            const Node &node = nodes_[pending.back().first];
+            path.resize(pending.back().second);
+            pending.pop_back();
+            if (!path.empty()) {
+                path += ";";
+            }
+            path += name(node.function);
+            if (node.exclusive > 0) {
+                os << path << " " << node.exclusive << "\n";
+            }
+            for (std::map<int, int>::const_reverse_iterator it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                pending.push_back(std::make_pair(it->second, (unsigned long)path.size()));
+            }
+        }
+        os.flush();
+    }
+
+    // 输出每条调用边的统计, 按包含耗时从高到低排列
+    void print(std::ostream &os) const {
+        std::ios::fmtflags flags = os.flags();
+        std::streamsize precision = os.precision();
+
+        std::vector<std::pair<std::pair<int, int>, Edge> > edges(edges_.begin(), edges_.end());
+        std::sort(edges.begin(), edges.end(), [](const std::pair<std::pair<int, int>, Edge> &a, const std::pair<std::pair<int, int>, Edge> &b) {
+            return a.second.inclusive != b.second.inclusive ? a.second.inclusive > b.second.inclusive : a.first < b.first;
+        });
+
+        os << "函数调用图:" << std::endl;
+        os << "    调用次数  包含耗时(ms)  自身耗时(ms)  调用者 -> 被调用者" << std::endl;
+        for (const auto &edge : edges) {
+            os << std::setw(12) << edge.second.calls << std::fixed << std::setprecision(3)
+               << std::setw(14) << edge.second.inclusive / 1e6 << std::setw(14) << edge.second.exclusive / 1e6
+               << "  " << name(edge.first.first) << " -> " << name(edge.first.second) << std::endl;
+        }
+
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+private:
+    // 调用栈的根, 表示全局语句
+    static const int kGlobal = -1;
+
+    // 调用上下文树的结点, 对应一条调用路径
+    struct Node {
+        int function;
+        int parent;
+        std::map<int, int> children;     // 被调用函数编号 -> 结点
+        long long calls;
+        long long exclusive;             // 自身耗时 (纳秒)
+    };
+
+    struct Edge {
+        long long calls;
+        long long inclusive;             // 包含耗时 (纳秒), 只计最外层的调用
+        long long exclusive;             // 自身耗时 (纳秒)
+        int active;                      // 当前在影子栈中的调用次数
+    };
+
+    // 影子调用栈中的一次调用
+    struct Activation {
+        int node;
+        Clock::time_point start;
+        long long children;              // 被调用函数的包含耗时
+        Edge *edge;                      // std::map 中的元素地址不会失效
+    };
+
+    bool enabled_;
+    std::vector<std::string> names_;
+    std::vector<Node> nodes_;
+    std::vector<Activation> stack_;
+    std::map<std::pair<int, int>, Edge> edges_;
+
+    // 关闭栈顶的调用, 将其耗时计入结点, 边与调用者
+    void close(const Clock::time_point &now) {
+        Activation activation = stack_.back();
+        stack_.pop_back();
+        long long inclusive = std::chrono::duration_cast<std::chrono::nanoseconds>(now - activation.start).count();
+        long long exclusive = inclusive - activation.children;
+        nodes_[activation.node].exclusive += exclusive;
+        if (activation.edge != nullptr) {
+            activation.edge->exclusive += exclusive;
+            if (--activation.edge->active == 0) {
+                activation.edge->inclusive += inclusive;
+            }
+        }
+        if (!stack_.empty()) {
+            stack_.back().children += inclusive;
+        }
+    }
+
+    std::string name(const int &function) const {
+        return function == kGlobal ? "(global)" : names_[function];
+    }
+};
+
+#endif //CMM_CALL_GRAPH_H
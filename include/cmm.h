@@ -0,0 +1,125 @@
+#ifndef CMM_CMM_H
+#define CMM_CMM_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ir.h"
+#include "compiled_program.h"
+
+// 嵌入 CMM 的接口: compile 将源码编译为程序, run 在给定的输入输出上运行程序
+// 编译得到的 Program 复制代价很小且不再修改, 可以保存下来反复运行, 也可以在多个线程中同时运行
+// 所有错误与警告都以 Diagnostic 返回, 不写出到标准输出, 也不抛出异常
+namespace cmm {
+
+// 一条错误或警告
+struct Diagnostic {
+    enum class Severity {
+        kError,
+        kWarning,
+    };
+
+    enum class Stage {
+        kLexer,
+        kParser,
+        kSemantic,
+        kLinker,
+        kRuntime,
+        kInternal,                       // 编译器或虚拟机内部的其他异常, 行列为 0
+    };
+
+    Severity severity;
+    Stage stage;
+    int row;                             // 源码中的行列; 链接与运行时的错误为中间代码的指令位置, 列为 0
+    int col;
+    std::string message;                 // 不含位置前缀的信息
+
+    // 与命令行程序相同格式的一行文本
+    std::string text() const;
+};
+
+struct CompileOptions {
+    CompileOptions() : fusion(true), inline_budget(0), listing(false) { }
+
+    bool fusion;                         // 是否融合超级指令
+    int inline_budget;                   // 内联的函数体大小上限, 为 0 时不内联
+    bool listing;                        // 是否保留语法树, 中间代码与内联报告的文本
+};
+
+class Program {
+public:
+    // 编译过程的文本列表, 仅在 CompileOptions::listing 为 true 时生成
+    struct Listing {
+        std::string syntax_tree;
+        std::string ir;                  // 语义分析生成的中间代码
+        std::string inline_report;       // 未开启内联时为空
+    };
+
+    // 编译成功, 可以运行
+    bool is_ok() const;
+
+    const std::vector<Diagnostic> &diagnostics() const;
+
+    // 内联后, 链接前的中间代码, 语义分析通过后可用, 供寄存器虚拟机与 C 代码生成使用
+    const IR &ir() const;
+
+    // 已内联的调用数量
+    int inlined_calls() const;
+
+    // 栈式虚拟机装载的程序, 仅在 is_ok() 时可用
+    const CompiledProgram &compiled() const;
+
+    const Listing &listing() const;
+
+private:
+    friend Program compile(const std::string &source, const CompileOptions &options);
+
+    Program();
+
+    std::vector<Diagnostic> diagnostics_;
+    IR ir_;
+    int inlined_calls_;
+    std::shared_ptr<const CompiledProgram> compiled_;
+    Listing listing_;
+};
+
+// 编译源码, 词法, 语法, 语义与链接错误记入返回的 Program
+Program compile(const std::string &source, const CompileOptions &options = CompileOptions());
+
+struct RunOptions {
+    RunOptions() : fuel(0), time_limit(0), memory_limit(0) { }
+
+    long long fuel;                      // 燃料上限, 为 0 时不限
+    int time_limit;                      // 运行时间上限 (毫秒), 为 0 时不限
+    unsigned long long memory_limit;     // 内存配额 (字节), 为 0 时不限
+};
+
+struct RunResult {
+    enum class Status {
+        kFinished,
+        kRuntimeError,
+        kOutOfFuel,
+        kTimeout,
+        kNotCompiled,                    // 程序未能编译
+    };
+
+    RunResult() : status(Status::kNotCompiled), position(0), peak_memory(0) { }
+
+    bool is_ok() const {
+        return status == Status::kFinished;
+    }
+
+    Status status;
+    std::vector<Diagnostic> diagnostics; // 运行时错误
+    int position;                        // 出错或中止时的指令位置
+    unsigned long long peak_memory;      // 运行时内存的峰值 (字节)
+};
+
+// 在栈式虚拟机上运行程序, read 语句读取 input, write 语句写入 output
+// 每次运行使用独立的运行状态, 同一个 Program 可以在多个线程中同时运行
+RunResult run(const Program &program, std::istream &input, std::ostream &output, const RunOptions &options = RunOptions());
+
+}
+
+#endif //CMM_CMM_H
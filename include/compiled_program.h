@@ -0,0 +1,44 @@
+#ifndef CMM_COMPILED_PROGRAM_H
+#define CMM_COMPILED_PROGRAM_H
+
+#include <string>
+#include <vector>
+#include "ir.h"
+#include "linker.h"
+#include "symbol.h"
+
+// 栈式虚拟机装载后的程序: 添加主函数调用, 链接, 删除 Label 与块标记并按需融合超级指令后的中间代码, 常量池与函数表
+// 构造完成后不再修改, 可由多个 Simulator 以常量引用共享, 并在多个线程中同时运行; 每个 Simulator 只持有自己的运行状态
+class CompiledProgram {
+public:
+    explicit CompiledProgram(const IR &ir, const bool &fusion = true);
+
+    // 链接后实际执行的中间代码
+    const IR &ir() const;
+
+    const std::vector<Symbol> &constants() const;
+
+    const std::vector<LinkedFunction> &functions() const;
+
+    // 全局帧所需的槽位数量
+    int global_size() const;
+
+    // 指令在链接前的中间代码中的位置, 运行时错误据此报告; pos 可以等于指令数量, 表示程序结束
+    int line(const int &pos) const;
+
+    bool is_fused() const;
+
+    // 程序指纹, 检查点据此拒绝由其他程序保存的状态
+    unsigned long long fingerprint() const;
+
+private:
+    IR ir_;
+    std::vector<Symbol> constants_;
+    std::vector<LinkedFunction> functions_;
+    std::vector<int> lines_;
+    int global_size_;
+    bool is_fused_;
+    unsigned long long fingerprint_;
+};
+
+#endif //CMM_COMPILED_PROGRAM_H
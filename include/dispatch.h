@@ -0,0 +1,9 @@
+#ifndef CMM_DISPATCH_H
+#define CMM_DISPATCH_H
+
+// 线索化分派依赖 GCC/Clang 的 labels-as-values 扩展, 其他编译器只能使用 switch 分派
+#if defined(CMM_THREADED_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+#define CMM_HAS_THREADED_DISPATCH
+#endif
+
+#endif //CMM_DISPATCH_H
@@ -9,7 +9,7 @@
 // 词法解析器字符不匹配异常
 class lexer_exception : public std::exception {
 public:
-    explicit lexer_exception(const LexerPosition &position, const std::string &msg) : position_(position), msg_(msg) {
+    explicit lexer_exception(const LexerPosition &position, const std::string &msg) : position_(position), message_(msg), msg_(msg) {
         std::stringstream buffer;
         buffer << "第 " << position_.row() << " 行 第 " << position_.col() << " 列: ";
         msg_ = buffer.str() + msg_;
@@ -19,15 +19,21 @@ public:
 
     virtual const char *what() const throw() { return msg_.c_str(); }
 
+    const LexerPosition &position() const { return position_; }
+
+    // 不含位置前缀的错误信息
+    const std::string &message() const { return message_; }
+
 protected:
     LexerPosition position_;
+    std::string message_;
     std::string msg_;
 };
 
 // 语法解析器字符不匹配异常
 class parser_exception : public std::exception {
 public:
-    explicit parser_exception(const TokenPosition &position, const std::string &msg) : position_(position), msg_(msg) {
+    explicit parser_exception(const TokenPosition &position, const std::string &msg) : position_(position), message_(msg), msg_(msg) {
         std::stringstream buffer;
         buffer << "第 " << position_.row() << " 行 第 " << position_.col() << " 列: ";
         msg_ = buffer.str() + msg_;
@@ -37,8 +43,14 @@ public:
 
     virtual const char *what() const throw() { return msg_.c_str(); }
 
+    const TokenPosition &position() const { return position_; }
+
+    // 不含位置前缀的错误信息
+    const std::string &message() const { return message_; }
+
 protected:
     TokenPosition position_;
+    std::string message_;
     std::string msg_;
 };
 
@@ -51,7 +63,7 @@ class scope_critical_error : public std::exception { };
 // 模拟器运行错误
 class simulator_error : public std::exception {
 public:
-    explicit simulator_error(const int &line, const std::string &msg) : line_(line), msg_(msg) {
+    explicit simulator_error(const int &line, const std::string &msg) : line_(line), message_(msg), msg_(msg) {
         std::stringstream buffer;
         buffer << "第 " << line << " 行: ";
         msg_ = buffer.str() + msg_;
@@ -61,8 +73,41 @@ public:
 
     virtual const char *what() const throw() { return msg_.c_str(); }
 
+    // 出错的指令位置
+    int line() const { return line_; }
+
+    // 不含位置前缀的错误信息
+    const std::string &message() const { return message_; }
+
 protected:
     int line_;
+    std::string message_;
+    std::string msg_;
+};
+
+// 检查点文件读写错误
+class snapshot_error : public std::exception {
+public:
+    explicit snapshot_error(const std::string &msg) : msg_(msg) { }
+
+    virtual ~snapshot_error() throw() { }
+
+    virtual const char *what() const throw() { return msg_.c_str(); }
+
+protected:
+    std::string msg_;
+};
+
+// 运行时内存超出配额
+class memory_quota_error : public std::exception {
+public:
+    explicit memory_quota_error(const std::string &msg) : msg_(msg) { }
+
+    virtual ~memory_quota_error() throw() { }
+
+    virtual const char *what() const throw() { return msg_.c_str(); }
+
+protected:
     std::string msg_;
 };
 
@@ -0,0 +1,44 @@
+#ifndef CMM_FUSION_H
+#define CMM_FUSION_H
+
+#include "ir.h"
+
+// 超级指令融合, 在链接后的中间代码上将语义分析生成的常见指令序列替换为一条融合指令, 减少每次循环的分派次数:
+// 1. pushi a; pushi b; addi; popi a  =>  inc a, b        (b 为变量或常量, subi 对应 dec)
+// 2. pushi a; pushi b; cmp<op>i; jz L  =>  cmp_<op>_jz a, b, L
+// 3. pushi b; popi a  =>  movi a, b,  pushr b; popr a  =>  movr a, b
+// 融合指令只替换序列中的第一条指令, 其余指令保留在原位置, 执行融合指令后直接越过它们.
+// 因此所有指令的位置不变, 跳转目标与错误信息中的行号无需调整, 跳转到序列中间时仍按原指令执行
+class Fusion {
+public:
+    Fusion(const IR &ir);
+
+    // 执行融合
+    void fuse();
+
+    // 获取融合后的中间代码
+    const IR &ir() const;
+
+    // 被融合的指令序列数量
+    int fused_count() const;
+
+    // 融合指令所替换的原指令条数
+    static int length(const PCode::Type &type);
+
+private:
+    IR ir_;
+    int fused_count_;
+
+    bool fuse_increment(const int &pos);
+
+    bool fuse_compare_jump(const int &pos);
+
+    bool fuse_move(const int &pos);
+
+    // pos 处的指令是否为指定类型
+    bool is(const int &pos, const PCode::Type &type) const;
+
+    static bool same_address(const Address &first, const Address &second);
+};
+
+#endif //CMM_FUSION_H
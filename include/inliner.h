@@ -0,0 +1,85 @@
+#ifndef CMM_INLINER_H
+#define CMM_INLINER_H
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "ir.h"
+#include "utils.h"
+
+// 函数内联, 在链接前的中间代码上将小的非递归函数的调用替换为函数体, 之后的各种执行方式都使用内联后的中间代码:
+// 1. 形参改为在调用处定义的局部变量, 由 var 定义后按入栈的逆序 pop 取出实参
+// 2. 被调函数中定义的变量与 Label 加上 "@函数名.序号" 后缀以免与调用者冲突, 引用的全局变量保持原名
+// 3. 块的嵌套层次按调用处的层次平移; ret 改为将返回值存入临时变量并跳转至内联代码的末尾, 末尾再将其入栈
+// 含有跳转的函数体只在调用处栈中除实参外为空时内联, 保证跳转两端的栈深度一致
+class Inliner {
+public:
+    // 默认的函数体大小上限 (中间代码条数)
+    static const int kDefaultBudget = 32;
+
+    // 一处已内联的调用
+    struct InlinedCall {
+        std::string caller;
+        std::string callee;
+        int position;                    // 调用在原中间代码中的位置
+        int size;                        // 被调函数体的指令条数
+    };
+
+    Inliner(const IR &ir, const int &budget = kDefaultBudget);
+
+    // 执行内联
+    void run();
+
+    // 获取内联后的中间代码
+    const IR &ir() const;
+
+    const std::vector<InlinedCall> &inlined_calls() const;
+
+    // 输出已内联的调用
+    void print_report(std::ostream &os) const;
+
+private:
+    // 被调函数的信息
+    struct Function {
+        int start;                       // FUNC 所在位置
+        int end;                         // ENDFUNC 所在位置
+        int parameters;                  // 形参个数, 即紧随 FUNC 的 ARG 指令条数
+        int size;                        // 形参之后函数体的指令条数
+        bool has_array_parameter;
+        bool has_control_flow;           // 含有 Label, 跳转, 或不在末尾的 ret
+        bool is_recursive;               // 直接或间接调用自身
+        std::set<std::string> callees;
+        std::set<std::string> globals;   // 函数体中引用的全局变量
+    };
+
+    IR ir_;
+    IR result_;
+    int budget_;
+    std::map<std::string, Function> functions_;
+    std::vector<InlinedCall> inlined_calls_;
+
+    // 收集每个函数的形参, 大小, 调用关系与引用的全局变量
+    void collect();
+
+    void mark_recursion();
+
+    // 函数能否内联到 caller 中
+    bool is_candidate(const std::string &name, const std::string &caller) const;
+
+    // 在 result_ 末尾输出调用 callee 的内联代码, depth 为调用处的块嵌套层次, sequence 为内联序号
+    void expand(const std::string &callee, const int &depth, const int &sequence);
+
+    // 指令对栈深度的影响, 用于判断调用处栈中是否只有实参
+    int stack_effect(const PCode &code) const;
+
+    static bool is_literal(const std::string &name);
+
+    // 指令中 first / second 为变量名的情况
+    static bool has_variable_first(const PCode::Type &type);
+
+    static bool has_variable_second(const PCode::Type &type);
+};
+
+#endif //CMM_INLINER_H
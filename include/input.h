@@ -0,0 +1,235 @@
+#ifndef CMM_INPUT_H
+#define CMM_INPUT_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include "exceptions.h"
+#include "output.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define CMM_HAS_POSIX_READ
+#endif
+
+// read 语句的输入, 按块读入后以空白分隔为记号, 整数与实数均手工解析, 不经过 iostream 的格式化与区域设置
+// 记号不是合法的整数或实数时报错并给出其在输入中的字节偏移; 输入结束后的读取得到 0, 与 std::cin 的行为一致
+// 与 std::cin 绑定 std::cout 相同, 每次从输入源读入新块前先写出绑定的输出缓冲区, 交互时提示总能先于等待输入显示
+class InputReader {
+public:
+    static const int kBlockSize = 1 << 16;
+
+    explicit InputReader(std::istream &is = std::cin) : is_(&is), tied_(nullptr), buffer_(kBlockSize), begin_(0), end_(0), offset_(0), is_eof_(false), token_offset_(0) {
+        token_.reserve(64);
+    }
+
+    InputReader(const InputReader &) = delete;
+
+    InputReader &operator = (const InputReader &) = delete;
+
+    // 更换输入流, 丢弃已读入但未使用的内容
+    void set_stream(std::istream &is) {
+        is_ = &is;
+        begin_ = end_ = 0;
+        offset_ = 0;
+        is_eof_ = false;
+    }
+
+    // 读入新块前写出 output 中的内容
+    void tie(OutputBuffer *output) {
+        tied_ = output;
+    }
+
+    // 读取一个整数, line 为报错时的指令位置
+    int read_integer(const int &line) {
+        if (!next_token()) {
+            return 0;
+        }
+        const char *p = token_.c_str();
+        bool is_negative = *p == '-';
+        if (*p == '+' || *p == '-') {
+            ++p;
+        }
+        if (*p == '\0') {
+            fail(line, "不是合法的整数");
+        }
+        long long value = 0;
+        for (; *p != '\0'; ++p) {
+            if (*p < '0' || *p > '9') {
+                fail(line, "不是合法的整数");
+            }
+            value = value * 10 + (*p - '0');
+            if (value > (long long)INT_MAX + 1) {
+                fail(line, "超出整数的范围");
+            }
+        }
+        if (!is_negative && value > INT_MAX) {
+            fail(line, "超出整数的范围");
+        }
+        return (int)(is_negative ? -value : value);
+    }
+
+    // 读取一个实数, 格式为 [+-]数字[.数字][e[+-]数字], 整数部分与小数部分不能同时为空
+    double read_real(const int &line) {
+        if (!next_token()) {
+            return 0.0;
+        }
+        const char *p = token_.c_str();
+        bool is_negative = *p == '-';
+        if (*p == '+' || *p == '-') {
+            ++p;
+        }
+
+        // 有效数字不超过 19 位且十进制指数不超过 22 时, 尾数与 10 的幂均可精确表示为 double, 一次乘除即得正确舍入的结果
+        unsigned long long mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool has_digit = false;
+        for (; *p >= '0' && *p <= '9'; ++p, has_digit = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa > 0 ? 1 : 0;
+            } else {
+                ++exponent;
+                ++digits;
+            }
+        }
+        if (*p == '.') {
+            for (++p; *p >= '0' && *p <= '9'; ++p, has_digit = true) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits += mantissa > 0 ? 1 : 0;
+                    --exponent;
+                } else {
+                    ++digits;
+                }
+            }
+        }
+        if (!has_digit) {
+            fail(line, "不是合法的实数");
+        }
+        if (*p == 'e' || *p == 'E') {
+            ++p;
+            bool is_negative_exponent = *p == '-';
+            if (*p == '+' || *p == '-') {
+                ++p;
+            }
+            if (*p < '0' || *p > '9') {
+                fail(line, "不是合法的实数");
+            }
+            int value = 0;
+            for (; *p >= '0' && *p <= '9'; ++p) {
+                value = value < 100000 ? value * 10 + (*p - '0') : value;
+            }
+            exponent += is_negative_exponent ? -value : value;
+        }
+        if (*p != '\0') {
+            fail(line, "不是合法的实数");
+        }
+
+        double value;
+        if (digits <= 19 && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+            value = exponent >= 0 ? (double)mantissa * power_of_ten(exponent) : (double)mantissa / power_of_ten(-exponent);
+        } else {
+            // 其余情况交给 strtod 保证正确舍入, 溢出时与 std::cin 一样报错
+            errno = 0;
+            value = std::strtod(token_.c_str() + (token_[0] == '+' || token_[0] == '-' ? 1 : 0), nullptr);
+            if (errno == ERANGE && (value > 1.0 || value < -1.0)) {
+                fail(line, "超出实数的范围");
+            }
+        }
+        return is_negative ? -value : value;
+    }
+
+private:
+    std::istream *is_;
+    OutputBuffer *tied_;
+    std::vector<char> buffer_;
+    int begin_;                          // 缓冲区中下一个未读取的字节
+    int end_;
+    long long offset_;                   // 缓冲区起始处在输入中的字节偏移
+    bool is_eof_;
+    std::string token_;
+    long long token_offset_;
+
+    // 读入新块, 输入结束时返回 false
+    bool refill() {
+        if (is_eof_) {
+            return false;
+        }
+        if (tied_ != nullptr) {
+            tied_->flush();
+        }
+        offset_ += end_;
+        begin_ = end_ = 0;
+        long size = 0;
+#ifdef CMM_HAS_POSIX_READ
+        if (is_ == &std::cin) {
+            // 直接读取标准输入, 交互时得到已输入的一行即返回, 不必等待整块读满
+            do {
+                size = (long)::read(STDIN_FILENO, buffer_.data(), buffer_.size());
+            } while (size < 0 && errno == EINTR);
+        } else {
+            size = (long)is_->rdbuf()->sgetn(buffer_.data(), (std::streamsize)buffer_.size());
+        }
+#else
+        size = (long)is_->rdbuf()->sgetn(buffer_.data(), (std::streamsize)buffer_.size());
+#endif
+        if (size <= 0) {
+            is_eof_ = true;
+            return false;
+        }
+        end_ = (int)size;
+        return true;
+    }
+
+    // 跳过空白并读取下一个记号, 输入结束时返回 false
+    bool next_token() {
+        token_.clear();
+        while (true) {
+            while (begin_ < end_ && is_space(buffer_[begin_])) {
+                ++begin_;
+            }
+            if (begin_ < end_) {
+                break;
+            }
+            if (!refill()) {
+                return false;
+            }
+        }
+        token_offset_ = offset_ + begin_;
+        while (true) {
+            int start = begin_;
+            while (begin_ < end_ && !is_space(buffer_[begin_])) {
+                ++begin_;
+            }
+            token_.append(buffer_.data() + start, (unsigned long)(begin_ - start));
+            // 记号可能跨越块的边界
+            if (begin_ < end_ || !refill()) {
+                return true;
+            }
+        }
+    }
+
+    static bool is_space(const char &c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    static double power_of_ten(const int &exponent) {
+        static const double powers[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+        return powers[exponent];
+    }
+
+    void fail(const int &line, const std::string &reason) {
+        std::string token = token_.size() > 32 ? token_.substr(0, 32) + "..." : token_;
+        throw simulator_error(line, "输入中偏移 " + std::to_string(token_offset_) + " 字节处的 \"" + token + "\" " + reason);
+    }
+};
+
+#endif //CMM_INPUT_H
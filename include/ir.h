@@ -1,9 +1,41 @@
 #ifndef CMM_ICODE_H
 #define CMM_ICODE_H
 
+#include <iostream>
 #include <vector>
 #include <string>
 
+// 操作数地址, 由链接器将中间代码中的变量名解析为 (帧, 槽位) 的形式, 常量则位于常量池中
+class Address {
+public:
+    enum class Frame {
+        kNone = 0,                       // 未链接
+        kGlobal,                         // 全局帧
+        kLocal,                          // 当前函数帧
+        kConstant,                       // 常量池
+    };
+
+    Address() : frame_(Frame::kNone), slot_(0) { }
+
+    Address(const Frame &frame, const int &slot) : frame_(frame), slot_(slot) { }
+
+    const Frame &frame() const {
+        return frame_;
+    }
+
+    int slot() const {
+        return slot_;
+    }
+
+    bool is_linked() const {
+        return frame_ != Frame::kNone;
+    }
+
+private:
+    Frame frame_;
+    int slot_;
+};
+
 class PCode {
 public:
     enum class Type {
@@ -16,8 +48,11 @@ public:
         kReturn,                         // ret
         kEndFunc,                        // ENDFUNC
         kCall,                           // $sum
+        kTailCall,                       // tail $sum, 尾位置的调用, 其后仍保留 ret
 
         kLabel,                          // Label1:
+        kEnterScope,                     // enter_scope 2
+        kLeaveScope,                     // leave_scope 2
 
         kVarInteger,                     // vari a
         kVarIntegerArray,                // varia a, b || varia a, 5
@@ -35,18 +70,30 @@ public:
         kPopReal,                        // popr a
         kPopRealArray,                   // popra a, 6
 
-        kAdd,                            // add
-        kSub,                            // sub
-        kMul,                            // mul
-        kDiv,                            // div
-        kMod,                            // mod
-
-        kCompareEqual,                   // cmpeq
-        kCompareNotEqual,                // cmpne
-        kCompareGreaterThan,             // cmpgt
-        kCompareLessThan,                // cmplt
-        kCompareGreaterEqual,            // cmpge
-        kCompareLessEqual,               // cmple
+        // 算术与比较指令由语义分析按静态类型选择, 执行时无需检查操作数类型
+        kAddInteger,                     // addi
+        kAddReal,                        // addr
+        kSubInteger,                     // subi
+        kSubReal,                        // subr
+        kMulInteger,                     // muli
+        kMulReal,                        // mulr
+        kDivInteger,                     // divi
+        kDivReal,                        // divr
+
+        kCompareEqualInteger,            // cmpeqi
+        kCompareEqualReal,               // cmpeqr
+        kCompareNotEqualInteger,         // cmpnei
+        kCompareNotEqualReal,            // cmpner
+        kCompareGreaterThanInteger,      // cmpgti
+        kCompareGreaterThanReal,         // cmpgtr
+        kCompareLessThanInteger,         // cmplti
+        kCompareLessThanReal,            // cmpltr
+        kCompareGreaterEqualInteger,     // cmpgei
+        kCompareGreaterEqualReal,        // cmpger
+        kCompareLessEqualInteger,        // cmplei
+        kCompareLessEqualReal,           // cmpler
+
+        kIntegerToReal,                  // i2r
 
         kAnd,                            // and
         kOr,                             // or
@@ -64,6 +111,18 @@ public:
         kReadRealArray,                  // readra
 
         kExit,                           // exit
+
+        // 由超级指令融合生成的指令, 见 Fusion
+        kIncrementInteger,               // inc a, b         <=  pushi a; pushi b; addi; popi a
+        kDecrementInteger,               // dec a, b         <=  pushi a; pushi b; subi; popi a
+        kMoveInteger,                    // movi a, b        <=  pushi b; popi a
+        kMoveReal,                       // movr a, b        <=  pushr b; popr a
+        kCompareEqualJumpZero,           // cmp_eq_jz a, b, L  <=  pushi a; pushi b; cmpeqi; jz L
+        kCompareNotEqualJumpZero,        // cmp_ne_jz a, b, L
+        kCompareGreaterThanJumpZero,     // cmp_gt_jz a, b, L
+        kCompareLessThanJumpZero,        // cmp_lt_jz a, b, L
+        kCompareGreaterEqualJumpZero,    // cmp_ge_jz a, b, L
+        kCompareLessEqualJumpZero,       // cmp_le_jz a, b, L
     };
 
     PCode(const int &indent = 4) : type_(Type::kNone), indent_(indent) { }
@@ -96,6 +155,18 @@ public:
         return indent_;
     }
 
+    const Address &first_address() const {
+        return first_address_;
+    }
+
+    const Address &second_address() const {
+        return second_address_;
+    }
+
+    int target() const {
+        return target_;
+    }
+
     void set(const Type &type) {
         type_ = type;
     }
@@ -122,6 +193,18 @@ public:
         indent_ = indent;
     }
 
+    void set_first_address(const Address &address) {
+        first_address_ = address;
+    }
+
+    void set_second_address(const Address &address) {
+        second_address_ = address;
+    }
+
+    void set_target(const int &target) {
+        target_ = target;
+    }
+
     static std::ostream &print_indent(std::ostream &os, const PCode &pcode) {
         if (pcode.type() != Type::kStartFunc && pcode.type() != Type::kEndFunc && pcode.type() != Type::kLabel) {
             for (int i = 0; i < pcode.indent(); ++i) {
@@ -161,9 +244,18 @@ public:
             case Type::kCall:
                 os << "$" << pcode.first();
                 break;
+            case Type::kTailCall:
+                os << "tail $" << pcode.first();
+                break;
             case Type::kLabel:
                 os << pcode.first() << ":";
                 break;
+            case Type::kEnterScope:
+                os << "enter_scope " << pcode.first();
+                break;
+            case Type::kLeaveScope:
+                os << "leave_scope " << pcode.first();
+                break;
             case Type::kVarInteger:
                 os << "vari " << pcode.first();
                 break;
@@ -203,38 +295,68 @@ public:
             case Type::kPopRealArray:
                 os << "pop_arr " << pcode.first() << ", " << pcode.second();
                 break;
-            case Type::kAdd:
-                os << "add";
+            case Type::kAddInteger:
+                os << "addi";
+                break;
+            case Type::kAddReal:
+                os << "addr";
+                break;
+            case Type::kSubInteger:
+                os << "subi";
+                break;
+            case Type::kSubReal:
+                os << "subr";
+                break;
+            case Type::kMulInteger:
+                os << "muli";
+                break;
+            case Type::kMulReal:
+                os << "mulr";
+                break;
+            case Type::kDivInteger:
+                os << "divi";
+                break;
+            case Type::kDivReal:
+                os << "divr";
+                break;
+            case Type::kCompareEqualInteger:
+                os << "cmpeqi";
                 break;
-            case Type::kSub:
-                os << "sub";
+            case Type::kCompareEqualReal:
+                os << "cmpeqr";
                 break;
-            case Type::kMul:
-                os << "mul";
+            case Type::kCompareNotEqualInteger:
+                os << "cmpnei";
                 break;
-            case Type::kDiv:
-                os << "div";
+            case Type::kCompareNotEqualReal:
+                os << "cmpner";
                 break;
-            case Type::kMod:
-                os << "mod";
+            case Type::kCompareGreaterThanInteger:
+                os << "cmpgti";
                 break;
-            case Type::kCompareEqual:
-                os << "cmpeq";
+            case Type::kCompareGreaterThanReal:
+                os << "cmpgtr";
                 break;
-            case Type::kCompareNotEqual:
-                os << "cmpne";
+            case Type::kCompareLessThanInteger:
+                os << "cmplti";
                 break;
-            case Type::kCompareGreaterThan:
-                os << "cmpgt";
+            case Type::kCompareLessThanReal:
+                os << "cmpltr";
                 break;
-            case Type::kCompareLessThan:
-                os << "cmplt";
+            case Type::kCompareGreaterEqualInteger:
+                os << "cmpgei";
                 break;
-            case Type::kCompareGreaterEqual:
-                os << "cmpge";
+            case Type::kCompareGreaterEqualReal:
+                os << "cmpger";
                 break;
-            case Type::kCompareLessEqual:
-                os << "cmple";
+            case Type::kCompareLessEqualInteger:
+                os << "cmplei";
+                break;
+            case Type::kCompareLessEqualReal:
+                os << "cmpler";
+                break;
+            case Type::kIntegerToReal:
+                os << "i2r";
                 break;
             case Type::kAnd:
                 os << "and";
@@ -275,16 +397,110 @@ public:
             case Type::kExit:
                 os << "exit " << pcode.first();
                 break;
+            case Type::kIncrementInteger:
+            case Type::kDecrementInteger:
+            case Type::kMoveInteger:
+            case Type::kMoveReal:
+                os << mnemonic(pcode.type()) << " " << pcode.first() << ", " << pcode.second();
+                break;
+            case Type::kCompareEqualJumpZero:
+            case Type::kCompareNotEqualJumpZero:
+            case Type::kCompareGreaterThanJumpZero:
+            case Type::kCompareLessThanJumpZero:
+            case Type::kCompareGreaterEqualJumpZero:
+            case Type::kCompareLessEqualJumpZero:
+                os << mnemonic(pcode.type()) << " " << pcode.first() << ", " << pcode.second() << ", " << pcode.third();
+                break;
         }
         return os;
     }
 
+    // 指令的助记符, 不含操作数
+    static const char *mnemonic(const Type &type) {
+        switch (type) {
+            case Type::kNone: return "none";
+            case Type::kStartFunc: return "FUNC";
+            case Type::kArgInteger: return "argi";
+            case Type::kArgIntegerArray: return "argia";
+            case Type::kArgReal: return "argr";
+            case Type::kArgRealArray: return "argra";
+            case Type::kReturn: return "ret";
+            case Type::kEndFunc: return "ENDFUNC";
+            case Type::kCall: return "call";
+            case Type::kTailCall: return "tailcall";
+            case Type::kLabel: return "label";
+            case Type::kEnterScope: return "enter_scope";
+            case Type::kLeaveScope: return "leave_scope";
+            case Type::kVarInteger: return "vari";
+            case Type::kVarIntegerArray: return "varia";
+            case Type::kVarReal: return "varr";
+            case Type::kVarRealArray: return "varra";
+            case Type::kPushInteger: return "pushi";
+            case Type::kPushIntegerArray: return "pushia";
+            case Type::kPushReal: return "pushr";
+            case Type::kPushRealArray: return "pushra";
+            case Type::kPop: return "pop";
+            case Type::kPopInteger: return "popi";
+            case Type::kPopIntegerArray: return "popia";
+            case Type::kPopReal: return "popr";
+            case Type::kPopRealArray: return "popra";
+            case Type::kAddInteger: return "addi";
+            case Type::kAddReal: return "addr";
+            case Type::kSubInteger: return "subi";
+            case Type::kSubReal: return "subr";
+            case Type::kMulInteger: return "muli";
+            case Type::kMulReal: return "mulr";
+            case Type::kDivInteger: return "divi";
+            case Type::kDivReal: return "divr";
+            case Type::kCompareEqualInteger: return "cmpeqi";
+            case Type::kCompareEqualReal: return "cmpeqr";
+            case Type::kCompareNotEqualInteger: return "cmpnei";
+            case Type::kCompareNotEqualReal: return "cmpner";
+            case Type::kCompareGreaterThanInteger: return "cmpgti";
+            case Type::kCompareGreaterThanReal: return "cmpgtr";
+            case Type::kCompareLessThanInteger: return "cmplti";
+            case Type::kCompareLessThanReal: return "cmpltr";
+            case Type::kCompareGreaterEqualInteger: return "cmpgei";
+            case Type::kCompareGreaterEqualReal: return "cmpger";
+            case Type::kCompareLessEqualInteger: return "cmplei";
+            case Type::kCompareLessEqualReal: return "cmpler";
+            case Type::kIntegerToReal: return "i2r";
+            case Type::kAnd: return "and";
+            case Type::kOr: return "or";
+            case Type::kNot: return "not";
+            case Type::kNegative: return "neg";
+            case Type::kJump: return "jmp";
+            case Type::kJumpZero: return "jz";
+            case Type::kJumpNotZero: return "jnz";
+            case Type::kPrint: return "print";
+            case Type::kReadInt: return "readi";
+            case Type::kReadIntArray: return "readia";
+            case Type::kReadReal: return "readr";
+            case Type::kReadRealArray: return "readra";
+            case Type::kExit: return "exit";
+            case Type::kIncrementInteger: return "inc";
+            case Type::kDecrementInteger: return "dec";
+            case Type::kMoveInteger: return "movi";
+            case Type::kMoveReal: return "movr";
+            case Type::kCompareEqualJumpZero: return "cmp_eq_jz";
+            case Type::kCompareNotEqualJumpZero: return "cmp_ne_jz";
+            case Type::kCompareGreaterThanJumpZero: return "cmp_gt_jz";
+            case Type::kCompareLessThanJumpZero: return "cmp_lt_jz";
+            case Type::kCompareGreaterEqualJumpZero: return "cmp_ge_jz";
+            case Type::kCompareLessEqualJumpZero: return "cmp_le_jz";
+        }
+        return "unknown";
+    }
+
 private:
     Type type_;
     std::string first_;
     std::string second_;
     std::string third_;
     int indent_;
+    Address first_address_;   // first_ 为变量时链接后的地址
+    Address second_address_;  // second_ 为变量时链接后的地址
+    int target_ = -1;         // 链接后的跳转目标位置或被调用函数的编号
 };
 
 class IR {
@@ -295,10 +511,19 @@ public:
         ir_.push_back(pcode);
     }
 
+    // 在 pos 处插入一条中间代码
+    void insert(int pos, const PCode &pcode) {
+        ir_.insert(ir_.begin() + pos, pcode);
+    }
+
     const PCode &at(int pos) const {
         return ir_.at((unsigned long)pos);
     }
 
+    PCode &at(int pos) {
+        return ir_.at((unsigned long)pos);
+    }
+
     int size() const {
         return (int)ir_.size();
     }
@@ -0,0 +1,70 @@
+#ifndef CMM_JIT_H
+#define CMM_JIT_H
+
+#include <vector>
+#include "bytecode.h"
+#include "value.h"
+
+// 即时编译器只生成 x86-64 代码, 且依赖 Linux 的 mmap/mprotect 分配可执行内存
+#if defined(CMM_JIT) && defined(__x86_64__) && defined(__linux__)
+#define CMM_HAS_JIT
+#endif
+
+// 将寄存器虚拟机的函数翻译为 x86-64 本地代码
+// 本地代码直接读写虚拟机的寄存器区, 全局区与数组元素, 常用的整数与实数局部寄存器常驻机器寄存器;
+// 函数调用, 定义数组和输入输出通过辅助函数回到虚拟机完成; 含有无法翻译的指令的函数保持由解释器执行
+class Jit {
+public:
+    // 本地代码入口, 返回 0 表示正常返回且返回值已写入 result, 非零表示出错
+    typedef int (*NativeFunction)(void *simulator, Value *base, Value *globals, Value *result);
+
+    // 本地代码直接访问的数组: 元素的起始地址与数量, 虚拟机按数组句柄排列成表
+    struct ArrayView {
+        Value *elements;
+        long long size;
+    };
+
+    // 本地代码调用的辅助函数, 参数均为 (虚拟机, 当前帧寄存器, 指令位置)
+    struct Helpers {
+        Value *(*call)(void *, Value *, int);          // 执行调用, 返回调用者的寄存器, 出错时返回空指针
+        int (*execute)(void *, Value *, int);          // 执行定义数组和输入输出指令, 出错时返回非零值
+        void (*fail)(void *, Value *, int);            // 记录指令的运行时错误
+        ArrayView *const *arrays;                      // 数组表的位置, 表在辅助函数中可能重新分配, 返回后重新读取
+    };
+
+    Jit() : memory_(nullptr), memory_size_(0) { }
+
+    ~Jit();
+
+    Jit(const Jit &) = delete;
+
+    Jit &operator = (const Jit &) = delete;
+
+    // 当前平台是否支持即时编译
+    static bool is_supported();
+
+    // 编译程序中所有可翻译的函数, 入口函数除外
+    void compile(const BytecodeProgram &program, const Helpers &helpers);
+
+    // 获取函数的本地代码, 未编译时返回空指针
+    NativeFunction function(const int &index) const {
+        return index < (int)functions_.size() ? functions_[index] : nullptr;
+    }
+
+    // 存放本地代码的可执行内存字节数
+    unsigned long code_size() const {
+        return memory_size_;
+    }
+
+private:
+    void *memory_;
+    unsigned long memory_size_;
+    std::vector<NativeFunction> functions_;
+
+    void release();
+
+    // 函数中的指令是否都能翻译
+    static bool is_compilable(const BytecodeProgram &program, const int &begin, const int &end);
+};
+
+#endif //CMM_JIT_H
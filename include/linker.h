@@ -0,0 +1,131 @@
+#ifndef CMM_LINKER_H
+#define CMM_LINKER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "ir.h"
+#include "symbol.h"
+#include "exceptions.h"
+#include "utils.h"
+
+// 链接后的函数信息
+class LinkedFunction {
+public:
+    LinkedFunction(const std::string &name, const int &start) : name_(name), start_(start), end_(-1), frame_size_(0) { }
+
+    const std::string &name() const {
+        return name_;
+    }
+
+    // FUNC 所在位置
+    int start() const {
+        return start_;
+    }
+
+    // ENDFUNC 所在位置
+    int end() const {
+        return end_;
+    }
+
+    // 函数帧所需的槽位数量
+    int frame_size() const {
+        return frame_size_;
+    }
+
+    void set_start(const int &start) {
+        start_ = start;
+    }
+
+    void set_end(const int &end) {
+        end_ = end;
+    }
+
+    void set_frame_size(const int &frame_size) {
+        frame_size_ = frame_size;
+    }
+
+private:
+    std::string name_;
+    int start_;
+    int end_;
+    int frame_size_;
+};
+
+// 链接器, 在模拟器运行前完成以下工作:
+// 1. 将中间代码中的变量名解析为 (帧, 槽位) 地址. 全局变量位于全局帧中, 函数的形参及其内部所有块中定义的变量统一位于该函数的帧中
+// 2. 将所有字面量预先解码至常量池中
+// 3. 将 Label 和函数名解析为跳转目标位置和函数编号
+// 4. 可选地删除 Label 与块标记, 它们在完成以上工作后不再有任何作用
+class Linker {
+public:
+    Linker(const IR &ir);
+
+    // 执行链接
+    void link();
+
+    // 删除 Label, enter_scope 与 leave_scope 并重新计算跳转目标与函数位置, 须在 link 之后调用
+    void strip();
+
+    // 获取链接后的中间代码
+    const IR &ir() const;
+
+    // 全局帧所需的槽位数量
+    int global_size() const;
+
+    // 常量池
+    const std::vector<Symbol> &constants() const;
+
+    // 所有函数, 下标即为函数编号
+    const std::vector<LinkedFunction> &functions() const;
+
+    // 每条指令对应的链接前位置, 末尾多出一项对应程序结束; 未调用 strip 时与位置相同
+    const std::vector<int> &lines() const;
+
+private:
+    IR ir_;
+    std::vector<std::map<std::string, Address> > scopes_;  // 静态作用域栈, 栈底为全局作用域
+    std::vector<int> scope_marks_;                          // 每层作用域进入时的槽位分配位置
+    std::vector<Symbol> constants_;
+    std::map<std::string, int> constant_table_;             // 字面量在常量池中的位置, 以类型前缀区分整数与实数
+    std::vector<LinkedFunction> functions_;
+    std::map<std::string, int> function_table_;             // 函数名对应的函数编号
+    std::map<std::string, int> label_table_;                // Label 所在位置
+    std::vector<int> lines_;
+    int global_size_;
+    int local_size_;                                        // 当前函数帧已分配的槽位
+    int max_local_size_;                                    // 当前函数帧的最大槽位数量
+
+    // 记录所有 Label 和函数的位置
+    void collect_targets();
+
+    // 解析变量地址与字面量
+    void link_operands();
+
+    void push_scope();
+
+    void pop_scope();
+
+    // 在当前作用域中定义变量并分配槽位
+    Address define(const std::string &name);
+
+    // 查找变量所在地址
+    Address resolve(const int &pos, const std::string &name);
+
+    // 将整数字面量或变量解析为地址
+    Address resolve_integer(const int &pos, const std::string &name);
+
+    // 将实数字面量或变量解析为地址
+    Address resolve_real(const int &pos, const std::string &name);
+
+    // 将字面量加入常量池, 相同的字面量只保存一份
+    Address constant(const std::string &key, const Symbol &value);
+
+    // 解析跳转目标
+    int label_target(const int &pos, const std::string &name);
+
+    // 解析被调用函数
+    int function_target(const int &pos, const std::string &name);
+};
+
+#endif //CMM_LINKER_H
@@ -0,0 +1,110 @@
+#ifndef CMM_LOWERING_H
+#define CMM_LOWERING_H
+
+#include <vector>
+#include <string>
+#include "ir.h"
+#include "linker.h"
+#include "bytecode.h"
+#include "value.h"
+#include "exceptions.h"
+
+// 将链接后的栈式中间代码翻译为寄存器虚拟机的三地址指令
+// 翻译时维护一个编译期的虚拟栈: 变量和常量入栈时不生成指令, 仅记录其操作数; 运算结果存放于栈深度对应的临时寄存器中.
+// 赋值时若右值恰为上一条指令的结果且类型与变量一致, 直接将该指令的目标改写为变量, 因此 a = a + b 只需要一条指令
+class Lowering {
+public:
+    Lowering(const Linker &linker);
+
+    // 执行翻译
+    void lower();
+
+    // 获取翻译后的程序
+    const BytecodeProgram &program() const;
+
+private:
+    // 虚拟栈中的元素
+    struct StackEntry {
+        enum class Kind {
+            kTemp = 0,                   // 临时寄存器
+            kVariable,                   // 变量
+            kConstant,                   // 常量
+        };
+
+        Kind kind;
+        int operand;
+        Value::Type type;                // 静态类型, kNone 表示运行时才能确定 (如函数返回值)
+        int pc;                          // 临时寄存器由哪条指令写入
+    };
+
+    IR ir_;
+    std::vector<LinkedFunction> functions_;
+    BytecodeProgram program_;
+    std::vector<StackEntry> stack_;
+    std::vector<int> pc_of_;                       // 每条中间代码翻译后的起始位置
+    std::vector<int> jumps_;                       // 当前函数中待回填跳转目标的指令
+    std::vector<Value::Type> global_types_;        // 全局变量的类型
+    std::vector<Value::Type> slot_types_;          // 当前函数中每个槽位最近一次定义的类型
+    std::vector<char> global_assigned_;            // 在首次调用函数前已赋值的全局变量
+    std::vector<char> top_assigned_;               // 翻译全局语句时已赋值的全局变量
+    std::vector<std::vector<char> > assigned_;     // 当前函数中每条中间代码执行前一定已赋值的局部变量
+    bool in_function_;
+    int begin_;                                    // 当前函数第一条中间代码的位置
+    int frame_size_;
+    int max_depth_;                                // 当前函数虚拟栈的最大深度
+
+    // 收集全局变量类型, 函数形参, 以及首次调用函数前已赋值的全局变量
+    void prepare();
+
+    // 翻译全局语句, 作为程序入口函数
+    void lower_entry();
+
+    // 翻译函数体
+    void lower_function(const int &index);
+
+    void begin_function(const int &frame_size);
+
+    void end_function(const int &function);
+
+    // 分析函数中每个位置一定已赋值的局部变量, 据此省略未初始化检查
+    void analyse_assignment(const int &begin, const int &end);
+
+    // 翻译一条中间代码
+    void lower_instruction(const int &pos);
+
+    void lower_binary(const int &pos, const Bytecode::Type &type, const Value::Type &result);
+
+    void lower_integer_to_real(const int &pos);
+
+    void lower_store(const int &pos, const Address &address);
+
+    void lower_jump_zero(const int &pos, const PCode &code);
+
+    void lower_call(const int &pos, const PCode &code);
+
+    int emit(const Bytecode &code, const int &pos);
+
+    StackEntry pop(const int &pos);
+
+    void push(const StackEntry::Kind &kind, const int &operand, const Value::Type &type, const int &pc);
+
+    // 栈中第 depth 个元素对应的临时寄存器
+    int temp(const int &depth);
+
+    // 将栈中第 depth 个元素复制到临时寄存器中
+    void materialize(const int &depth, const int &pos);
+
+    int operand(const Address &address) const;
+
+    Value::Type declared_type(const Address &address) const;
+
+    void declare(const Address &address, const Value::Type &type);
+
+    bool is_assigned(const int &pos, const Address &address) const;
+
+    void set_assigned(const Address &address, const bool &assigned);
+
+    int constant(const Value &value);
+};
+
+#endif //CMM_LOWERING_H
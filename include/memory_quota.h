@@ -0,0 +1,111 @@
+#ifndef CMM_MEMORY_QUOTA_H
+#define CMM_MEMORY_QUOTA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <string>
+#include "exceptions.h"
+
+// 运行时内存配额, 记录经由 AccountingAllocator 或显式记账的字节数及其峰值
+// 配额为 0 表示不限; 申请将使用量推过配额时抛出 memory_quota_error 且不分配, 由虚拟机转为带指令位置的 simulator_error
+class MemoryQuota {
+public:
+    MemoryQuota() : limit_(0), used_(0), peak_(0) { }
+
+    MemoryQuota(const MemoryQuota &) = delete;
+
+    MemoryQuota &operator = (const MemoryQuota &) = delete;
+
+    void set_limit(const unsigned long long &limit) {
+        limit_ = limit;
+    }
+
+    unsigned long long limit() const {
+        return limit_;
+    }
+
+    unsigned long long used() const {
+        return used_;
+    }
+
+    unsigned long long peak() const {
+        return peak_;
+    }
+
+    // 记入 bytes 字节, 超出配额时抛出异常
+    void allocate(const unsigned long long &bytes) {
+        if (limit_ > 0 && bytes > limit_ - std::min(used_, limit_)) {
+            throw memory_quota_error("内存使用超出配额 " + std::to_string(limit_) + " 字节 (已使用 " + std::to_string(used_) +
+                                     " 字节, 本次申请 " + std::to_string(bytes) + " 字节)");
+        }
+        used_ += bytes;
+        if (used_ > peak_) {
+            peak_ = used_;
+        }
+    }
+
+    void release(const unsigned long long &bytes) {
+        used_ -= bytes < used_ ? bytes : used_;
+    }
+
+private:
+    unsigned long long limit_;
+    unsigned long long used_;
+    unsigned long long peak_;
+};
+
+// 按 MemoryQuota 记账的分配器, 用于虚拟机自身的寄存器区, 槽位, 调用栈, 操作数栈与数组堆
+// 默认构造时不关联配额, 与 std::allocator 相同; 同一配额下的分配器相等, 容器间可以交换与移动存储
+template <typename T>
+class AccountingAllocator {
+public:
+    typedef T value_type;
+
+    AccountingAllocator() : quota_(nullptr) { }
+
+    explicit AccountingAllocator(MemoryQuota *quota) : quota_(quota) { }
+
+    template <typename U>
+    AccountingAllocator(const AccountingAllocator<U> &other) : quota_(other.quota()) { }
+
+    T *allocate(const std::size_t &n) {
+        if (quota_ != nullptr) {
+            quota_->allocate((unsigned long long)n * sizeof(T));
+        }
+        try {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        } catch (const std::bad_alloc &e) {
+            if (quota_ != nullptr) {
+                quota_->release((unsigned long long)n * sizeof(T));
+            }
+            throw;
+        }
+    }
+
+    void deallocate(T *p, const std::size_t &n) {
+        if (quota_ != nullptr) {
+            quota_->release((unsigned long long)n * sizeof(T));
+        }
+        ::operator delete(p);
+    }
+
+    MemoryQuota *quota() const {
+        return quota_;
+    }
+
+private:
+    MemoryQuota *quota_;
+};
+
+template <typename T, typename U>
+bool operator == (const AccountingAllocator<T> &left, const AccountingAllocator<U> &right) {
+    return left.quota() == right.quota();
+}
+
+template <typename T, typename U>
+bool operator != (const AccountingAllocator<T> &left, const AccountingAllocator<U> &right) {
+    return left.quota() != right.quota();
+}
+
+#endif //CMM_MEMORY_QUOTA_H
@@ -0,0 +1,77 @@
+#ifndef CMM_OPCODE_STATISTICS_H
+#define CMM_OPCODE_STATISTICS_H
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "ir.h"
+
+// 统计实际运行中连续执行的指令序列 (n-gram) 的出现次数, 用于挑选值得融合的指令序列
+// 每条指令执行前记录一次, 以其结尾的长度为 1 至 n 的序列各计数一次; 序列按指令类型编码为整数, 每个类型占 8 位
+class OpcodeStatistics {
+public:
+    // n-gram 的最大长度
+    static const int kMaxLength = 8;
+
+    OpcodeStatistics(const int &length = 0) {
+        reset(length);
+    }
+
+    void reset(const int &length) {
+        length_ = length < 0 ? 0 : (length > kMaxLength ? (int)kMaxLength : length);
+        history_ = 0;
+        recorded_ = 0;
+        counts_.assign((unsigned long)length_, std::unordered_map<unsigned long long, long long>());
+    }
+
+    bool is_enabled() const {
+        return length_ > 0;
+    }
+
+    void record(const PCode::Type &type) {
+        history_ = (history_ << 8) | (unsigned long long)type;
+        ++recorded_;
+        long long available = std::min(recorded_, (long long)length_);
+        for (int n = 1; n <= available; ++n) {
+            ++counts_[n - 1][n == kMaxLength ? history_ : history_ & ((1ull << (8 * n)) - 1)];
+        }
+    }
+
+    // 按出现次数从高到低输出每种长度的前 top 个序列
+    void print(std::ostream &os, const int &top = 20) const {
+        std::ios::fmtflags flags = os.flags();
+        std::streamsize precision = os.precision();
+        os << "指令序列统计 (共执行 " << recorded_ << " 条指令):" << std::endl;
+        for (int n = 1; n <= length_; ++n) {
+            std::vector<std::pair<long long, unsigned long long> > grams;
+            for (const auto &item : counts_[n - 1]) {
+                grams.push_back(std::make_pair(item.second, item.first));
+            }
+            std::sort(grams.begin(), grams.end(), [](const std::pair<long long, unsigned long long> &a, const std::pair<long long, unsigned long long> &b) {
+                return a.first != b.first ? a.first > b.first : a.second < b.second;
+            });
+
+            os << std::endl << n << "-gram:" << std::endl;
+            for (int i = 0; i < (int)grams.size() && i < top; ++i) {
+                double percent = recorded_ > 0 ? 100.0 * grams[i].first / recorded_ : 0.0;
+                os << std::setw(12) << grams[i].first << std::setw(9) << std::fixed << std::setprecision(2) << percent << "%  ";
+                for (int k = n - 1; k >= 0; --k) {
+                    os << PCode::mnemonic((PCode::Type)((grams[i].second >> (8 * k)) & 0xff)) << (k > 0 ? "; " : "");
+                }
+                os << std::endl;
+            }
+        }
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+private:
+    int length_;
+    unsigned long long history_;         // 最近执行的指令类型, 最低 8 位为最近一条
+    long long recorded_;
+    std::vector<std::unordered_map<unsigned long long, long long> > counts_;
+};
+
+#endif //CMM_OPCODE_STATISTICS_H
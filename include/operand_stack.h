@@ -0,0 +1,84 @@
+#ifndef CMM_OPERAND_STACK_H
+#define CMM_OPERAND_STACK_H
+
+#include <vector>
+#include "value.h"
+#include "memory_quota.h"
+
+// 栈式虚拟机的操作数栈, 预先分配一段连续内存, 出入栈只移动栈顶指针
+// 递归调用时未完成的表达式会留在栈中, 因此栈满时按倍数扩容, 扩容只发生在慢路径上
+class OperandStack {
+public:
+    // quota 不为空时栈的存储计入该配额
+    explicit OperandStack(MemoryQuota *quota = nullptr, const int capacity = kDefaultCapacity) :
+            data_((unsigned long)capacity, Value(), AccountingAllocator<Value>(quota)) {
+        top_ = data_.data();
+        end_ = top_ + data_.size();
+    }
+
+    OperandStack(const OperandStack &other) : data_(other.data_) {
+        top_ = data_.data() + other.size();
+        end_ = data_.data() + data_.size();
+    }
+
+    OperandStack &operator = (const OperandStack &other) {
+        if (this != &other) {
+            data_ = other.data_;
+            top_ = data_.data() + other.size();
+            end_ = data_.data() + data_.size();
+        }
+        return *this;
+    }
+
+    void push_back(const Value &value) {
+        if (top_ == end_) {
+            grow();
+        }
+        *top_++ = value;
+    }
+
+    void pop_back() {
+        --top_;
+    }
+
+    Value &back() {
+        return top_[-1];
+    }
+
+    const Value &back() const {
+        return top_[-1];
+    }
+
+    // 自栈底起的第 index 个值
+    const Value &at(const int &index) const {
+        return data_[index];
+    }
+
+    int size() const {
+        return (int)(top_ - data_.data());
+    }
+
+    bool empty() const {
+        return top_ == data_.data();
+    }
+
+    void clear() {
+        top_ = data_.data();
+    }
+
+private:
+    static const int kDefaultCapacity = 1024;
+
+    std::vector<Value, AccountingAllocator<Value> > data_;
+    Value *top_;
+    Value *end_;
+
+    void grow() {
+        int size = this->size();
+        data_.resize(data_.size() * 2);
+        top_ = data_.data() + size;
+        end_ = data_.data() + data_.size();
+    }
+};
+
+#endif //CMM_OPERAND_STACK_H
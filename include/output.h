@@ -0,0 +1,139 @@
+#ifndef CMM_OUTPUT_H
+#define CMM_OUTPUT_H
+
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+// write 语句的输出缓冲区, 输出先写入用户空间的大缓冲区, 只在缓冲区将满, 读取输入前与运行结束时写出到输出流,
+// 不经过 iostream 的格式化与区域设置, 也不在每次输出后刷新
+// 整数与绝对值小于 1e15 的整数值实数逐位手工转换; 其余实数依次尝试 15, 16, 17 位有效数字, 取最短的能还原为原值的表示
+class OutputBuffer {
+public:
+    static const int kCapacity = 1 << 16;
+
+    explicit OutputBuffer(std::ostream &os = std::cout) : os_(&os), buffer_(kCapacity), size_(0) { }
+
+    OutputBuffer(const OutputBuffer &) = delete;
+
+    OutputBuffer &operator = (const OutputBuffer &) = delete;
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    // 更换输出流, 先写出已缓冲的内容
+    void set_stream(std::ostream &os) {
+        flush();
+        os_ = &os;
+    }
+
+    void write(const int &value) {
+        reserve(kMaxIntegerLength + 1);
+        size_ += format_integer(value, buffer_.data() + size_);
+        buffer_[size_++] = '\n';
+    }
+
+    void write(const double &value) {
+        reserve(kMaxRealLength + 1);
+        size_ += format_real(value, buffer_.data() + size_);
+        buffer_[size_++] = '\n';
+    }
+
+    // 写出已缓冲的内容
+    void flush() {
+        if (size_ > 0) {
+            os_->write(buffer_.data(), size_);
+            os_->flush();
+            size_ = 0;
+        }
+    }
+
+    // 将整数写入 out, 返回写入的字符数
+    static int format_integer(const long long &value, char *out) {
+        const char *pairs = digit_pairs();
+        char digits[kMaxIntegerLength];
+        unsigned long long rest = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+        int length = 0;
+        // 每次转换两位, 减少除法次数
+        while (rest >= 100) {
+            unsigned long long pair = rest % 100;
+            rest /= 100;
+            digits[length++] = pairs[pair * 2 + 1];
+            digits[length++] = pairs[pair * 2];
+        }
+        if (rest >= 10) {
+            digits[length++] = pairs[rest * 2 + 1];
+            digits[length++] = pairs[rest * 2];
+        } else {
+            digits[length++] = (char)('0' + rest);
+        }
+
+        int size = 0;
+        if (value < 0) {
+            out[size++] = '-';
+        }
+        while (length > 0) {
+            out[size++] = digits[--length];
+        }
+        return size;
+    }
+
+    // 将实数按最短的可还原表示写入 out, 布局与 printf 的 %g 相同, 返回写入的字符数
+    static int format_real(const double &value, char *out) {
+        if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 1e15) {
+            // 此时 %.15g 不使用指数形式, 输出即为整数的各位
+            if (value == 0 && std::signbit(value)) {
+                out[0] = '-';
+                out[1] = '0';
+                return 2;
+            }
+            return format_integer((long long)value, out);
+        }
+        if (!std::isfinite(value)) {
+            return std::snprintf(out, kMaxRealLength, "%g", value);
+        }
+        // 15 位以内的十进制数总能由 double 还原, 因此按 15 位输出能还原时即为最短表示
+        int size = 0;
+        for (int precision = 15; precision <= 17; ++precision) {
+            size = std::snprintf(out, kMaxRealLength, "%.*g", precision, value);
+            if (std::strtod(out, nullptr) == value) {
+                break;
+            }
+        }
+        return size;
+    }
+
+private:
+    static const int kMaxIntegerLength = 24;
+    static const int kMaxRealLength = 32;
+
+    // 00 至 99 的两位数字表
+    static const char *digit_pairs() {
+        return "00010203040506070809"
+               "10111213141516171819"
+               "20212223242526272829"
+               "30313233343536373839"
+               "40414243444546474849"
+               "50515253545556575859"
+               "60616263646566676869"
+               "70717273747576777879"
+               "80818283848586878889"
+               "90919293949596979899";
+    }
+
+    std::ostream *os_;
+    std::vector<char> buffer_;
+    int size_;
+
+    // 保证缓冲区中至少还有 size 个字节的空间
+    void reserve(const int &size) {
+        if (size_ + size > (int)buffer_.size()) {
+            flush();
+        }
+    }
+};
+
+#endif //CMM_OUTPUT_H
@@ -1,6 +1,7 @@
 #ifndef CMM_PARSER_H
 #define CMM_PARSER_H
 
+#include <iostream>
 #include <vector>
 #include "lexer.h"
 #include "token.h"
@@ -11,6 +12,13 @@ class Parser {
 public:
     Parser(const Lexer &lexer, const int &total);
 
+    Parser(const Parser &) = delete;
+
+    Parser &operator = (const Parser &) = delete;
+
+    // 释放语法树, 之后不能再使用 ast() 返回的结点
+    ~Parser();
+
     // 获取下一个 Token 并移动当前位置
     void consume();
 
@@ -102,7 +110,7 @@ public:
     // function_call: ID LPAREN ((ID | REAL_LITERAL | INTEGER_LITERAL) (COMMA (ID | REAL_LITERAL | INTEGER_LITERAL)*)?) RPAREN ;
     void parse_function_call();
 
-    void print_ast() const;
+    void print_ast(std::ostream &os = std::cout) const;
 
 private:
     Lexer lexer_;
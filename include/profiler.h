@@ -0,0 +1,249 @@
+#ifndef CMM_PROFILER_H
+#define CMM_PROFILER_H
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "ir.h"
+
+// 逐条指令的性能剖析, 记录每个中间代码位置的执行次数与累计耗时, 运行结束后按位置, 指令类型和类别汇总输出
+class InstructionProfiler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // 指令类别, 用于区分访问变量与计算的耗时
+    enum class Category {
+        kVariable = 0,                   // 定义, 读写变量与数组 (链接前需要按名字查找的部分)
+        kArithmetic,                     // 算术运算与类型转换
+        kCompare,                        // 比较与条件跳转
+        kControl,                        // 无条件跳转, Label 与块
+        kCall,                           // 函数调用与返回
+        kInputOutput,                    // 输入输出
+        kOther,
+    };
+
+    InstructionProfiler() : enabled_(false), overhead_(0) { }
+
+    bool is_enabled() const {
+        return enabled_;
+    }
+
+    // 开始剖析 size 条指令的程序, 并估计一次计时本身的开销
+    void reset(const bool &enabled, const int &size) {
+        enabled_ = enabled;
+        counts_.assign(enabled ? (unsigned long)size : 0, 0);
+        times_.assign(enabled ? (unsigned long)size : 0, 0);
+        overhead_ = 0;
+        if (enabled) {
+            const int samples = 1000;
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < samples; ++i) {
+                Clock::now();
+            }
+            overhead_ = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / samples;
+        }
+    }
+
+    // 记录 pos 处指令的一次执行, 扣除计时开销
+    void record(const int &pos, const Clock::time_point &start, const Clock::time_point &end) {
+        long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() - overhead_;
+        ++counts_[pos];
+        times_[pos] += elapsed > 0 ? elapsed : 0;
+    }
+
+    static Category category(const PCode::Type &type) {
+        switch (type) {
+            case PCode::Type::kVarInteger:
+            case PCode::Type::kVarIntegerArray:
+            case PCode::Type::kVarReal:
+            case PCode::Type::kVarRealArray:
+            case PCode::Type::kArgInteger:
+            case PCode::Type::kArgIntegerArray:
+            case PCode::Type::kArgReal:
+            case PCode::Type::kArgRealArray:
+            case PCode::Type::kPushInteger:
+            case PCode::Type::kPushIntegerArray:
+            case PCode::Type::kPushReal:
+            case PCode::Type::kPushRealArray:
+            case PCode::Type::kPop:
+            case PCode::Type::kPopInteger:
+            case PCode::Type::kPopIntegerArray:
+            case PCode::Type::kPopReal:
+            case PCode::Type::kPopRealArray:
+            case PCode::Type::kMoveInteger:
+            case PCode::Type::kMoveReal:
+                return Category::kVariable;
+            case PCode::Type::kAddInteger:
+            case PCode::Type::kAddReal:
+            case PCode::Type::kSubInteger:
+            case PCode::Type::kSubReal:
+            case PCode::Type::kMulInteger:
+            case PCode::Type::kMulReal:
+            case PCode::Type::kDivInteger:
+            case PCode::Type::kDivReal:
+            case PCode::Type::kIntegerToReal:
+            case PCode::Type::kAnd:
+            case PCode::Type::kOr:
+            case PCode::Type::kNot:
+            case PCode::Type::kNegative:
+            case PCode::Type::kIncrementInteger:
+            case PCode::Type::kDecrementInteger:
+                return Category::kArithmetic;
+            case PCode::Type::kCompareEqualInteger:
+            case PCode::Type::kCompareEqualReal:
+            case PCode::Type::kCompareNotEqualInteger:
+            case PCode::Type::kCompareNotEqualReal:
+            case PCode::Type::kCompareGreaterThanInteger:
+            case PCode::Type::kCompareGreaterThanReal:
+            case PCode::Type::kCompareLessThanInteger:
+            case PCode::Type::kCompareLessThanReal:
+            case PCode::Type::kCompareGreaterEqualInteger:
+            case PCode::Type::kCompareGreaterEqualReal:
+            case PCode::Type::kCompareLessEqualInteger:
+            case PCode::Type::kCompareLessEqualReal:
+            case PCode::Type::kJumpZero:
+            case PCode::Type::kJumpNotZero:
+            case PCode::Type::kCompareEqualJumpZero:
+            case PCode::Type::kCompareNotEqualJumpZero:
+            case PCode::Type::kCompareGreaterThanJumpZero:
+            case PCode::Type::kCompareLessThanJumpZero:
+            case PCode::Type::kCompareGreaterEqualJumpZero:
+            case PCode::Type::kCompareLessEqualJumpZero:
+                return Category::kCompare;
+            case PCode::Type::kJump:
+            case PCode::Type::kLabel:
+            case PCode::Type::kEnterScope:
+            case PCode::Type::kLeaveScope:
+                return Category::kControl;
+            case PCode::Type::kStartFunc:
+            case PCode::Type::kEndFunc:
+            case PCode::Type::kCall:
+            case PCode::Type::kTailCall:
+            case PCode::Type::kReturn:
+                return Category::kCall;
+            case PCode::Type::kPrint:
+            case PCode::Type::kReadInt:
+            case PCode::Type::kReadIntArray:
+            case PCode::Type::kReadReal:
+            case PCode::Type::kReadRealArray:
+                return Category::kInputOutput;
+            default:
+                return Category::kOther;
+        }
+    }
+
+    static const char *category_name(const Category &category) {
+        switch (category) {
+            case Category::kVariable:
+                return "变量访问";
+            case Category::kArithmetic:
+                return "算术运算";
+            case Category::kCompare:
+                return "比较与条件跳转";
+            case Category::kControl:
+                return "跳转与块";
+            case Category::kCall:
+                return "函数调用";
+            case Category::kInputOutput:
+                return "输入输出";
+            default:
+                return "其他";
+        }
+    }
+
+    // 输出报告: 最热的指令 (附中间代码), 最热的指令类型, 各类别的耗时占比
+    void print(std::ostream &os, const IR &ir, const int &top = 20) const {
+        std::ios::fmtflags flags = os.flags();
+        std::streamsize precision = os.precision();
+
+        long long total_count = 0;
+        long long total_time = 0;
+        std::vector<long long> type_counts, type_times;
+        std::vector<long long> category_counts(kCategoryCount, 0), category_times(kCategoryCount, 0);
+        for (int pos = 0; pos < (int)counts_.size() && pos < ir.size(); ++pos) {
+            unsigned long type = (unsigned long)ir.at(pos).type();
+            if (type >= type_counts.size()) {
+                type_counts.resize(type + 1, 0);
+                type_times.resize(type + 1, 0);
+            }
+            int category = (int)InstructionProfiler::category(ir.at(pos).type());
+            total_count += counts_[pos];
+            total_time += times_[pos];
+            type_counts[type] += counts_[pos];
+            type_times[type] += times_[pos];
+            category_counts[category] += counts_[pos];
+            category_times[category] += times_[pos];
+        }
+
+        os << "性能剖析 (共执行 " << total_count << " 条指令, 累计 " << std::fixed << std::setprecision(3) << total_time / 1e6
+           << " ms, 已扣除每次计时约 " << overhead_ << " ns 的开销):" << std::endl;
+
+        // 按耗时排序的中间代码位置
+        std::vector<int> positions;
+        for (int pos = 0; pos < (int)counts_.size() && pos < ir.size(); ++pos) {
+            if (counts_[pos] > 0) {
+                positions.push_back(pos);
+            }
+        }
+        std::sort(positions.begin(), positions.end(), [this](const int &a, const int &b) {
+            return times_[a] != times_[b] ? times_[a] > times_[b] : a < b;
+        });
+        os << std::endl << "最热的指令:" << std::endl;
+        print_header(os);
+        for (int i = 0; i < (int)positions.size() && i < top; ++i) {
+            int pos = positions[i];
+            print_row(os, counts_[pos], times_[pos], total_time);
+            os << pos << ":\t\t| " << ir.at(pos) << std::endl;
+        }
+
+        std::vector<int> types;
+        for (int type = 0; type < (int)type_counts.size(); ++type) {
+            if (type_counts[type] > 0) {
+                types.push_back(type);
+            }
+        }
+        std::sort(types.begin(), types.end(), [&type_times](const int &a, const int &b) {
+            return type_times[a] != type_times[b] ? type_times[a] > type_times[b] : a < b;
+        });
+        os << std::endl << "最热的指令类型:" << std::endl;
+        print_header(os);
+        for (int i = 0; i < (int)types.size() && i < top; ++i) {
+            print_row(os, type_counts[types[i]], type_times[types[i]], total_time);
+            os << PCode::mnemonic((PCode::Type)types[i]) << std::endl;
+        }
+
+        os << std::endl << "各类别的耗时占比:" << std::endl;
+        print_header(os);
+        for (int category = 0; category < kCategoryCount; ++category) {
+            if (category_counts[category] > 0) {
+                print_row(os, category_counts[category], category_times[category], total_time);
+                os << category_name((Category)category) << std::endl;
+            }
+        }
+
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+private:
+    static const int kCategoryCount = (int)Category::kOther + 1;
+
+    bool enabled_;
+    long long overhead_;                 // 一次读取时钟的平均耗时 (纳秒)
+    std::vector<long long> counts_;      // 每个位置的执行次数
+    std::vector<long long> times_;       // 每个位置的累计耗时 (纳秒)
+
+    static void print_header(std::ostream &os) {
+        os << "        次数    耗时(ms)      占比  指令" << std::endl;
+    }
+
+    static void print_row(std::ostream &os, const long long &count, const long long &time, const long long &total_time) {
+        double percent = total_time > 0 ? 100.0 * time / total_time : 0.0;
+        os << std::setw(12) << count << std::setw(12) << std::fixed << std::setprecision(3) << time / 1e6
+           << std::setw(9) << std::setprecision(2) << percent << "%  ";
+    }
+};
+
+#endif //CMM_PROFILER_H
@@ -0,0 +1,157 @@
+#ifndef CMM_REGISTER_SIMULATOR_H
+#define CMM_REGISTER_SIMULATOR_H
+
+#include <vector>
+#include <exception>
+#include "ir.h"
+#include "linker.h"
+#include "lowering.h"
+#include "bytecode.h"
+#include "value.h"
+#include "exceptions.h"
+#include "dispatch.h"
+#include "jit.h"
+#include "output.h"
+#include "input.h"
+#include "memory_quota.h"
+#include "trace.h"
+
+// 寄存器虚拟机, 执行由栈式中间代码翻译得到的三地址指令
+// 所有函数帧的寄存器连续存放, 调用时新帧紧接在调用者的寄存器之后; 数组存放于独立的堆中, 寄存器中只保存其句柄
+class RegisterSimulator {
+public:
+    RegisterSimulator(const IR &ir) : ir_(ir), is_loaded_(false), use_jit_(false), native_depth_(0), trace_capacity_(0),
+            globals_(AccountingAllocator<Value>(&quota_)), registers_(AccountingAllocator<Value>(&quota_)),
+            frames_(AccountingAllocator<Frame>(&quota_)), arrays_(AccountingAllocator<Array>(&quota_)),
+            array_owners_(AccountingAllocator<int>(&quota_)), array_views_(AccountingAllocator<Jit::ArrayView>(&quota_)),
+            array_table_(nullptr) {
+        input_.tie(&output_);
+    }
+
+    // 装载程序: 添加主函数调用, 链接并翻译为寄存器指令; 启用即时编译时同时编译所有可翻译的函数
+    void load();
+
+    // 是否启用即时编译, 需要在 load 之前设置
+    void set_jit(const bool &use_jit) {
+        use_jit_ = use_jit;
+    }
+
+    // 获取即时编译器, 可查询哪些函数已编译为本地代码
+    const Jit &jit() const {
+        return jit_;
+    }
+
+    // 记录最近执行的 capacity 条指令, 为 0 时不记录, 需要在 load 之前设置
+    // 本地代码不记录轨迹, 记录轨迹时不进行即时编译
+    void set_trace(const int &capacity) {
+        trace_capacity_ = capacity;
+    }
+
+    const TraceBuffer &trace() const {
+        return trace_;
+    }
+
+    // 运行程序
+    void run();
+
+    // 设置 write 语句的输出流, 默认为标准输出
+    void set_output(std::ostream &os) {
+        output_.set_stream(os);
+    }
+
+    // 设置 read 语句的输入流, 默认为标准输入
+    void set_input(std::istream &is) {
+        input_.set_stream(is);
+    }
+
+    // 设置运行时内存配额 (字节), 0 表示不限; 计入全局变量, 寄存器区, 调用栈与数组堆, 超出时报错
+    void set_memory_limit(const unsigned long long &limit) {
+        quota_.set_limit(limit);
+    }
+
+    // 获取内存使用量与峰值
+    const MemoryQuota &memory() const {
+        return quota_;
+    }
+
+    // 获取翻译后的程序, 需要先调用 load
+    const BytecodeProgram &program() const {
+        return program_;
+    }
+
+private:
+    // 函数调用帧
+    struct Frame {
+        int return_pc;                   // 返回后继续执行的位置
+        int base;                        // 帧在寄存器区中的起始位置
+        int dst;                         // 返回值写入调用者的哪个寄存器
+        int registers;                   // 帧中寄存器数量
+        int array_mark;                  // 进入函数时堆中的数组数量, 返回时释放此后分配的数组
+    };
+
+    typedef std::vector<Value, AccountingAllocator<Value> > Array;
+
+    IR ir_;
+    MemoryQuota quota_;                            // 须在使用它的容器之前构造
+    BytecodeProgram program_;
+    bool is_loaded_;
+    bool use_jit_;
+    Jit jit_;
+    std::exception_ptr jit_error_;                 // 本地代码中发生的错误, 回到解释器后重新抛出
+    int native_depth_;                             // 当前嵌套执行的本地代码层数
+    int trace_capacity_;
+    TraceBuffer trace_;
+    std::vector<Value, AccountingAllocator<Value> > globals_;      // 全局变量, 其后紧接常量池
+    std::vector<Value, AccountingAllocator<Value> > registers_;
+    std::vector<Frame, AccountingAllocator<Frame> > frames_;
+    std::vector<Array, AccountingAllocator<Array> > arrays_;      // 数组堆, 下标即为句柄
+    std::vector<int, AccountingAllocator<int> > array_owners_;    // 各数组的所有者, 重新定义时复用其原有的数组
+    std::vector<Jit::ArrayView, AccountingAllocator<Jit::ArrayView> > array_views_;    // 各数组的元素位置与数量, 供本地代码直接访问
+    Jit::ArrayView *array_table_;                  // array_views_ 的起始位置, 本地代码经由其地址读取
+    OutputBuffer output_;
+    InputReader input_;
+
+    // 从 pc 开始执行指令, 直至停机或第 depth 层的帧返回, 此时返回值写入 result
+    void execute(int pc, const int &depth, Value *result);
+
+    // 为 pc 处的调用指令建立新帧并传入实参, 返回被调函数的寄存器
+    Value *enter_function(const int &pc, Value *base);
+
+    // 弹出当前帧并将返回值写入调用者, 返回调用者的寄存器
+    Value *leave_function(const Value &value, int &return_pc);
+
+    // 定义数组, operand 为 target 的操作数编号; 同一寄存器或全局变量在本帧中已拥有数组时清零后复用,
+    // 即使寄存器中的句柄已被兄弟语句块的标量覆盖, 循环中反复定义数组也不会使数组堆增长
+    void define_array(Value &target, const int &operand, const Value::Type &type, const int &size, const int &pc);
+
+    // 获取数组元素, 下标越界时报错
+    Value &element(const Value &array, const Value &index, const int &pc);
+
+    // 本地代码之间的调用经由 native_call 占用系统栈, 嵌套超过此层数后改由解释器执行, 深递归时不会耗尽系统栈
+    static const int kMaxNativeDepth = 4096;
+
+    // 获取可执行的本地代码, 未编译或嵌套过深时返回空指针
+    Jit::NativeFunction native_function(const int &function) const {
+        return native_depth_ < kMaxNativeDepth ? jit_.function(function) : nullptr;
+    }
+
+    // 执行本地代码并记录嵌套层数
+    int run_native(const Jit::NativeFunction &native, Value *base, Value *result) {
+        ++native_depth_;
+        int status = native(this, base, globals_.data(), result);
+        --native_depth_;
+        return status;
+    }
+
+    // 供本地代码调用的辅助函数, 均按 pc 处的指令解码操作数
+    // 辅助函数不向本地代码抛出异常: 出错时将异常记录于 jit_error_, 返回空指针或非零值
+    static Value *native_call(void *simulator, Value *base, int pc);
+
+    // 执行定义数组和输入输出指令
+    static int native_execute(void *simulator, Value *base, int pc);
+
+    // 按 pc 处的指令记录运行时错误
+    static void native_fail(void *simulator, Value *base, int pc);
+};
+
+#endif //CMM_REGISTER_SIMULATOR_H
@@ -15,6 +15,13 @@ public:
 
     ScopeNode(ScopeNode *enclosing_scope);
 
+    ScopeNode(const ScopeNode &) = delete;
+
+    ScopeNode &operator = (const ScopeNode &) = delete;
+
+    // 作用域拥有其子作用域, 随根作用域一并释放
+    ~ScopeNode();
+
     Symbol &resolve(const std::string &name);
 
     ScopeNode *resolve_scope(const std::string &name);
@@ -40,6 +47,12 @@ class ScopeTree {
 public:
     ScopeTree();
 
+    ScopeTree(const ScopeTree &) = delete;
+
+    ScopeTree &operator = (const ScopeTree &) = delete;
+
+    ~ScopeTree();
+
     Symbol &resolve(const std::string &name);
 
     ScopeNode *resolve_scope(const std::string &name);
@@ -79,6 +79,10 @@ public:
 
     const IR &ir() const;
 
+    const std::vector<std::pair<Position, std::string> > &error_messages() const;
+
+    const std::vector<std::pair<Position, std::string> > &warning_messages() const;
+
     void print_error_messages() const;
 
     void print_warning_messages() const;
@@ -110,17 +114,20 @@ private:
 
     void build_function_ir_args(const std::vector<std::pair<Token, Token> > &args);
 
-    void build_function_ir_end(const Token &identity);
+    void build_function_ir_end(const Token &identity, const Token &declare_keyword);
 
     void build_return_statement_ir(const Token &literal);
 
     void build_declare_statement_ir(const Token &declare_keyword, const Token &identity);
 
-    void build_assign_statement_ir(const Token &left_identity, const Token &right_expression);
+    void build_assign_statement_ir(const Token &left_identity, const Symbol &left_symbol, const Token &right_expression);
+
+    // 统一双操作数的类型, 返回运算所用的类型
+    Token::Type build_conversion_ir(const int &left_end, const Token &left, const Token &right);
 
-    void build_expression_ir(const Token &op);
+    void build_expression_ir(const Token &op, const Token &operand);
 
-    void build_term_ir(const Token &op);
+    void build_term_ir(const Token &op, const Token &operand);
 
     void build_function_call_ir(const Token &identity);
 
@@ -128,7 +135,12 @@ private:
 
     void build_read_statement_ir(const Token &token, const Symbol &symbol);
 
-    void build_condition_ir(const Token &op);
+    void build_condition_ir(const Token &op, const Token::Type &type);
+
+    // 进入和离开语句块, 携带块的嵌套层次
+    void build_enter_scope_ir();
+
+    void build_leave_scope_ir();
 
     void build_while_statement_ir_begin(const std::string &signature);
 
@@ -4,16 +4,56 @@
 #include <vector>
 #include <string>
 #include <map>
-#include <deque>
+#include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <climits>
+#include <memory>
 #include "ir.h"
-#include "scope.h"
+#include "linker.h"
+#include "compiled_program.h"
+#include "operand_stack.h"
 #include "exceptions.h"
 #include "utils.h"
+#include "dispatch.h"
+#include "fusion.h"
+#include "opcode_statistics.h"
+#include "profiler.h"
+#include "call_graph.h"
+#include "trace.h"
+#include "output.h"
+#include "input.h"
+#include "snapshot.h"
+#include "memory_quota.h"
 
 class Simulator {
 public:
-    Simulator(const IR &ir) : ir_(ir), eip_(0), inloop_(false) { }
+    // 指令分派方式
+    enum class Dispatch {
+        kSwitch = 0,                     // 逐条调用 run_instruction
+        kThreaded,                       // 直接线索化
+    };
+
+    // resume 因何暂停
+    enum class Pause {
+        kNone = 0,
+        kBeforeRead,                     // set_pause_before_read 要求在读取前暂停
+        kFuel,                           // run_for 给出的燃料已耗尽
+        kDeadline,                       // 已超过 set_deadline 给出的期限
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    // 燃料的计量: 向后跳转 (进入下一轮循环) 消耗跳转的跨度, 即一轮循环体的指令条数; 调用消耗被调函数的指令条数
+    // 只在这两处扣除与检查燃料, 顺序执行的代码不增加任何开销; 不含循环与调用的代码至多执行一遍程序的长度,
+    // 因此 run_for(n) 至多执行约 n 加上程序长度条指令后返回
+    static const long long kUnlimitedFuel = -1;
+
+    // 由中间代码构造, 装载时按 set_fusion 的设置编译为只属于本实例的程序
+    Simulator(const IR &ir) : Simulator(ir, nullptr) { }
+
+    // 运行共享的已编译程序, 实例只持有操作数栈, 槽位, 调用栈与输入输出等运行状态, 多个实例可在不同线程中同时运行
+    explicit Simulator(const CompiledProgram &program) : Simulator(IR(), &program) { }
 
     void start_func(const PCode &code);
 
@@ -39,31 +79,53 @@ public:
 
     void pop(const PCode &code);
 
-    void pop_identity(const PCode &code);
+    void pop_integer(const PCode &code);
+
+    void pop_real(const PCode &code);
 
     void pop_array(const PCode &code);
 
-    void add(const PCode &code);
+    void add_integer(const PCode &code);
+
+    void add_real(const PCode &code);
+
+    void sub_integer(const PCode &code);
+
+    void sub_real(const PCode &code);
+
+    void mul_integer(const PCode &code);
+
+    void mul_real(const PCode &code);
+
+    void div_integer(const PCode &code);
+
+    void div_real(const PCode &code);
+
+    void compare_equal_integer(const PCode &code);
+
+    void compare_equal_real(const PCode &code);
 
-    void sub(const PCode &code);
+    void compare_not_equal_integer(const PCode &code);
 
-    void mul(const PCode &code);
+    void compare_not_equal_real(const PCode &code);
 
-    void divide(const PCode &code);
+    void compare_greater_than_integer(const PCode &code);
 
-    void mod(const PCode &code);
+    void compare_greater_than_real(const PCode &code);
 
-    void compare_equal(const PCode &code);
+    void compare_less_than_integer(const PCode &code);
 
-    void compare_not_equal(const PCode &code);
+    void compare_less_than_real(const PCode &code);
 
-    void compare_greater_than(const PCode &code);
+    void compare_greater_equal_integer(const PCode &code);
 
-    void compare_less_than(const PCode &code);
+    void compare_greater_equal_real(const PCode &code);
 
-    void compare_greater_equal(const PCode &code);
+    void compare_less_equal_integer(const PCode &code);
 
-    void compare_less_equal(const PCode &code);
+    void compare_less_equal_real(const PCode &code);
+
+    void integer_to_real(const PCode &code);
 
     void jump(const PCode &code);
 
@@ -71,8 +133,6 @@ public:
 
     void jump_not_zero(const PCode &code);
 
-    void label(const PCode &code);
-
     void print(const PCode &code);
 
     void read_int(const PCode &code);
@@ -87,21 +147,41 @@ public:
 
     void call(const PCode &code);
 
+    void tail_call(const PCode &code);
+
     void end_func(const PCode &code);
 
     void return_function(const PCode &code);
 
+    // 融合指令, 执行后越过被融合的其余指令
+    void increment_integer(const PCode &code);
+
+    void decrement_integer(const PCode &code);
+
+    void move_integer(const PCode &code);
+
+    void move_real(const PCode &code);
+
+    void compare_equal_jump_zero(const PCode &code);
+
+    void compare_not_equal_jump_zero(const PCode &code);
+
+    void compare_greater_than_jump_zero(const PCode &code);
+
+    void compare_less_than_jump_zero(const PCode &code);
+
+    void compare_greater_equal_jump_zero(const PCode &code);
+
+    void compare_less_equal_jump_zero(const PCode &code);
+
     // 每次运行一条指令
     int run_instruction() {
-        if (eip_ >= ir_.size()) {
+        if (eip_ >= code_size_) {
             return 0;
         }
 
-        const PCode &line = ir_.at(eip_);
+        const PCode &line = code_[eip_];
         switch (line.type()) {
-            case PCode::Type::kLabel:
-                label(line);
-                break;
             case PCode::Type::kStartFunc:
                 start_func(line);
                 break;
@@ -121,6 +201,15 @@ public:
                 break;
             case PCode::Type::kCall:
                 call(line);
+                if (is_paused_) {
+                    return 1;
+                }
+                break;
+            case PCode::Type::kTailCall:
+                tail_call(line);
+                if (is_paused_) {
+                    return 1;
+                }
                 break;
             case PCode::Type::kVarInteger:
                 var_integer(line);
@@ -150,45 +239,77 @@ public:
                 pop(line);
                 break;
             case PCode::Type::kPopInteger:
+                pop_integer(line);
+                break;
             case PCode::Type::kPopReal:
-                pop_identity(line);
+                pop_real(line);
                 break;
             case PCode::Type::kPopIntegerArray:
             case PCode::Type::kPopRealArray:
                 pop_array(line);
                 break;
-            case PCode::Type::kAdd:
-                add(line);
+            case PCode::Type::kAddInteger:
+                add_integer(line);
+                break;
+            case PCode::Type::kAddReal:
+                add_real(line);
+                break;
+            case PCode::Type::kSubInteger:
+                sub_integer(line);
+                break;
+            case PCode::Type::kSubReal:
+                sub_real(line);
+                break;
+            case PCode::Type::kMulInteger:
+                mul_integer(line);
+                break;
+            case PCode::Type::kMulReal:
+                mul_real(line);
+                break;
+            case PCode::Type::kDivInteger:
+                div_integer(line);
+                break;
+            case PCode::Type::kDivReal:
+                div_real(line);
                 break;
-            case PCode::Type::kSub:
-                sub(line);
+            case PCode::Type::kCompareEqualInteger:
+                compare_equal_integer(line);
                 break;
-            case PCode::Type::kMul:
-                mul(line);
+            case PCode::Type::kCompareEqualReal:
+                compare_equal_real(line);
                 break;
-            case PCode::Type::kDiv:
-                divide(line);
+            case PCode::Type::kCompareNotEqualInteger:
+                compare_not_equal_integer(line);
                 break;
-            case PCode::Type::kMod:
-                mod(line);
+            case PCode::Type::kCompareNotEqualReal:
+                compare_not_equal_real(line);
                 break;
-            case PCode::Type::kCompareEqual:
-                compare_equal(line);
+            case PCode::Type::kCompareGreaterThanInteger:
+                compare_greater_than_integer(line);
                 break;
-            case PCode::Type::kCompareNotEqual:
-                compare_not_equal(line);
+            case PCode::Type::kCompareGreaterThanReal:
+                compare_greater_than_real(line);
                 break;
-            case PCode::Type::kCompareGreaterThan:
-                compare_greater_than(line);
+            case PCode::Type::kCompareLessThanInteger:
+                compare_less_than_integer(line);
                 break;
-            case PCode::Type::kCompareLessThan:
-                compare_less_than(line);
+            case PCode::Type::kCompareLessThanReal:
+                compare_less_than_real(line);
                 break;
-            case PCode::Type::kCompareGreaterEqual:
-                compare_greater_equal(line);
+            case PCode::Type::kCompareGreaterEqualInteger:
+                compare_greater_equal_integer(line);
                 break;
-            case PCode::Type::kCompareLessEqual:
-                compare_less_equal(line);
+            case PCode::Type::kCompareGreaterEqualReal:
+                compare_greater_equal_real(line);
+                break;
+            case PCode::Type::kCompareLessEqualInteger:
+                compare_less_equal_integer(line);
+                break;
+            case PCode::Type::kCompareLessEqualReal:
+                compare_less_equal_real(line);
+                break;
+            case PCode::Type::kIntegerToReal:
+                integer_to_real(line);
                 break;
             case PCode::Type::kAnd:
                 break;
@@ -200,6 +321,9 @@ public:
                 break;
             case PCode::Type::kJump:
                 jump(line);
+                if (is_paused_) {
+                    return 1;
+                }
                 break;
             case PCode::Type::kJumpZero:
                 jump_zero(line);
@@ -212,46 +336,539 @@ public:
                 break;
             case PCode::Type::kReadInt:
                 read_int(line);
+                if (is_paused_) {
+                    return 1;
+                }
                 break;
             case PCode::Type::kReadIntArray:
                 read_int_array(line);
+                if (is_paused_) {
+                    return 1;
+                }
                 break;
             case PCode::Type::kReadReal:
                 read_real(line);
+                if (is_paused_) {
+                    return 1;
+                }
                 break;
             case PCode::Type::kReadRealArray:
                 read_real_array(line);
+                if (is_paused_) {
+                    return 1;
+                }
                 break;
             case PCode::Type::kExit:
                 exit_program(line);
                 break;
+            case PCode::Type::kIncrementInteger:
+                increment_integer(line);
+                break;
+            case PCode::Type::kDecrementInteger:
+                decrement_integer(line);
+                break;
+            case PCode::Type::kMoveInteger:
+                move_integer(line);
+                break;
+            case PCode::Type::kMoveReal:
+                move_real(line);
+                break;
+            case PCode::Type::kCompareEqualJumpZero:
+                compare_equal_jump_zero(line);
+                break;
+            case PCode::Type::kCompareNotEqualJumpZero:
+                compare_not_equal_jump_zero(line);
+                break;
+            case PCode::Type::kCompareGreaterThanJumpZero:
+                compare_greater_than_jump_zero(line);
+                break;
+            case PCode::Type::kCompareLessThanJumpZero:
+                compare_less_than_jump_zero(line);
+                break;
+            case PCode::Type::kCompareGreaterEqualJumpZero:
+                compare_greater_equal_jump_zero(line);
+                break;
+            case PCode::Type::kCompareLessEqualJumpZero:
+                compare_less_equal_jump_zero(line);
+                break;
             default:
                 break;
         }
         return -1;
     }
 
-    // 运行中间代码
-    void run() {
-        int pos = 0;
+#ifdef CMM_HAS_THREADED_DISPATCH
+    // 直接线索化执行: 预先将每条指令翻译为其处理代码的地址, 每个处理代码结束时直接跳转至下一条指令的处理代码
+    void run_threaded() {
+        // 末尾额外放置一条停机指令, 执行过程中无需检查 eip 是否越界
+        // 翻译结果只依赖装载后不再变化的中间代码, 保存下来供分时执行的每次 resume 复用
+        std::vector<ThreadedCode> &program = threaded_program_;
+        if (program.empty()) {
+            program.resize((unsigned long)code_size_ + 1);
+            for (int pos = 0; pos < code_size_; ++pos) {
+                program[pos].code = &code_[pos];
+                switch (code_[pos].type()) {
+                    case PCode::Type::kStartFunc:
+                        program[pos].handler = &&op_start_func;
+                        break;
+                    case PCode::Type::kArgInteger:
+                    case PCode::Type::kArgIntegerArray:
+                        program[pos].handler = &&op_arg_integer;
+                        break;
+                    case PCode::Type::kArgReal:
+                    case PCode::Type::kArgRealArray:
+                        program[pos].handler = &&op_arg_real;
+                        break;
+                    case PCode::Type::kReturn:
+                        program[pos].handler = &&op_return_function;
+                        break;
+                    case PCode::Type::kEndFunc:
+                        program[pos].handler = &&op_end_func;
+                        break;
+                    case PCode::Type::kCall:
+                        program[pos].handler = &&op_call;
+                        break;
+                    case PCode::Type::kTailCall:
+                        program[pos].handler = &&op_tail_call;
+                        break;
+                    case PCode::Type::kVarInteger:
+                        program[pos].handler = &&op_var_integer;
+                        break;
+                    case PCode::Type::kVarIntegerArray:
+                        program[pos].handler = &&op_var_integer_array;
+                        break;
+                    case PCode::Type::kVarReal:
+                        program[pos].handler = &&op_var_real;
+                        break;
+                    case PCode::Type::kVarRealArray:
+                        program[pos].handler = &&op_var_real_array;
+                        break;
+                    case PCode::Type::kPushInteger:
+                        program[pos].handler = &&op_push_integer;
+                        break;
+                    case PCode::Type::kPushIntegerArray:
+                        program[pos].handler = &&op_push_integer_array;
+                        break;
+                    case PCode::Type::kPushReal:
+                        program[pos].handler = &&op_push_real;
+                        break;
+                    case PCode::Type::kPushRealArray:
+                        program[pos].handler = &&op_push_real_array;
+                        break;
+                    case PCode::Type::kPop:
+                        program[pos].handler = &&op_pop;
+                        break;
+                    case PCode::Type::kPopInteger:
+                        program[pos].handler = &&op_pop_integer;
+                        break;
+                    case PCode::Type::kPopReal:
+                        program[pos].handler = &&op_pop_real;
+                        break;
+                    case PCode::Type::kPopIntegerArray:
+                    case PCode::Type::kPopRealArray:
+                        program[pos].handler = &&op_pop_array;
+                        break;
+                    case PCode::Type::kAddInteger:
+                        program[pos].handler = &&op_add_integer;
+                        break;
+                    case PCode::Type::kAddReal:
+                        program[pos].handler = &&op_add_real;
+                        break;
+                    case PCode::Type::kSubInteger:
+                        program[pos].handler = &&op_sub_integer;
+                        break;
+                    case PCode::Type::kSubReal:
+                        program[pos].handler = &&op_sub_real;
+                        break;
+                    case PCode::Type::kMulInteger:
+                        program[pos].handler = &&op_mul_integer;
+                        break;
+                    case PCode::Type::kMulReal:
+                        program[pos].handler = &&op_mul_real;
+                        break;
+                    case PCode::Type::kDivInteger:
+                        program[pos].handler = &&op_div_integer;
+                        break;
+                    case PCode::Type::kDivReal:
+                        program[pos].handler = &&op_div_real;
+                        break;
+                    case PCode::Type::kCompareEqualInteger:
+                        program[pos].handler = &&op_compare_equal_integer;
+                        break;
+                    case PCode::Type::kCompareEqualReal:
+                        program[pos].handler = &&op_compare_equal_real;
+                        break;
+                    case PCode::Type::kCompareNotEqualInteger:
+                        program[pos].handler = &&op_compare_not_equal_integer;
+                        break;
+                    case PCode::Type::kCompareNotEqualReal:
+                        program[pos].handler = &&op_compare_not_equal_real;
+                        break;
+                    case PCode::Type::kCompareGreaterThanInteger:
+                        program[pos].handler = &&op_compare_greater_than_integer;
+                        break;
+                    case PCode::Type::kCompareGreaterThanReal:
+                        program[pos].handler = &&op_compare_greater_than_real;
+                        break;
+                    case PCode::Type::kCompareLessThanInteger:
+                        program[pos].handler = &&op_compare_less_than_integer;
+                        break;
+                    case PCode::Type::kCompareLessThanReal:
+                        program[pos].handler = &&op_compare_less_than_real;
+                        break;
+                    case PCode::Type::kCompareGreaterEqualInteger:
+                        program[pos].handler = &&op_compare_greater_equal_integer;
+                        break;
+                    case PCode::Type::kCompareGreaterEqualReal:
+                        program[pos].handler = &&op_compare_greater_equal_real;
+                        break;
+                    case PCode::Type::kCompareLessEqualInteger:
+                        program[pos].handler = &&op_compare_less_equal_integer;
+                        break;
+                    case PCode::Type::kCompareLessEqualReal:
+                        program[pos].handler = &&op_compare_less_equal_real;
+                        break;
+                    case PCode::Type::kIntegerToReal:
+                        program[pos].handler = &&op_integer_to_real;
+                        break;
+                    case PCode::Type::kJump:
+                        program[pos].handler = &&op_jump;
+                        break;
+                    case PCode::Type::kJumpZero:
+                        program[pos].handler = &&op_jump_zero;
+                        break;
+                    case PCode::Type::kJumpNotZero:
+                        program[pos].handler = &&op_jump_not_zero;
+                        break;
+                    case PCode::Type::kPrint:
+                        program[pos].handler = &&op_print;
+                        break;
+                    case PCode::Type::kReadInt:
+                        program[pos].handler = &&op_read_int;
+                        break;
+                    case PCode::Type::kReadIntArray:
+                        program[pos].handler = &&op_read_int_array;
+                        break;
+                    case PCode::Type::kReadReal:
+                        program[pos].handler = &&op_read_real;
+                        break;
+                    case PCode::Type::kReadRealArray:
+                        program[pos].handler = &&op_read_real_array;
+                        break;
+                    case PCode::Type::kExit:
+                        program[pos].handler = &&op_exit_program;
+                        break;
+                    case PCode::Type::kIncrementInteger:
+                        program[pos].handler = &&op_increment_integer;
+                        break;
+                    case PCode::Type::kDecrementInteger:
+                        program[pos].handler = &&op_decrement_integer;
+                        break;
+                    case PCode::Type::kMoveInteger:
+                        program[pos].handler = &&op_move_integer;
+                        break;
+                    case PCode::Type::kMoveReal:
+                        program[pos].handler = &&op_move_real;
+                        break;
+                    case PCode::Type::kCompareEqualJumpZero:
+                        program[pos].handler = &&op_compare_equal_jump_zero;
+                        break;
+                    case PCode::Type::kCompareNotEqualJumpZero:
+                        program[pos].handler = &&op_compare_not_equal_jump_zero;
+                        break;
+                    case PCode::Type::kCompareGreaterThanJumpZero:
+                        program[pos].handler = &&op_compare_greater_than_jump_zero;
+                        break;
+                    case PCode::Type::kCompareLessThanJumpZero:
+                        program[pos].handler = &&op_compare_less_than_jump_zero;
+                        break;
+                    case PCode::Type::kCompareGreaterEqualJumpZero:
+                        program[pos].handler = &&op_compare_greater_equal_jump_zero;
+                        break;
+                    case PCode::Type::kCompareLessEqualJumpZero:
+                        program[pos].handler = &&op_compare_less_equal_jump_zero;
+                        break;
+                    default:
+                        program[pos].handler = &&op_unsupported;
+                        break;
+                }
+            }
+            program[code_size_].handler = &&op_halt;
+            program[code_size_].code = nullptr;
+        }
+        // 记录轨迹时改用另一张表, 记录后再跳转至原处理代码; 不记录时的执行路径不受影响
+        const ThreadedCode *table = program.data();
+        if (trace_.is_enabled()) {
+            if (traced_program_.empty()) {
+                traced_program_ = program;
+                for (int pos = 0; pos < code_size_; ++pos) {
+                    traced_program_[pos].handler = &&op_trace;
+                }
+            }
+            table = traced_program_.data();
+        }
 
-        // 添加主函数调用
-        ir_.add(PCode(PCode::Type::kCall, "main"));
+#define CMM_DISPATCH() goto *table[eip_].handler
+
+        CMM_DISPATCH();
+
+    op_trace:
+        record_trace();
+        goto *program[eip_].handler;
+
+    op_start_func:
+        start_func(*program[eip_].code);
+        CMM_DISPATCH();
+    op_arg_integer:
+        arg_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_arg_real:
+        arg_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_return_function:
+        return_function(*program[eip_].code);
+        CMM_DISPATCH();
+    op_end_func:
+        end_func(*program[eip_].code);
+        CMM_DISPATCH();
+    op_call:
+        call(*program[eip_].code);
+        if (is_paused_) {
+            return;
+        }
+        CMM_DISPATCH();
+    op_tail_call:
+        tail_call(*program[eip_].code);
+        if (is_paused_) {
+            return;
+        }
+        CMM_DISPATCH();
+    op_var_integer:
+        var_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_var_integer_array:
+        var_integer_array(*program[eip_].code);
+        CMM_DISPATCH();
+    op_var_real:
+        var_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_var_real_array:
+        var_real_array(*program[eip_].code);
+        CMM_DISPATCH();
+    op_push_integer:
+        push_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_push_integer_array:
+        push_integer_array(*program[eip_].code);
+        CMM_DISPATCH();
+    op_push_real:
+        push_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_push_real_array:
+        push_real_array(*program[eip_].code);
+        CMM_DISPATCH();
+    op_pop:
+        pop(*program[eip_].code);
+        CMM_DISPATCH();
+    op_pop_integer:
+        pop_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_pop_real:
+        pop_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_pop_array:
+        pop_array(*program[eip_].code);
+        CMM_DISPATCH();
+    op_add_integer:
+        add_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_add_real:
+        add_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_sub_integer:
+        sub_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_sub_real:
+        sub_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_mul_integer:
+        mul_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_mul_real:
+        mul_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_div_integer:
+        div_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_div_real:
+        div_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_equal_integer:
+        compare_equal_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_equal_real:
+        compare_equal_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_not_equal_integer:
+        compare_not_equal_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_not_equal_real:
+        compare_not_equal_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_greater_than_integer:
+        compare_greater_than_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_greater_than_real:
+        compare_greater_than_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_less_than_integer:
+        compare_less_than_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_less_than_real:
+        compare_less_than_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_greater_equal_integer:
+        compare_greater_equal_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_greater_equal_real:
+        compare_greater_equal_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_less_equal_integer:
+        compare_less_equal_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_less_equal_real:
+        compare_less_equal_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_integer_to_real:
+        integer_to_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_jump:
+        jump(*program[eip_].code);
+        if (is_paused_) {
+            return;
+        }
+        CMM_DISPATCH();
+    op_jump_zero:
+        jump_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_jump_not_zero:
+        jump_not_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_print:
+        print(*program[eip_].code);
+        CMM_DISPATCH();
+    op_read_int:
+        read_int(*program[eip_].code);
+        if (is_paused_) {
+            return;
+        }
+        CMM_DISPATCH();
+    op_read_int_array:
+        read_int_array(*program[eip_].code);
+        if (is_paused_) {
+            return;
+        }
+        CMM_DISPATCH();
+    op_read_real:
+        read_real(*program[eip_].code);
+        if (is_paused_) {
+            return;
+        }
+        CMM_DISPATCH();
+    op_read_real_array:
+        read_real_array(*program[eip_].code);
+        if (is_paused_) {
+            return;
+        }
+        CMM_DISPATCH();
+    op_exit_program:
+        exit_program(*program[eip_].code);
+        CMM_DISPATCH();
+    op_increment_integer:
+        increment_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_decrement_integer:
+        decrement_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_move_integer:
+        move_integer(*program[eip_].code);
+        CMM_DISPATCH();
+    op_move_real:
+        move_real(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_equal_jump_zero:
+        compare_equal_jump_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_not_equal_jump_zero:
+        compare_not_equal_jump_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_greater_than_jump_zero:
+        compare_greater_than_jump_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_less_than_jump_zero:
+        compare_less_than_jump_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_greater_equal_jump_zero:
+        compare_greater_equal_jump_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_compare_less_equal_jump_zero:
+        compare_less_equal_jump_zero(*program[eip_].code);
+        CMM_DISPATCH();
+    op_unsupported:
+        throw simulator_error(line(), "不支持的指令");
+    op_halt:
+        return;
+
+#undef CMM_DISPATCH
+    }
+#endif
 
-        // 记录所有 Label 和函数 Label 相对位置
-        for (pos = 0; pos < ir_.size(); ++pos) {
-            const PCode &line = ir_.at(pos);
+    // 在执行 eip 处的指令前记录轨迹
+    void record_trace() {
+        trace_.record(eip_, (int)stack_.size(), stack_.empty() ? Value() : stack_.back());
+    }
 
-            if (line.type() == PCode::Type::kLabel) {
-                label_table_[line.first()] = pos;
-            } else if (line.type() == PCode::Type::kStartFunc) {
-                func_table_[line.first()] = std::pair<int, int>(pos, -1);
-            } else if (line.type() == PCode::Type::kEndFunc) {
-                func_table_[line.first()] = std::pair<int, int>(func_table_[line.first()].first, pos);
+    // 统计或剖析时逐条执行, 记录每条指令的类型与耗时
+    void run_instrumented() {
+        while (eip_ < code_size_ && !is_paused_) {
+            int pos = eip_;
+            if (trace_.is_enabled()) {
+                record_trace();
+            }
+            if (statistics_.is_enabled()) {
+                statistics_.record(code_[pos].type());
+            }
+            if (profiler_.is_enabled()) {
+                InstructionProfiler::Clock::time_point start = InstructionProfiler::Clock::now();
+                run_instruction();
+                profiler_.record(pos, start, InstructionProfiler::Clock::now());
+            } else {
+                run_instruction();
             }
         }
+    }
 
-        eip_ = 0;
+    // 按分派方式执行已装载的程序
+    void execute() {
+        if (statistics_.is_enabled() || profiler_.is_enabled()) {
+            run_instrumented();
+            return;
+        }
+#ifdef CMM_HAS_THREADED_DISPATCH
+        if (dispatch_ == Dispatch::kThreaded) {
+            run_threaded();
+            return;
+        }
+#endif
+        if (trace_.is_enabled()) {
+            while (eip_ < code_size_) {
+                record_trace();
+                if (run_instruction() >= 0) {
+                    break;
+                }
+            }
+            return;
+        }
         int return_status;
         while (true) {
             return_status = run_instruction();
@@ -261,629 +878,607 @@ public:
         }
     }
 
-    int eip() const {
-        return eip_;
+    // 装载程序并重置运行状态, 之后可以恢复检查点, 再由 resume 开始执行
+    void load() {
+        if (program_ == nullptr) {
+            owned_program_.reset(new CompiledProgram(source_, fusion_));
+            program_ = owned_program_.get();
+        }
+        code_ = &program_->ir().at(0);
+        code_size_ = program_->ir().size();
+        constants_ = program_->constants().data();
+        functions_ = program_->functions().data();
+        is_loaded_ = true;
+
+        // 旧的数组随槽位一同释放
+        quota_.release(array_bytes_);
+        array_bytes_ = 0;
+        try {
+            globals_.assign((unsigned long)program_->global_size(), Symbol());
+            slots_.assign(kInitialSlots, Symbol());
+        } catch (const memory_quota_error &e) {
+            throw simulator_error(0, e.what());
+        }
+        frames_.clear();
+        stack_.clear();
+        locals_ = slots_.data();
+        eip_ = 0;
+        is_paused_ = false;
+        pause_ = Pause::kNone;
+        budget_ = kUnlimitedFuel;
+
+        profiler_.reset(profile_, code_size_);
+        std::vector<std::string> names;
+        for (const LinkedFunction &function : program_->functions()) {
+            names.push_back(function.name());
+        }
+        call_graph_.reset(call_graph_enabled_, names);
+        trace_.reset(trace_capacity_);
     }
 
-    void inc_eip() {
-        eip_++;
+    // 从当前状态继续执行, 直至程序结束或暂停
+    void resume() {
+        is_paused_ = false;
+        pause_ = Pause::kNone;
+        start_slice();
+        try {
+            execute();
+        } catch (const simulator_error &e) {
+            // 出错时关闭仍未返回的函数, 保留已记录的调用图; 先写出已有的输出, 再由调用者报告错误
+            call_graph_.finish();
+            output_.flush();
+            throw;
+        } catch (const memory_quota_error &e) {
+            // 分配器不知道指令位置, 在此补上当前指令
+            call_graph_.finish();
+            output_.flush();
+            throw simulator_error(line(), e.what());
+        }
+        if (is_paused_) {
+            settle_fuel();
+        } else {
+            call_graph_.finish();
+        }
+        output_.flush();
     }
 
-    void set_eip(const int &pos) {
-        eip_ = pos;
+    // 至多消耗 fuel 份燃料后暂停, 之后可再次调用 run_for 或 resume 继续; 程序执行完毕时返回 true
+    // 尚未装载时先装载程序; 期限由 set_deadline 另行设置, 同样会使其提前返回
+    bool run_for(const long long &fuel) {
+        if (!is_loaded_) {
+            load();
+        }
+        if (is_finished()) {
+            return true;
+        }
+        budget_ = fuel > 0 ? fuel : 0;
+        resume();
+        budget_ = kUnlimitedFuel;
+        return is_finished();
     }
 
-private:
-    IR ir_;
-    std::deque<StackSymbol> stack_;
-    ScopeTree tree_;
-    std::map<std::string, std::pair<int, int> > func_table_;
-    std::map<std::string, int> label_table_;
-    int eip_;
-    int inloop_;
+    // 设置挂钟期限, 超过后在下一个检查点暂停; 期限只在每消耗 kCheckInterval 份燃料时检查一次, 不必每次读取时钟
+    void set_deadline(const Clock::time_point &deadline) {
+        has_deadline_ = true;
+        deadline_ = deadline;
+    }
 
-    int get_second_parameter(const std::string &str) {
-        if (Recognition::is_integer(str)) {
-            return std::stoi(str);
-        } else {
-            Symbol symbol = tree_.resolve(str);
-            return symbol.int_value();
-        }
+    void clear_deadline() {
+        has_deadline_ = false;
     }
-};
 
-#endif //CMM_SIMULATOR_H
+    Pause pause_reason() const {
+        return pause_;
+    }
 
-void Simulator::start_func(const PCode &code) {
-    set_eip(func_table_[code.first()].second + 1);
-}
-
-void Simulator::arg_integer(const PCode &code) {
-    StackSymbol back = stack_.back();
-    stack_.pop_back();
-
-    if (back.type() == StackSymbol::Type::kInt) {
-        tree_.define(Symbol(code.first(), (int)back.int_value(), true));
-    } else if (back.type() == StackSymbol::Type::kReal) {
-        tree_.define(Symbol(code.first(), (int)back.real_value(), true));
-    } else {
-        throw simulator_error(eip(), "不支持的函数调用实参类型");
-    }
-
-    inc_eip();
-}
-
-void Simulator::arg_real(const PCode &code) {
-    StackSymbol back = stack_.back();
-    stack_.pop_back();
-
-    if (back.type() == StackSymbol::Type::kInt) {
-        tree_.define(Symbol(code.first(), (double)back.int_value(), true));
-    } else if (back.type() == StackSymbol::Type::kReal) {
-        tree_.define(Symbol(code.first(), (double)back.real_value(), true));
-    } else {
-        throw simulator_error(eip(), "不支持的函数调用实参类型");
-    }
-
-    inc_eip();
-}
-
-void Simulator::call(const PCode &code) {
-    const std::pair<int, int> &func_pos = func_table_[code.first()];
-    tree_.push();
-    tree_.define(Symbol("__ret__", eip() + 1, true));
-    set_eip(func_pos.first + 1);
-}
-
-void Simulator::return_function(const PCode &code) {
-    set_eip(tree_.resolve("__ret__").int_value());
-    while (tree_.resolve_scope("__ret__")->level() != tree_.current()->level()) {
-        tree_.pop();
-    }
-    tree_.pop();
-}
-
-void Simulator::end_func(const PCode &code) {
-    stack_.push_back(StackSymbol(0));
-    set_eip(tree_.resolve("__ret__").int_value());
-    tree_.pop();
-}
-
-void Simulator::var_integer(const PCode &code) {
-    tree_.define(Symbol(code.first(), 0, false));
-    inc_eip();
-}
-
-void Simulator::var_integer_array(const PCode &code) {
-    tree_.define(Symbol(code.first(), std::vector<int>(std::stoul(code.second()), 0), true));
-    inc_eip();
-}
-
-void Simulator::var_real(const PCode &code) {
-    tree_.define(Symbol(code.first(), 0.0, false));
-    inc_eip();
-}
-
-void Simulator::var_real_array(const PCode &code) {
-    tree_.define(Symbol(code.first(), std::vector<double>(std::stoul(code.second()), 0.0), true));
-    inc_eip();
-}
-
-void Simulator::push_integer(const PCode &code) {
-    if (Recognition::is_integer(code.first())) {
-        stack_.push_back(StackSymbol(std::stoi(code.first())));
-    } else {
-        Symbol symbol = tree_.resolve(code.first());
-        if (symbol.is_assigned()) {
-            stack_.push_back(StackSymbol(symbol.int_value()));
-        } else {
-            throw simulator_error(eip(), "变量 \"" + code.first() + "\" 未初始化而直接使用");
-        }
-    }
-    inc_eip();
-}
-
-void Simulator::push_integer_array(const PCode &code) {
-    Symbol symbol = tree_.resolve(code.first());
-    if (Recognition::is_integer(code.second())) {
-        stack_.push_back(StackSymbol(symbol.int_array().at(std::stoul(code.second()))));
-    } else {
-        Symbol offset = tree_.resolve(code.second());
-        stack_.push_back(StackSymbol(symbol.int_array().at((unsigned long)offset.int_value())));
-    }
-    inc_eip();
-}
-
-void Simulator::push_real(const PCode &code) {
-    if (Recognition::is_real(code.first())) {
-        stack_.push_back(StackSymbol(std::stod(code.first())));
-    } else {
-        Symbol symbol = tree_.resolve(code.first());
-        stack_.push_back(StackSymbol(symbol.real_value()));
-    }
-    inc_eip();
-}
-
-void Simulator::push_real_array(const PCode &code) {
-    Symbol symbol = tree_.resolve(code.first());
-    if (Recognition::is_integer(code.second())) {
-        stack_.push_back(StackSymbol(symbol.real_array().at(std::stoul(code.second()))));
-    } else {
-        Symbol offset = tree_.resolve(code.second());
-        stack_.push_back(StackSymbol(symbol.real_array().at((unsigned long)offset.int_value())));
-    }
-    inc_eip();
-}
-
-void Simulator::pop(const PCode &code) {
-    stack_.pop_back();
-    inc_eip();
-}
-
-void Simulator::pop_identity(const PCode &code) {
-    StackSymbol back = stack_.back();
-    stack_.pop_back();
-    Symbol &symbol = tree_.resolve(code.first());
-
-    if (symbol.type() == Symbol::Type::kInt) {
-        if (back.type() == StackSymbol::Type::kInt) {
-            symbol.set_value((int) back.int_value());
-        } else if (back.type() == StackSymbol::Type::kReal) {
-            symbol.set_value((int) back.real_value());
-        } else {
-            throw simulator_error(eip(), "无法取出栈顶元素");
-        }
-    } else if (symbol.type() == Symbol::Type::kReal) {
-        if (back.type() == StackSymbol::Type::kInt) {
-            symbol.set_value((double) back.int_value());
-        } else if (back.type() == StackSymbol::Type::kReal) {
-            symbol.set_value((double) back.real_value());
-        } else {
-            throw simulator_error(eip(), "无法取出栈顶元素");
-        }
-    } else {
-        throw simulator_error(eip(), "错误的目标类型");
+    // 运行中间代码
+    void run() {
+        load();
+        resume();
     }
 
-    symbol.set_assigned();
+    // 设置运行时内存配额 (字节), 0 表示不限; 计入槽位, 调用栈, 操作数栈与数组元素, 超出时报错
+    void set_memory_limit(const unsigned long long &limit) {
+        quota_.set_limit(limit);
+    }
 
-    inc_eip();
-}
+    // 获取内存使用量与峰值
+    const MemoryQuota &memory() const {
+        return quota_;
+    }
 
-void Simulator::pop_array(const PCode &code) {
-    StackSymbol back = stack_.back();
-    stack_.pop_back();
-    Symbol &symbol = tree_.resolve(code.first());
+    // 是否已执行完毕
+    bool is_finished() const {
+        return is_loaded_ && eip_ >= code_size_;
+    }
 
-    if (symbol.type() == Symbol::Type::kIntArray) {
-        std::vector<int> array = symbol.int_array();
-        if (back.type() == StackSymbol::Type::kInt) {
-            array[get_second_parameter(code.second())] = (int) back.int_value();
-        } else if (back.type() == StackSymbol::Type::kReal) {
-            array[get_second_parameter(code.second())] = (int) back.real_value();
-        } else {
-            throw simulator_error(eip(), "无法取出栈顶元素");
-        }
-        symbol.set_value(array);
-    } else if (symbol.type() == Symbol::Type::kRealArray) {
-        std::vector<double> array = symbol.real_array();
-        if (back.type() == StackSymbol::Type::kInt) {
-            array[get_second_parameter(code.second())] = (double) back.int_value();
-        } else if (back.type() == StackSymbol::Type::kReal) {
-            array[get_second_parameter(code.second())] = (double) back.real_value();
-        } else {
-            throw simulator_error(eip(), "无法取出栈顶元素");
-        }
-        symbol.set_value(array);
-    } else {
-        throw simulator_error(eip(), "错误的目标类型");
-    }
-
-    symbol.set_assigned();
-
-    inc_eip();
-}
-
-void Simulator::add(const PCode &code) {
-    StackSymbol first = stack_.back();
-    stack_.pop_back();
-    StackSymbol second = stack_.back();
-    stack_.pop_back();
-
-    double result;
-    if (first.type() == StackSymbol::Type::kInt) {
-        result = first.int_value();
-    } else if (first.type() == StackSymbol::Type::kReal) {
-        result = first.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的加法操作数");
-    }
-    if (second.type() == StackSymbol::Type::kInt) {
-        result += second.int_value();
-    } else if (second.type() == StackSymbol::Type::kReal) {
-        result += second.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的加法操作数");
-    }
-
-    stack_.push_back(StackSymbol(result));
-    inc_eip();
-}
-
-void Simulator::sub(const PCode &code) {
-    StackSymbol first = stack_.back();
-    stack_.pop_back();
-    StackSymbol second = stack_.back();
-    stack_.pop_back();
-
-    double result;
-    if (second.type() == StackSymbol::Type::kInt) {
-        result = second.int_value();
-    } else if (second.type() == StackSymbol::Type::kReal) {
-        result = second.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的减法操作数");
-    }
-    if (first.type() == StackSymbol::Type::kInt) {
-        result -= first.int_value();
-    } else if (first.type() == StackSymbol::Type::kReal) {
-        result -= first.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的减法操作数");
-    }
-
-    stack_.push_back(StackSymbol(result));
-    inc_eip();
-}
-
-void Simulator::mul(const PCode &code) {
-    StackSymbol first = stack_.back();
-    stack_.pop_back();
-    StackSymbol second = stack_.back();
-    stack_.pop_back();
-
-    double result;
-    if (second.type() == StackSymbol::Type::kInt) {
-        result = second.int_value();
-    } else if (second.type() == StackSymbol::Type::kReal) {
-        result = second.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的乘法操作数");
-    }
-    if (first.type() == StackSymbol::Type::kInt) {
-        result *= first.int_value();
-    } else if (first.type() == StackSymbol::Type::kReal) {
-        result *= first.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的乘法操作数");
-    }
-
-    stack_.push_back(StackSymbol(result));
-    inc_eip();
-}
-
-void Simulator::divide(const PCode &code) {
-    StackSymbol first = stack_.back();
-    stack_.pop_back();
-    StackSymbol second = stack_.back();
-    stack_.pop_back();
-
-    double result;
-    if (second.type() == StackSymbol::Type::kInt) {
-        result = (double)second.int_value();
-    } else if (second.type() == StackSymbol::Type::kReal) {
-        result = (double)second.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的除法操作数");
-    }
-    if (first.type() == StackSymbol::Type::kInt) {
-        if (first.int_value() == 0) {
-            throw simulator_error(eip(), "除数不能为 0");
-        }
-        result /= (double)first.int_value();
-    } else if (first.type() == StackSymbol::Type::kReal) {
-        if (std::fabs(first.real_value()) < 1e-8) {
-            throw simulator_error(eip(), "除数不能为 0");
-        }
-        result /= (double)first.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的除法操作数");
-    }
-
-    stack_.push_back(StackSymbol(result));
-    inc_eip();
-}
-
-void Simulator::mod(const PCode &code) {
-    StackSymbol first = stack_.back();
-    stack_.pop_back();
-    StackSymbol second = stack_.back();
-    stack_.pop_back();
-
-    double result;
-    if (second.type() == StackSymbol::Type::kInt) {
-        result = (double)second.int_value();
-    } else if (second.type() == StackSymbol::Type::kReal) {
-        result = (double)second.real_value();
-    } else {
-        throw simulator_error(eip(), "不合法的求余操作数");
-    }
-    if (first.type() == StackSymbol::Type::kInt) {
-        if (first.int_value() == 0) {
-            throw simulator_error(eip(), "mod 除数不能为 0");
-        }
-        result = std::fmod(result, (double)first.int_value());
-    } else if (first.type() == StackSymbol::Type::kReal) {
-        if (std::fabs(first.real_value()) < 1e-8) {
-            throw simulator_error(eip(), "mod 除数不能为 0");
-        }
-        result = std::fmod(result, (double)first.real_value());
-    } else {
-        throw simulator_error(eip(), "不合法的求余操作数");
-    }
-
-    stack_.push_back(StackSymbol(result));
-    inc_eip();
-}
-
-void Simulator::compare_equal(const PCode &code) {
-    StackSymbol right = stack_.back();
-    stack_.pop_back();
-    StackSymbol left = stack_.back();
-    stack_.pop_back();
-
-    if (left.type() == StackSymbol::Type::kInt) {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.int_value() == right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)((double)left.int_value() == right.real_value())));
-        }
-    } else {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.real_value() == (double)right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)(left.real_value() == right.real_value())));
-        }
+    // 是否因暂停而从 resume 或 run_for 返回, 原因见 pause_reason
+    bool is_paused() const {
+        return is_paused_;
     }
 
-    inc_eip();
-}
+    // 下一条读取指令执行前暂停一次, 此时初始化通常已经完成, 适合保存检查点供之后的运行直接恢复
+    void set_pause_before_read(const bool &pause) {
+        pause_before_read_ = pause;
+    }
 
-void Simulator::compare_not_equal(const PCode &code) {
-    StackSymbol right = stack_.back();
-    stack_.pop_back();
-    StackSymbol left = stack_.back();
-    stack_.pop_back();
+    // 下一条将要执行的指令位置
+    int position() const {
+        return eip_;
+    }
 
-    if (left.type() == StackSymbol::Type::kInt) {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.int_value() != right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)((double)left.int_value() != right.real_value())));
+    // 下一条将要执行的指令在链接前的中间代码中的位置, 与运行时错误报告的位置一致
+    int line() const {
+        return program_->line(eip_);
+    }
+
+    // 将运行状态保存为检查点: 指令位置, 操作数栈, 全局变量, 各函数帧的槽位 (含数组) 与调用栈
+    // 常量池, 函数表与跳转目标由装载时的链接确定, 不必保存; 检查点只能由相同的程序在相同的融合设置下恢复
+    void save(std::ostream &os) const {
+        SnapshotWriter writer(os);
+        writer.write_header(program_->fingerprint());
+        writer.write_i32(eip_);
+
+        writer.write_u32((unsigned int)stack_.size());
+        for (int i = 0; i < stack_.size(); ++i) {
+            const Value &value = stack_.at(i);
+            writer.write_u8((unsigned char)value.type());
+            if (value.type() == Value::Type::kReal) {
+                writer.write_f64(value.real_value());
+            } else {
+                writer.write_i32(value.int_value());
+            }
         }
-    } else {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.real_value() != (double)right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)(left.real_value() != right.real_value())));
+
+        writer.write_u32((unsigned int)globals_.size());
+        for (const Symbol &symbol : globals_) {
+            save_symbol(writer, symbol);
+        }
+
+        // 只保存仍在使用的槽位
+        int used = frames_.empty() ? 0 : frames_.back().base + frames_.back().size;
+        writer.write_u32((unsigned int)used);
+        for (int i = 0; i < used; ++i) {
+            save_symbol(writer, slots_[i]);
+        }
+
+        writer.write_u32((unsigned int)frames_.size());
+        for (const Frame &frame : frames_) {
+            writer.write_i32(frame.return_eip);
+            writer.write_i32(frame.base);
+            writer.write_i32(frame.size);
+        }
+        if (!os) {
+            throw snapshot_error("无法写入检查点");
         }
     }
 
-    inc_eip();
-}
+    // 恢复由 save 保存的运行状态, 需要先调用 load
+    void restore(std::istream &is) {
+        load();
+        try {
+            SnapshotReader reader(is);
+            reader.read_header(program_->fingerprint());
+            eip_ = reader.read_i32();
+            if (eip_ < 0 || eip_ > code_size_) {
+                throw snapshot_error("检查点文件已损坏");
+            }
 
-void Simulator::compare_greater_than(const PCode &code) {
-    StackSymbol right = stack_.back();
-    stack_.pop_back();
-    StackSymbol left = stack_.back();
-    stack_.pop_back();
+            unsigned int size = reader.read_count();
+            for (unsigned int i = 0; i < size; ++i) {
+                // 数组始终留在槽位中, 操作数栈上只会有 int 与 real
+                unsigned char type = reader.read_u8();
+                if (type == (unsigned char)Value::Type::kReal) {
+                    stack_.push_back(Value(reader.read_f64()));
+                } else if (type == (unsigned char)Value::Type::kInt) {
+                    stack_.push_back(Value(reader.read_i32()));
+                } else {
+                    throw snapshot_error("检查点文件已损坏");
+                }
+            }
 
-    if (left.type() == StackSymbol::Type::kInt) {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.int_value() > right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)((double)left.int_value() > right.real_value())));
+            if (reader.read_u32() != globals_.size()) {
+                throw snapshot_error("检查点文件已损坏");
+            }
+            for (Symbol &symbol : globals_) {
+                symbol = restore_symbol(reader);
+            }
+
+            size = reader.read_count();
+            slots_.assign(size > kInitialSlots ? (unsigned long)size : kInitialSlots, Symbol());
+            for (unsigned int i = 0; i < size; ++i) {
+                slots_[i] = restore_symbol(reader);
+            }
+
+            size = reader.read_count();
+            for (unsigned int i = 0; i < size; ++i) {
+                Frame frame;
+                frame.return_eip = reader.read_i32();
+                frame.base = reader.read_i32();
+                frame.size = reader.read_i32();
+                if (frame.return_eip < 0 || frame.return_eip > code_size_) {
+                    throw snapshot_error("检查点文件已损坏");
+                }
+                if (frame.base < 0 || frame.size < 0 || (unsigned long)frame.base + frame.size > slots_.size()) {
+                    throw snapshot_error("检查点文件已损坏");
+                }
+                frames_.push_back(frame);
+            }
+            locals_ = slots_.data() + (frames_.empty() ? 0 : frames_.back().base);
+        } catch (const memory_quota_error &e) {
+            throw simulator_error(line(), e.what());
         }
-    } else {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.real_value() > (double)right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)(left.real_value() > right.real_value())));
+    }
+
+    Dispatch dispatch() const {
+        return dispatch_;
+    }
+
+    void set_dispatch(const Dispatch &dispatch) {
+        dispatch_ = dispatch;
+    }
+
+    bool fusion() const {
+        return program_ != nullptr ? program_->is_fused() : fusion_;
+    }
+
+    // 是否在运行前进行超级指令融合, 只对由中间代码构造的实例有效; 共享的程序在编译时已确定
+    void set_fusion(const bool &fusion) {
+        fusion_ = fusion;
+    }
+
+    // 统计运行中长度不超过 length 的指令序列, 为 0 时不统计
+    void set_statistics(const int &length) {
+        statistics_.reset(length);
+    }
+
+    const OpcodeStatistics &statistics() const {
+        return statistics_;
+    }
+
+    // 是否剖析每条指令的执行次数与耗时
+    void set_profile(const bool &profile) {
+        profile_ = profile;
+    }
+
+    const InstructionProfiler &profiler() const {
+        return profiler_;
+    }
+
+    // 是否记录函数调用图
+    void set_call_graph(const bool &call_graph) {
+        call_graph_enabled_ = call_graph;
+    }
+
+    const CallGraphProfiler &call_graph() const {
+        return call_graph_;
+    }
+
+    // 记录最近执行的 capacity 条指令, 为 0 时不记录
+    void set_trace(const int &capacity) {
+        trace_capacity_ = capacity;
+    }
+
+    const TraceBuffer &trace() const {
+        return trace_;
+    }
+
+    // 设置 write 语句的输出流, 默认为标准输出
+    void set_output(std::ostream &os) {
+        output_.set_stream(os);
+    }
+
+    // 设置 read 语句的输入流, 默认为标准输入
+    void set_input(std::istream &is) {
+        input_.set_stream(is);
+    }
+
+    // 链接与融合后实际执行的中间代码, 装载前为构造时传入的中间代码
+    const IR &ir() const {
+        return program_ != nullptr ? program_->ir() : source_;
+    }
+
+    // 执行的程序, 需要先调用 load
+    const CompiledProgram &program() const {
+        return *program_;
+    }
+
+    // 当前编译器是否支持线索化分派
+    static bool has_threaded_dispatch() {
+#ifdef CMM_HAS_THREADED_DISPATCH
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    int eip() const {
+        return eip_;
+    }
+
+    void inc_eip() {
+        eip_++;
+    }
+
+    void set_eip(const int &pos) {
+        eip_ = pos;
+    }
+
+private:
+    Simulator(const IR &source, const CompiledProgram *program) : source_(source), program_(program), code_(nullptr), code_size_(0), constants_(nullptr), functions_(nullptr), stack_(&quota_), globals_(AccountingAllocator<Symbol>(&quota_)), slots_(AccountingAllocator<Symbol>(&quota_)), frames_(AccountingAllocator<Frame>(&quota_)), locals_(nullptr), eip_(0), dispatch_(has_threaded_dispatch() ? Dispatch::kThreaded : Dispatch::kSwitch), fusion_(true), profile_(false), call_graph_enabled_(false), trace_capacity_(0), is_loaded_(false), is_paused_(false), pause_before_read_(false), pause_(Pause::kNone), budget_(kUnlimitedFuel), fuel_(0), slice_(0), has_deadline_(false), array_bytes_(0) {
+        input_.tie(&output_);
+    }
+
+    // 函数活动记录
+    struct Frame {
+        int return_eip;                  // 返回地址
+        int base;                        // 帧在 slots_ 中的起始位置
+        int size;                        // 帧中槽位数量, 由函数中的声明决定
+    };
+
+    IR source_;                                   // 由中间代码构造时待编译的程序
+    std::unique_ptr<CompiledProgram> owned_program_;
+    const CompiledProgram *program_;              // 共享或自有的只读程序
+    const PCode *code_;                           // 以下均指向 program_ 中的数据, 热路径上直接索引
+    int code_size_;
+    const Symbol *constants_;                     // 常量池
+    const LinkedFunction *functions_;
+    MemoryQuota quota_;                           // 须在使用它的容器之前构造
+    OperandStack stack_;
+    std::vector<Symbol, AccountingAllocator<Symbol> > globals_;   // 全局帧
+    std::vector<Symbol, AccountingAllocator<Symbol> > slots_;     // 所有函数帧的槽位连续存放
+    std::vector<Frame, AccountingAllocator<Frame> > frames_;      // 函数调用栈
+    Symbol *locals_;                              // 当前帧的第一个槽位
+    int eip_;
+    Dispatch dispatch_;
+    bool fusion_;
+    OpcodeStatistics statistics_;
+    bool profile_;
+    InstructionProfiler profiler_;
+    bool call_graph_enabled_;
+    CallGraphProfiler call_graph_;
+    int trace_capacity_;
+    TraceBuffer trace_;
+    bool is_loaded_;                              // 运行状态是否已由 load 初始化
+    bool is_paused_;
+    bool pause_before_read_;
+    Pause pause_;
+    long long budget_;                            // run_for 剩余的燃料, kUnlimitedFuel 表示不限
+    long long fuel_;                              // 本轮剩余的燃料, 降至 0 时结算并检查期限
+    long long slice_;                             // 本轮开始时的燃料
+    bool has_deadline_;
+    Clock::time_point deadline_;
+    unsigned long long array_bytes_;              // 槽位与全局变量中数组元素的字节数, 已计入 quota_
+#ifdef CMM_HAS_THREADED_DISPATCH
+    struct ThreadedCode {
+        const void *handler;
+        const PCode *code;
+    };
+
+    std::vector<ThreadedCode> threaded_program_;
+    std::vector<ThreadedCode> traced_program_;    // 记录轨迹时使用, 每条指令先经过记录轨迹的处理代码
+#endif
+    OutputBuffer output_;
+    InputReader input_;
+
+    // 根据链接后的地址获取变量或常量
+    // 写入的目标只能是局部或全局变量
+    Symbol &resolve(const Address &address) {
+        return address.frame() == Address::Frame::kLocal ? locals_[address.slot()] : globals_[address.slot()];
+    }
+
+    // 读取变量或常量, 常量池属于共享的程序, 只读
+    const Symbol &value_of(const Address &address) const {
+        switch (address.frame()) {
+            case Address::Frame::kLocal:
+                return locals_[address.slot()];
+            case Address::Frame::kConstant:
+                return constants_[address.slot()];
+            default:
+                return globals_[address.slot()];
         }
     }
 
-    inc_eip();
-}
+    static const unsigned long kInitialSlots = 256;
 
-void Simulator::compare_less_than(const PCode &code) {
-    StackSymbol right = stack_.back();
-    stack_.pop_back();
-    StackSymbol left = stack_.back();
-    stack_.pop_back();
+    // 数组元素存放于 Symbol 自身的 vector 中, 不经过分配器, 在定义数组时记账, 在槽位被覆盖或所在的帧弹出时释放
+    void charge_array(const unsigned long long &bytes) {
+        quota_.allocate(bytes);
+        array_bytes_ += bytes;
+    }
 
-    if (left.type() == StackSymbol::Type::kInt) {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.int_value() < right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)((double)left.int_value() < right.real_value())));
+    // 覆盖槽位前释放其中的数组; 没有数组时只需比较一次
+    void release_array(const Symbol &symbol) {
+        if (array_bytes_ == 0) {
+            return;
         }
-    } else {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.real_value() < (double)right.int_value())));
+        unsigned long long bytes;
+        if (symbol.type() == Symbol::Type::kIntArray) {
+            bytes = symbol.int_array().size() * sizeof(int);
+        } else if (symbol.type() == Symbol::Type::kRealArray) {
+            bytes = symbol.real_array().size() * sizeof(double);
         } else {
-            stack_.push_back(StackSymbol((int)(left.real_value() < right.real_value())));
+            return;
         }
+        quota_.release(bytes);
+        array_bytes_ -= bytes;
     }
 
-    inc_eip();
-}
-
-void Simulator::compare_greater_equal(const PCode &code) {
-    StackSymbol right = stack_.back();
-    stack_.pop_back();
-    StackSymbol left = stack_.back();
-    stack_.pop_back();
+    // 函数返回或尾调用复用活动记录时释放帧中遗留的数组, 不必等到之后的调用覆盖这些槽位
+    void release_frame(const int &base, const int &size) {
+        if (array_bytes_ == 0) {
+            return;
+        }
+        for (int i = base; i < base + size; ++i) {
+            Symbol &symbol = slots_[i];
+            if (symbol.type() == Symbol::Type::kIntArray || symbol.type() == Symbol::Type::kRealArray) {
+                release_array(symbol);
+                symbol = Symbol();
+            }
+        }
+    }
 
-    if (left.type() == StackSymbol::Type::kInt) {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.int_value() >= right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)((double)left.int_value() >= right.real_value())));
+    // 按 set_pause_before_read 的要求在读取前暂停, 不推进指令位置, 恢复后重新执行该读取
+    bool pause_if_requested() {
+        if (!pause_before_read_) {
+            return false;
         }
-    } else {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.real_value() >= (double)right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)(left.real_value() >= right.real_value())));
+        pause_before_read_ = false;
+        is_paused_ = true;
+        pause_ = Pause::kBeforeRead;
+        return true;
+    }
+
+    // 有期限时每消耗这么多份燃料读取一次时钟, 记录轨迹时同样每隔这么多份燃料检查一次输出请求
+    static const long long kCheckInterval = 1 << 16;
+
+    // 开始新的一轮: 燃料取 run_for 的剩余燃料, 有期限或记录轨迹时不超过检查的间隔
+    void start_slice() {
+        slice_ = budget_ == kUnlimitedFuel ? LLONG_MAX : budget_;
+        if ((has_deadline_ || trace_.is_enabled()) && slice_ > kCheckInterval) {
+            slice_ = kCheckInterval;
         }
+        fuel_ = slice_;
     }
 
-    inc_eip();
-}
+    // 在向后跳转与调用处扣除燃料, 本轮燃料耗尽时才进入较慢的结算
+    void consume_fuel(const int &amount) {
+        fuel_ -= amount;
+        if (fuel_ <= 0) {
+            refuel();
+        }
+    }
 
-void Simulator::compare_less_equal(const PCode &code) {
-    StackSymbol right = stack_.back();
-    stack_.pop_back();
-    StackSymbol left = stack_.back();
-    stack_.pop_back();
+    // 将本轮已消耗的燃料从 run_for 的剩余燃料中扣除
+    void settle_fuel() {
+        if (budget_ != kUnlimitedFuel) {
+            budget_ = std::max(budget_ - (slice_ - fuel_), 0LL);
+        }
+        slice_ = fuel_;
+    }
 
-    if (left.type() == StackSymbol::Type::kInt) {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.int_value() <= right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)((double)left.int_value() <= right.real_value())));
+    // 本轮燃料耗尽: 剩余燃料用完或超过期限时暂停, 否则开始新的一轮; 暂停时跳转或调用已完成, 恢复后从其目标继续
+    // 收到输出轨迹的请求时在此输出, 请求只在向后跳转与调用处取出, 不必在每条指令前检查
+    void refuel() {
+        if (trace_.is_enabled() && TraceBuffer::take_dump_request()) {
+            trace_.print(std::cerr, ir());
         }
-    } else {
-        if (right.type() == StackSymbol::Type::kInt) {
-            stack_.push_back(StackSymbol((int)(left.real_value() <= (double)right.int_value())));
-        } else {
-            stack_.push_back(StackSymbol((int)(left.real_value() <= right.real_value())));
+        settle_fuel();
+        if (budget_ == 0) {
+            is_paused_ = true;
+            pause_ = Pause::kFuel;
+        } else if (has_deadline_ && Clock::now() >= deadline_) {
+            is_paused_ = true;
+            pause_ = Pause::kDeadline;
         }
+        start_slice();
     }
 
-    inc_eip();
-}
+    static void save_symbol(SnapshotWriter &writer, const Symbol &symbol) {
+        writer.write_u8((unsigned char)symbol.type());
+        writer.write_u8(symbol.is_assigned() ? 1 : 0);
+        switch (symbol.type()) {
+            case Symbol::Type::kInt:
+                writer.write_i32(symbol.int_value());
+                break;
+            case Symbol::Type::kReal:
+                writer.write_f64(symbol.real_value());
+                break;
+            case Symbol::Type::kIntArray:
+                writer.write_u32((unsigned int)symbol.int_array().size());
+                for (const int &value : symbol.int_array()) {
+                    writer.write_i32(value);
+                }
+                break;
+            case Symbol::Type::kRealArray:
+                writer.write_u32((unsigned int)symbol.real_array().size());
+                for (const double &value : symbol.real_array()) {
+                    writer.write_f64(value);
+                }
+                break;
+            default:
+                break;
+        }
+    }
 
-void Simulator::jump(const PCode &code) {
-    int target = label_table_[code.first()];
-    set_eip(target);
-}
+    // 恢复的数组在分配前先计入配额
+    Symbol restore_symbol(SnapshotReader &reader) {
+        Symbol::Type type = (Symbol::Type)reader.read_u8();
+        bool is_assigned = reader.read_u8() != 0;
+        switch (type) {
+            case Symbol::Type::kNone:
+                return Symbol();
+            case Symbol::Type::kInt:
+                return Symbol("", reader.read_i32(), is_assigned);
+            case Symbol::Type::kReal:
+                return Symbol("", reader.read_f64(), is_assigned);
+            case Symbol::Type::kIntArray: {
+                unsigned int size = reader.read_count();
+                charge_array((unsigned long long)size * sizeof(int));
+                std::vector<int> values(size);
+                for (int &value : values) {
+                    value = reader.read_i32();
+                }
+                return Symbol("", values, true);
+            }
+            case Symbol::Type::kRealArray: {
+                unsigned int size = reader.read_count();
+                charge_array((unsigned long long)size * sizeof(double));
+                std::vector<double> values(size);
+                for (double &value : values) {
+                    value = reader.read_f64();
+                }
+                return Symbol("", values, true);
+            }
+            default:
+                throw snapshot_error("检查点文件已损坏");
+        }
+    }
 
-void Simulator::jump_zero(const PCode &code) {
-    int target = label_table_[code.first()];
-    StackSymbol symbol = stack_.back();
-    stack_.pop_back();
-    if (symbol.int_value() == 0) {
-        set_eip(target);
-    } else {
-        inc_eip();
+    // 回到调用者: 弹出活动记录
+    void leave_frame() {
+        if (call_graph_.is_enabled()) {
+            call_graph_.leave();
+        }
+        const Frame &frame = frames_.back();
+        release_frame(frame.base, frame.size);
+        set_eip(frame.return_eip);
+        frames_.pop_back();
+        locals_ = slots_.data() + (frames_.empty() ? 0 : frames_.back().base);
     }
-}
 
-void Simulator::jump_not_zero(const PCode &code) {
-    int target = label_table_[code.first()];
-    StackSymbol symbol = stack_.back();
-    stack_.pop_back();
-    if (symbol.int_value() != 0) {
-        set_eip(target);
-    } else {
-        inc_eip();
+    // 读取已赋值的整数变量或常量, pos 为报错时的指令位置
+    int assigned_integer(const Address &address, const std::string &name, const int &pos) {
+        const Symbol &symbol = value_of(address);
+        if (!symbol.is_assigned()) {
+            throw simulator_error(program_->line(pos), "变量 \"" + name + "\" 未初始化而直接使用");
+        }
+        return symbol.int_value();
     }
-}
 
-void Simulator::label(const PCode &code) {
-    std::string name = code.first();
+    // 获取数组偏移量, 可以为整数或变量
+    int get_second_parameter(const PCode &code) {
+        return value_of(code.second_address()).int_value();
+    }
 
-    if (name.substr(0, 13) == "_begin_while_") {
-        tree_.push();
-        tree_.define(Symbol(name, 1, true));
-    } else if (name.substr(0, 11) == "_end_while_") {
-        while (true) {
-            bool is_found = false;
-            try {
-                tree_.resolve("_begin_while_" + name.substr(11));
-                tree_.pop();
-                is_found = true;
-            } catch (const scope_not_found &e) {
-                is_found = false;
-            }
-            if (!is_found) {
-                break;
-            }
+    // 原地访问数组元素, 下标越界时报错
+    int &int_element(Symbol &symbol, const PCode &code) {
+        std::vector<int> &array = symbol.int_array();
+        int index = get_second_parameter(code);
+        if ((unsigned long)index >= array.size()) {
+            throw simulator_error(line(), "数组下标越界");
         }
-    } else if (name.substr(0, 10) == "_begin_if_") {
-        tree_.push();
-    } else if (name.substr(0, 6) == "_else_") {
-        tree_.pop();
-        tree_.push();
-    } else if (name.substr(0, 8) == "_end_if_") {
-        tree_.pop();
-    }
-
-    inc_eip();
-}
-
-void Simulator::print(const PCode &code) {
-    StackSymbol symbol = stack_.back();
-    stack_.pop_back();
-
-    if (symbol.type() == StackSymbol::Type::kInt) {
-        std::cout << symbol.int_value() << std::endl;
-    } else if (symbol.type() == StackSymbol::Type::kReal) {
-        std::cout << symbol.real_value() << std::endl;
-    } else {
-        throw simulator_error(eip(), "不合法的输出参数");
-    }
-
-    inc_eip();
-}
-
-void Simulator::read_int(const PCode &code) {
-    int input = 0;
-    std::cin >> input;
-    Symbol &symbol = tree_.resolve(code.first());
-    symbol.set_value(input);
-    symbol.set_assigned();
-
-    inc_eip();
-}
-
-void Simulator::read_int_array(const PCode &code) {
-    int input = 0;
-    Symbol &symbol = tree_.resolve(code.first());
-
-    std::cin >> input;
-    std::vector<int> array = symbol.int_array();
-    array[get_second_parameter(code.second())] = input;
-    symbol.set_value(array);
-    symbol.set_assigned();
-
-    inc_eip();
-}
-
-void Simulator::read_real(const PCode &code) {
-    double input = 0.0;
-    std::cin >> input;
-    Symbol &symbol = tree_.resolve(code.first());
-    symbol.set_value(input);
-    symbol.set_assigned();
-
-    inc_eip();
-}
-
-void Simulator::read_real_array(const PCode &code) {
-    double input = 0;
-    Symbol &symbol = tree_.resolve(code.first());
-
-    std::cin >> input;
-    std::vector<double> array = symbol.real_array();
-    array[get_second_parameter(code.second())] = input;
-    symbol.set_value(array);
-    symbol.set_assigned();
-
-    inc_eip();
-}
-
-void Simulator::exit_program(const PCode &code) {
-    inc_eip();
-}
+        return array[index];
+    }
+
+    double &real_element(Symbol &symbol, const PCode &code) {
+        std::vector<double> &array = symbol.real_array();
+        int index = get_second_parameter(code);
+        if ((unsigned long)index >= array.size()) {
+            throw simulator_error(line(), "数组下标越界");
+        }
+        return array[index];
+    }
+};
+
+#endif //CMM_SIMULATOR_H
@@ -0,0 +1,157 @@
+#ifndef CMM_SNAPSHOT_H
+#define CMM_SNAPSHOT_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include "ir.h"
+#include "exceptions.h"
+
+// 检查点文件的读写, 所有整数按小端序定长写入, 实数按 IEEE 754 的位模式写入, 文件在不同平台间通用
+// 文件头为魔数, 版本与程序指纹, 恢复时据此拒绝其他程序或其他融合设置下保存的检查点
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::ostream &os) : os_(os) { }
+
+    void write_u8(const unsigned char &value) {
+        os_.put((char)value);
+    }
+
+    void write_u32(const unsigned int &value) {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = (char)((value >> (8 * i)) & 0xff);
+        }
+        os_.write(bytes, 4);
+    }
+
+    void write_i32(const int &value) {
+        write_u32((unsigned int)value);
+    }
+
+    void write_u64(const unsigned long long &value) {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = (char)((value >> (8 * i)) & 0xff);
+        }
+        os_.write(bytes, 8);
+    }
+
+    void write_f64(const double &value) {
+        unsigned long long bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        write_u64(bits);
+    }
+
+    void write_header(const unsigned long long &fingerprint) {
+        os_.write(magic(), kMagicSize);
+        write_u32(version());
+        write_u64(fingerprint);
+    }
+
+    // 程序指纹: 装载后实际执行的中间代码文本的 FNV-1a 散列
+    static unsigned long long fingerprint(const IR &ir) {
+        std::stringstream buffer;
+        buffer << ir;
+        const std::string text = buffer.str();
+        unsigned long long hash = 14695981039346656037ull;
+        for (const char &c : text) {
+            hash ^= (unsigned char)c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // 文件开头的 8 字节魔数, 含末尾的 '\0'
+    static const char *magic() {
+        return "CMMSNAP";
+    }
+
+    static unsigned int version() {
+        return 1;
+    }
+
+    static const int kMagicSize = 8;
+
+private:
+    std::ostream &os_;
+};
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(std::istream &is) : is_(is) { }
+
+    unsigned char read_u8() {
+        char byte;
+        read(&byte, 1);
+        return (unsigned char)byte;
+    }
+
+    unsigned int read_u32() {
+        unsigned char bytes[4];
+        read((char *)bytes, 4);
+        unsigned int value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= (unsigned int)bytes[i] << (8 * i);
+        }
+        return value;
+    }
+
+    int read_i32() {
+        return (int)read_u32();
+    }
+
+    unsigned long long read_u64() {
+        unsigned char bytes[8];
+        read((char *)bytes, 8);
+        unsigned long long value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= (unsigned long long)bytes[i] << (8 * i);
+        }
+        return value;
+    }
+
+    double read_f64() {
+        unsigned long long bits = read_u64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // 读取长度或数量, 超出上限时视为文件损坏, 以免按损坏的长度分配内存
+    unsigned int read_count() {
+        unsigned int count = read_u32();
+        if (count > kMaxCount) {
+            throw snapshot_error("检查点文件已损坏");
+        }
+        return count;
+    }
+
+    void read_header(const unsigned long long &fingerprint) {
+        char magic[SnapshotWriter::kMagicSize];
+        read(magic, SnapshotWriter::kMagicSize);
+        if (std::memcmp(magic, SnapshotWriter::magic(), SnapshotWriter::kMagicSize) != 0) {
+            throw snapshot_error("不是检查点文件");
+        }
+        if (read_u32() != SnapshotWriter::version()) {
+            throw snapshot_error("检查点文件的版本不受支持");
+        }
+        if (read_u64() != fingerprint) {
+            throw snapshot_error("检查点不是由当前程序保存的, 或保存时的超级指令融合设置不同");
+        }
+    }
+
+private:
+    static const unsigned int kMaxCount = 1u << 28;
+
+    std::istream &is_;
+
+    void read(char *bytes, const std::streamsize &size) {
+        if (!is_.read(bytes, size)) {
+            throw snapshot_error("检查点文件不完整");
+        }
+    }
+};
+
+#endif //CMM_SNAPSHOT_H
@@ -0,0 +1,111 @@
+#ifndef CMM_TRACE_H
+#define CMM_TRACE_H
+
+#include <iostream>
+#include <vector>
+#include <csignal>
+#include "ir.h"
+#include "bytecode.h"
+#include "value.h"
+
+// 执行轨迹的环形缓冲区, 记录最近执行的 N 条指令的位置与执行前的深度, 用于出错后或运行中途的事后分析
+// 容量在运行前取整为 2 的幂并一次性分配, 记录时只做一次按掩码的写入, 不分配内存也没有依赖数据的分支
+// 栈式虚拟机记录栈深与栈顶元素, 寄存器虚拟机记录调用深度
+class TraceBuffer {
+public:
+    struct Entry {
+        int eip;
+        int depth;                       // 执行前的栈深度或调用深度
+        Value top;                       // 执行前的栈顶元素, 栈为空或不记录时无意义
+    };
+
+    TraceBuffer() : mask_(0), recorded_(0) { }
+
+    bool is_enabled() const {
+        return !entries_.empty();
+    }
+
+    // 设置容量, 为 0 时关闭轨迹记录
+    void reset(const int &capacity) {
+        unsigned long size = 0;
+        if (capacity > 0) {
+            size = 1;
+            while (size < (unsigned long)capacity) {
+                size <<= 1;
+            }
+        }
+        entries_.assign(size, Entry{0, 0, Value()});
+        mask_ = size > 0 ? size - 1 : 0;
+        recorded_ = 0;
+    }
+
+    void record(const int &eip, const int &depth, const Value &top) {
+        Entry &entry = entries_[recorded_ & mask_];
+        entry.eip = eip;
+        entry.depth = depth;
+        entry.top = top;
+        ++recorded_;
+    }
+
+    // 从旧到新输出栈式虚拟机的记录, 并附上对应的中间代码
+    void print(std::ostream &os, const IR &ir) const {
+        print_entries(os, [&ir](std::ostream &os, const Entry &entry) {
+            os << ir.at(entry.eip) << "\t\t栈深 " << entry.depth;
+            if (entry.depth > 0) {
+                os << ", 栈顶 ";
+                if (entry.top.type() == Value::Type::kReal) {
+                    os << entry.top.real_value();
+                } else {
+                    os << entry.top.int_value();
+                }
+            }
+        });
+    }
+
+    // 从旧到新输出寄存器虚拟机的记录, 并附上对应的字节码
+    void print(std::ostream &os, const BytecodeProgram &program) const {
+        print_entries(os, [&program](std::ostream &os, const Entry &entry) {
+            os << "    ";
+            program.print_code(os, entry.eip);
+            os << "\t\t调用深度 " << entry.depth;
+        });
+    }
+
+    // 请求输出轨迹, 只写入一个标志, 可以在信号处理函数中调用; 虚拟机在调用与向后跳转处取出请求
+    static void request_dump() {
+        dump_requested() = 1;
+    }
+
+    // 取出并清除输出请求
+    static bool take_dump_request() {
+        if (dump_requested() == 0) {
+            return false;
+        }
+        dump_requested() = 0;
+        return true;
+    }
+
+private:
+    std::vector<Entry> entries_;
+    unsigned long long mask_;
+    unsigned long long recorded_;
+
+    template <typename Describe>
+    void print_entries(std::ostream &os, const Describe &describe) const {
+        unsigned long long count = recorded_ < entries_.size() ? recorded_ : entries_.size();
+        os << "最近执行的 " << count << " 条指令 (共执行 " << recorded_ << " 条):" << std::endl;
+        for (unsigned long long i = recorded_ - count; i < recorded_; ++i) {
+            const Entry &entry = entries_[i & mask_];
+            os << entry.eip << ":\t\t| ";
+            describe(os, entry);
+            os << std::endl;
+        }
+    }
+
+    static volatile std::sig_atomic_t &dump_requested() {
+        static volatile std::sig_atomic_t requested = 0;
+        return requested;
+    }
+};
+
+#endif //CMM_TRACE_H
@@ -0,0 +1,78 @@
+#ifndef CMM_VALUE_H
+#define CMM_VALUE_H
+
+#include <type_traits>
+
+// 运行时值, 可平凡复制且只占 16 字节, 数组通过句柄引用; 栈式虚拟机的操作数栈与寄存器虚拟机的寄存器共用这一布局
+class Value {
+public:
+    enum class Type {
+        kNone = 0,                       // 尚未赋值
+        kInt,
+        kReal,
+        kIntArray,
+        kRealArray,
+    };
+
+    Value() : type_(Type::kNone) {
+        value_.int_value = 0;
+    }
+
+    // 针对 int 的构造函数
+    Value(const int &value) : type_(Type::kInt) {
+        value_.int_value = value;
+    }
+
+    // 针对 real 的构造函数
+    Value(const double &value) : type_(Type::kReal) {
+        value_.real_value = value;
+    }
+
+    // 针对数组的构造函数, handle 为数组句柄
+    Value(const Type &type, const int &handle) : type_(type) {
+        value_.handle = handle;
+    }
+
+    Type type() const {
+        return type_;
+    }
+
+    int int_value() const {
+        return value_.int_value;
+    }
+
+    double real_value() const {
+        return value_.real_value;
+    }
+
+    int handle() const {
+        return value_.handle;
+    }
+
+    bool is_number() const {
+        return type_ == Type::kInt || type_ == Type::kReal;
+    }
+
+    // 按 int 读取, real 将被截断
+    int to_int() const {
+        return type_ == Type::kReal ? (int)value_.real_value : value_.int_value;
+    }
+
+    // 按 real 读取
+    double to_real() const {
+        return type_ == Type::kReal ? value_.real_value : (double)value_.int_value;
+    }
+
+private:
+    Type type_;
+    union {
+        int int_value;
+        double real_value;
+        int handle;
+    } value_;
+};
+
+static_assert(std::is_trivially_copyable<Value>::value && sizeof(Value) == 16,
+              "Value must stay a trivially copyable 16-byte value");
+
+#endif //CMM_VALUE_H
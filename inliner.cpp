@@ -0,0 +1,417 @@
+#include "include/inliner.h"
+
+Inliner::Inliner(const IR &ir, const int &budget) : ir_(ir), budget_(budget) { }
+
+void Inliner::run() {
+    functions_.clear();
+    inlined_calls_.clear();
+    result_ = IR();
+
+    collect();
+    mark_recursion();
+
+    std::string caller;
+    std::vector<std::set<std::string> > scopes;   // 调用者中已定义的局部变量, 用于检查被调函数引用的全局变量是否被遮蔽
+    int depth = 0;                                 // 块嵌套层次
+    int stack = 0;                                 // 静态的栈深度
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        const PCode &code = ir_.at(pos);
+
+        switch (code.type()) {
+            case PCode::Type::kStartFunc:
+                caller = code.first();
+                scopes.assign(1, std::set<std::string>());
+                depth = 1;
+                stack = 0;
+                break;
+            case PCode::Type::kEndFunc:
+                caller.clear();
+                scopes.clear();
+                depth = 0;
+                break;
+            case PCode::Type::kEnterScope:
+                scopes.push_back(std::set<std::string>());
+                depth = std::stoi(code.first());
+                break;
+            case PCode::Type::kLeaveScope:
+                if (!scopes.empty()) {
+                    scopes.pop_back();
+                }
+                depth = std::stoi(code.first()) - 1;
+                break;
+            case PCode::Type::kArgInteger:
+            case PCode::Type::kArgIntegerArray:
+            case PCode::Type::kArgReal:
+            case PCode::Type::kArgRealArray:
+            case PCode::Type::kVarInteger:
+            case PCode::Type::kVarIntegerArray:
+            case PCode::Type::kVarReal:
+            case PCode::Type::kVarRealArray:
+                if (!scopes.empty()) {
+                    scopes.back().insert(code.first());
+                }
+                break;
+            case PCode::Type::kCall:
+            case PCode::Type::kTailCall: {
+                if (caller.empty() || !is_candidate(code.first(), caller)) {
+                    break;
+                }
+                const Function &callee = functions_.at(code.first());
+                // 被调函数须在调用处之前定义; 含跳转时栈中只能有实参
+                if (callee.end > pos || (callee.has_control_flow && stack != callee.parameters)) {
+                    break;
+                }
+                bool is_shadowed = false;
+                for (const std::string &global : callee.globals) {
+                    for (const std::set<std::string> &scope : scopes) {
+                        if (scope.count(global) > 0) {
+                            is_shadowed = true;
+                        }
+                    }
+                }
+                if (is_shadowed) {
+                    break;
+                }
+
+                expand(code.first(), depth, (int)inlined_calls_.size());
+                inlined_calls_.push_back(InlinedCall{caller, code.first(), pos, callee.size});
+                stack += stack_effect(code);
+                continue;
+            }
+            default:
+                break;
+        }
+
+        result_.add(code);
+        stack += stack_effect(code);
+    }
+}
+
+const IR &Inliner::ir() const {
+    return inlined_calls_.empty() ? ir_ : result_;
+}
+
+const std::vector<Inliner::InlinedCall> &Inliner::inlined_calls() const {
+    return inlined_calls_;
+}
+
+void Inliner::print_report(std::ostream &os) const {
+    os << "函数内联 (函数体上限 " << budget_ << " 条指令), 共内联 " << inlined_calls_.size() << " 处调用:" << std::endl;
+    for (const InlinedCall &call : inlined_calls_) {
+        os << "    " << call.position << ":\t" << call.caller << " 调用 " << call.callee << " (" << call.size << " 条指令)" << std::endl;
+    }
+}
+
+void Inliner::collect() {
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        if (ir_.at(pos).type() != PCode::Type::kStartFunc) {
+            continue;
+        }
+
+        Function function{pos, pos, 0, 0, false, false, false, std::set<std::string>(), std::set<std::string>()};
+        std::vector<std::set<std::string> > scopes(1);
+        int body = pos + 1;
+        for (; body < ir_.size(); ++body) {
+            PCode::Type type = ir_.at(body).type();
+            if (type == PCode::Type::kArgIntegerArray || type == PCode::Type::kArgRealArray) {
+                function.has_array_parameter = true;
+            } else if (type != PCode::Type::kArgInteger && type != PCode::Type::kArgReal) {
+                break;
+            }
+            scopes.back().insert(ir_.at(body).first());
+            ++function.parameters;
+        }
+
+        // 引用的变量先在函数内的块中按名字查找, 找不到的即为全局变量
+        auto reference = [&scopes, &function](const std::string &name) {
+            if (is_literal(name)) {
+                return;
+            }
+            for (const std::set<std::string> &scope : scopes) {
+                if (scope.count(name) > 0) {
+                    return;
+                }
+            }
+            function.globals.insert(name);
+        };
+
+        int end = body;
+        for (; end < ir_.size() && ir_.at(end).type() != PCode::Type::kEndFunc; ++end) {
+            const PCode &code = ir_.at(end);
+            switch (code.type()) {
+                case PCode::Type::kEnterScope:
+                    scopes.push_back(std::set<std::string>());
+                    break;
+                case PCode::Type::kLeaveScope:
+                    scopes.pop_back();
+                    break;
+                case PCode::Type::kVarInteger:
+                case PCode::Type::kVarReal:
+                    scopes.back().insert(code.first());
+                    break;
+                case PCode::Type::kVarIntegerArray:
+                case PCode::Type::kVarRealArray:
+                    reference(code.second());
+                    scopes.back().insert(code.first());
+                    break;
+                case PCode::Type::kCall:
+                case PCode::Type::kTailCall:
+                    function.callees.insert(code.first());
+                    break;
+                case PCode::Type::kLabel:
+                case PCode::Type::kJump:
+                case PCode::Type::kJumpZero:
+                case PCode::Type::kJumpNotZero:
+                    function.has_control_flow = true;
+                    break;
+                case PCode::Type::kReturn:
+                    if (end + 1 >= ir_.size() || ir_.at(end + 1).type() != PCode::Type::kEndFunc) {
+                        function.has_control_flow = true;
+                    }
+                    break;
+                default:
+                    if (has_variable_first(code.type())) {
+                        reference(code.first());
+                    }
+                    if (has_variable_second(code.type())) {
+                        reference(code.second());
+                    }
+                    break;
+            }
+        }
+
+        function.end = end;
+        function.size = end - body;
+        functions_[ir_.at(pos).first()] = function;
+        pos = end;
+    }
+}
+
+// 沿调用关系深度优先搜索, 能回到自身的函数为递归函数
+void Inliner::mark_recursion() {
+    for (auto &entry : functions_) {
+        std::set<std::string> visited;
+        std::vector<std::string> pending(entry.second.callees.begin(), entry.second.callees.end());
+        while (!pending.empty() && !entry.second.is_recursive) {
+            std::string name = pending.back();
+            pending.pop_back();
+            if (name == entry.first) {
+                entry.second.is_recursive = true;
+            } else if (visited.insert(name).second && functions_.count(name) > 0) {
+                const std::set<std::string> &callees = functions_.at(name).callees;
+                pending.insert(pending.end(), callees.begin(), callees.end());
+            }
+        }
+    }
+}
+
+bool Inliner::is_candidate(const std::string &name, const std::string &caller) const {
+    std::map<std::string, Function>::const_iterator it = functions_.find(name);
+    if (it == functions_.end() || name == caller || name == "main") {
+        return false;
+    }
+    const Function &function = it->second;
+    return !function.is_recursive && !function.has_array_parameter && function.size <= budget_;
+}
+
+void Inliner::expand(const std::string &callee, const int &depth, const int &sequence) {
+    const Function &function = functions_.at(callee);
+    const std::string suffix = "@" + callee + "." + std::to_string(sequence);
+    const int indent = ir_.at(function.start + 1).indent();
+    const bool is_real = ir_.at(function.end).second() == "real";
+    const PCode::Type var_type = is_real ? PCode::Type::kVarReal : PCode::Type::kVarInteger;
+    const PCode::Type push_type = is_real ? PCode::Type::kPushReal : PCode::Type::kPushInteger;
+    const PCode::Type pop_type = is_real ? PCode::Type::kPopReal : PCode::Type::kPopInteger;
+    const std::string result = "_inline_result" + suffix;
+    const std::string end = "_inline_end" + suffix;
+
+    // 函数体的第 1 层即调用处所在的块, 被调函数中的变量已加上后缀, 无需另开一层块
+    const int shift = depth - 1;
+    std::vector<std::set<std::string> > scopes(1);
+    auto rename = [&scopes, &suffix](const std::string &name) {
+        if (is_literal(name)) {
+            return name;
+        }
+        for (const std::set<std::string> &scope : scopes) {
+            if (scope.count(name) > 0) {
+                return name + suffix;
+            }
+        }
+        return name;
+    };
+
+    if (function.has_control_flow) {
+        result_.add(PCode(var_type, result, indent));
+    }
+
+    // 实参按形参的逆序入栈, ARG 指令正是按出栈顺序排列的
+    int body = function.start + 1;
+    for (int i = 0; i < function.parameters; ++i, ++body) {
+        const PCode &argument = ir_.at(body);
+        scopes.back().insert(argument.first());
+        if (argument.type() == PCode::Type::kArgReal) {
+            result_.add(PCode(PCode::Type::kVarReal, argument.first() + suffix, indent));
+            result_.add(PCode(PCode::Type::kPopReal, argument.first() + suffix, indent));
+        } else {
+            result_.add(PCode(PCode::Type::kVarInteger, argument.first() + suffix, indent));
+            result_.add(PCode(PCode::Type::kPopInteger, argument.first() + suffix, indent));
+        }
+    }
+
+    for (int pos = body; pos < function.end; ++pos) {
+        PCode code = ir_.at(pos);
+        switch (code.type()) {
+            case PCode::Type::kEnterScope:
+                scopes.push_back(std::set<std::string>());
+                code.set(code.type(), std::to_string(std::stoi(code.first()) + shift));
+                break;
+            case PCode::Type::kLeaveScope:
+                scopes.pop_back();
+                code.set(code.type(), std::to_string(std::stoi(code.first()) + shift));
+                break;
+            case PCode::Type::kVarInteger:
+            case PCode::Type::kVarReal:
+                scopes.back().insert(code.first());
+                code.set(code.type(), code.first() + suffix);
+                break;
+            case PCode::Type::kVarIntegerArray:
+            case PCode::Type::kVarRealArray: {
+                std::string size = rename(code.second());
+                scopes.back().insert(code.first());
+                code.set(code.type(), code.first() + suffix, size);
+                break;
+            }
+            case PCode::Type::kTailCall:
+                // 内联后不再处于尾位置
+                code.set(PCode::Type::kCall);
+                break;
+            case PCode::Type::kLabel:
+            case PCode::Type::kJump:
+            case PCode::Type::kJumpZero:
+            case PCode::Type::kJumpNotZero:
+                code.set(code.type(), code.first() + suffix);
+                break;
+            case PCode::Type::kReturn:
+                // 末尾的 ret 直接将返回值留在栈上
+                if (pos + 1 < function.end) {
+                    result_.add(PCode(pop_type, result, indent));
+                    result_.add(PCode(PCode::Type::kJump, end, indent));
+                } else if (function.has_control_flow) {
+                    result_.add(PCode(pop_type, result, indent));
+                }
+                continue;
+            default:
+                if (has_variable_first(code.type()) && has_variable_second(code.type())) {
+                    code.set(code.type(), rename(code.first()), rename(code.second()));
+                } else if (has_variable_first(code.type())) {
+                    code.set(code.type(), rename(code.first()));
+                }
+                break;
+        }
+        result_.add(code);
+    }
+
+    // 执行到 ENDFUNC 时按返回类型返回 0
+    bool has_final_return = function.end > body && ir_.at(function.end - 1).type() == PCode::Type::kReturn;
+    if (!has_final_return) {
+        result_.add(PCode(push_type, is_real ? "0.0" : "0", indent));
+        if (function.has_control_flow) {
+            result_.add(PCode(pop_type, result, indent));
+        }
+    }
+    if (function.has_control_flow) {
+        result_.add(PCode(PCode::Type::kLabel, end, indent));
+        result_.add(PCode(push_type, result, indent));
+    }
+}
+
+int Inliner::stack_effect(const PCode &code) const {
+    switch (code.type()) {
+        case PCode::Type::kCall:
+        case PCode::Type::kTailCall: {
+            std::map<std::string, Function>::const_iterator it = functions_.find(code.first());
+            return it == functions_.end() ? 1 : 1 - it->second.parameters;
+        }
+        case PCode::Type::kPushInteger:
+        case PCode::Type::kPushReal:
+        case PCode::Type::kPushIntegerArray:
+        case PCode::Type::kPushRealArray:
+            return 1;
+        case PCode::Type::kArgInteger:
+        case PCode::Type::kArgIntegerArray:
+        case PCode::Type::kArgReal:
+        case PCode::Type::kArgRealArray:
+        case PCode::Type::kReturn:
+        case PCode::Type::kPop:
+        case PCode::Type::kPopInteger:
+        case PCode::Type::kPopReal:
+        case PCode::Type::kPopIntegerArray:
+        case PCode::Type::kPopRealArray:
+        case PCode::Type::kAddInteger:
+        case PCode::Type::kAddReal:
+        case PCode::Type::kSubInteger:
+        case PCode::Type::kSubReal:
+        case PCode::Type::kMulInteger:
+        case PCode::Type::kMulReal:
+        case PCode::Type::kDivInteger:
+        case PCode::Type::kDivReal:
+        case PCode::Type::kCompareEqualInteger:
+        case PCode::Type::kCompareEqualReal:
+        case PCode::Type::kCompareNotEqualInteger:
+        case PCode::Type::kCompareNotEqualReal:
+        case PCode::Type::kCompareGreaterThanInteger:
+        case PCode::Type::kCompareGreaterThanReal:
+        case PCode::Type::kCompareLessThanInteger:
+        case PCode::Type::kCompareLessThanReal:
+        case PCode::Type::kCompareGreaterEqualInteger:
+        case PCode::Type::kCompareGreaterEqualReal:
+        case PCode::Type::kCompareLessEqualInteger:
+        case PCode::Type::kCompareLessEqualReal:
+        case PCode::Type::kAnd:
+        case PCode::Type::kOr:
+        case PCode::Type::kJumpZero:
+        case PCode::Type::kJumpNotZero:
+        case PCode::Type::kPrint:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+bool Inliner::is_literal(const std::string &name) {
+    return Recognition::is_integer(name) || Recognition::is_real(name);
+}
+
+bool Inliner::has_variable_first(const PCode::Type &type) {
+    switch (type) {
+        case PCode::Type::kPushInteger:
+        case PCode::Type::kPushIntegerArray:
+        case PCode::Type::kPushReal:
+        case PCode::Type::kPushRealArray:
+        case PCode::Type::kPopInteger:
+        case PCode::Type::kPopIntegerArray:
+        case PCode::Type::kPopReal:
+        case PCode::Type::kPopRealArray:
+        case PCode::Type::kReadInt:
+        case PCode::Type::kReadIntArray:
+        case PCode::Type::kReadReal:
+        case PCode::Type::kReadRealArray:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Inliner::has_variable_second(const PCode::Type &type) {
+    switch (type) {
+        case PCode::Type::kPushIntegerArray:
+        case PCode::Type::kPushRealArray:
+        case PCode::Type::kPopIntegerArray:
+        case PCode::Type::kPopRealArray:
+        case PCode::Type::kReadIntArray:
+        case PCode::Type::kReadRealArray:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,1368 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include "include/jit.h"
+
+#ifdef CMM_HAS_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+
+// 通用寄存器编号, 与 x86-64 指令编码一致
+enum Register {
+    kRax = 0, kRcx = 1, kRdx = 2, kRbx = 3, kRsp = 4, kRbp = 5, kRsi = 6, kRdi = 7,
+    kR8 = 8, kR9 = 9, kR10 = 10, kR11 = 11, kR12 = 12, kR13 = 13, kR14 = 14, kR15 = 15,
+};
+
+// 条件码, 与 jcc/setcc 指令编码一致
+enum Condition {
+    kBelow = 0x2, kAboveEqual = 0x3, kEqual = 0x4, kNotEqual = 0x5, kAbove = 0x7,
+    kParity = 0xA, kNotParity = 0xB, kLess = 0xC, kGreaterEqual = 0xD, kLessEqual = 0xE, kGreater = 0xF,
+};
+
+// 本地代码中寄存器的用途:
+//   rbx 当前帧寄存器区, r12 全局区, r13 虚拟机, r14 返回值地址, r15 数组描述表
+//   rax, rcx, rdx 与 xmm0 ~ xmm3 为临时寄存器
+//   rsi, rdi, r8 ~ r11 与 xmm4 ~ xmm15 存放常驻的整数与实数局部寄存器, 调用辅助函数时不保留
+static const Register kBase = kRbx;
+static const Register kGlobals = kR12;
+static const Register kSimulator = kR13;
+static const Register kResult = kR14;
+static const Register kArrays = kR15;
+static const Register kIntegerHomes[] = {kRsi, kRdi, kR8, kR9, kR10, kR11};
+static const int kRealHomes[] = {4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+// 选择常驻寄存器时, 循环中的使用按嵌套层数加权, 每层乘以 kLoopWeight
+static const long long kLoopWeight = 8;
+static const long long kMaxWeight = 1LL << 24;
+
+// Jit::ArrayView 的内存布局: 元素起始地址位于偏移 0, 元素数量位于偏移 8
+static const int kElementsOffset = 0;
+static const int kSizeOffset = 8;
+
+// Value 的内存布局: 类型标记位于偏移 0, 值位于偏移 8
+static const int kTagOffset = 0;
+static const int kPayloadOffset = 8;
+
+// 内存操作数 [base + disp]
+struct Memory {
+    Register base;
+    int disp;
+
+    Memory(const Register &base, const int &disp) : base(base), disp(disp) { }
+
+    Memory offset(const int &delta) const {
+        return Memory(base, disp + delta);
+    }
+};
+
+// 只实现翻译所需指令的 x86-64 汇编器, 跳转统一使用 32 位偏移, 在函数结束时回填
+class Assembler {
+public:
+    std::vector<uint8_t> &code() {
+        return code_;
+    }
+
+    int new_label() {
+        labels_.push_back(-1);
+        return (int)labels_.size() - 1;
+    }
+
+    void bind(const int &label) {
+        labels_[label] = (int)code_.size();
+    }
+
+    // 回填当前函数中的跳转, 之后可以开始下一个函数
+    void resolve() {
+        for (const std::pair<int, int> &fixup : fixups_) {
+            int32_t offset = labels_[fixup.second] - (fixup.first + 4);
+            std::memcpy(&code_[fixup.first], &offset, 4);
+        }
+        fixups_.clear();
+        labels_.clear();
+    }
+
+    void mov_load32(const Register &dst, const Memory &src) {
+        emit_memory(0, false, {0x8B}, dst, src);
+    }
+
+    void mov_store32(const Memory &dst, const Register &src) {
+        emit_memory(0, false, {0x89}, src, dst);
+    }
+
+    void mov_load64(const Register &dst, const Memory &src) {
+        emit_memory(0, true, {0x8B}, dst, src);
+    }
+
+    void mov_store64(const Memory &dst, const Register &src) {
+        emit_memory(0, true, {0x89}, src, dst);
+    }
+
+    void mov_store_imm32(const Memory &dst, const int32_t &imm) {
+        emit_memory(0, false, {0xC7}, kRax, dst);
+        emit32(imm);
+    }
+
+    // 将 32 位立即数符号扩展后写入 8 字节
+    void mov_store_imm64(const Memory &dst, const int32_t &imm) {
+        emit_memory(0, true, {0xC7}, kRax, dst);
+        emit32(imm);
+    }
+
+    void mov_imm32(const Register &dst, const int32_t &imm) {
+        if (dst >= 8) {
+            byte(0x41);
+        }
+        byte((uint8_t)(0xB8 + (dst & 7)));
+        emit32(imm);
+    }
+
+    void mov_imm64(const Register &dst, const uint64_t &imm) {
+        byte((uint8_t)(0x48 | (dst >= 8 ? 1 : 0)));
+        byte((uint8_t)(0xB8 + (dst & 7)));
+        for (int i = 0; i < 8; ++i) {
+            byte((uint8_t)(imm >> (i * 8)));
+        }
+    }
+
+    void mov64(const Register &dst, const Register &src) {
+        emit_register(0, true, {0x89}, src, dst);
+    }
+
+    void mov32(const Register &dst, const Register &src) {
+        emit_register(0, false, {0x8B}, dst, src);
+    }
+
+    void add32(const Register &dst, const Memory &src) {
+        emit_memory(0, false, {0x03}, dst, src);
+    }
+
+    void add32(const Register &dst, const Register &src) {
+        emit_register(0, false, {0x03}, dst, src);
+    }
+
+    void add32_imm(const Register &dst, const int32_t &imm) {
+        emit_register(0, false, {0x81}, kRax, dst);
+        emit32(imm);
+    }
+
+    void add64(const Register &dst, const Register &src) {
+        emit_register(0, true, {0x03}, dst, src);
+    }
+
+    void sub32(const Register &dst, const Memory &src) {
+        emit_memory(0, false, {0x2B}, dst, src);
+    }
+
+    void sub32(const Register &dst, const Register &src) {
+        emit_register(0, false, {0x2B}, dst, src);
+    }
+
+    void sub32_imm(const Register &dst, const int32_t &imm) {
+        emit_register(0, false, {0x81}, kRbp, dst);
+        emit32(imm);
+    }
+
+    void imul32(const Register &dst, const Memory &src) {
+        emit_memory(0, false, {0x0F, 0xAF}, dst, src);
+    }
+
+    void imul32(const Register &dst, const Register &src) {
+        emit_register(0, false, {0x0F, 0xAF}, dst, src);
+    }
+
+    // dst = dst * imm
+    void imul32_imm(const Register &dst, const int32_t &imm) {
+        emit_register(0, false, {0x69}, dst, dst);
+        emit32(imm);
+    }
+
+    void cmp32(const Register &left, const Memory &right) {
+        emit_memory(0, false, {0x3B}, left, right);
+    }
+
+    void cmp32(const Register &left, const Register &right) {
+        emit_register(0, false, {0x3B}, left, right);
+    }
+
+    void cmp32_imm(const Register &left, const int32_t &imm) {
+        emit_register(0, false, {0x81}, kRdi, left);
+        emit32(imm);
+    }
+
+    void cmp32_imm8(const Memory &left, const int8_t &imm) {
+        emit_memory(0, false, {0x83}, kRdi, left);
+        byte((uint8_t)imm);
+    }
+
+    void cmp32_imm8(const Register &left, const int8_t &imm) {
+        emit_register(0, false, {0x83}, kRdi, left);
+        byte((uint8_t)imm);
+    }
+
+    void test32(const Register &left, const Register &right) {
+        emit_register(0, false, {0x85}, right, left);
+    }
+
+    void test64(const Register &left, const Register &right) {
+        emit_register(0, true, {0x85}, right, left);
+    }
+
+    void neg32(const Register &dst) {
+        emit_register(0, false, {0xF7}, kRbx, dst);
+    }
+
+    void cdq() {
+        byte(0x99);
+    }
+
+    void idiv32(const Register &divisor) {
+        emit_register(0, false, {0xF7}, kRdi, divisor);
+    }
+
+    void shl64_1(const Register &dst) {
+        emit_register(0, true, {0xD1}, kRsp, dst);
+    }
+
+    void shr64_1(const Register &dst) {
+        emit_register(0, true, {0xD1}, kRbp, dst);
+    }
+
+    void shl64_imm8(const Register &dst, const uint8_t &imm) {
+        emit_register(0, true, {0xC1}, kRsp, dst);
+        byte(imm);
+    }
+
+    void setcc(const Condition &condition, const Register &dst) {
+        emit_register(0, false, {0x0F, (uint8_t)(0x90 + condition)}, kRax, dst);
+    }
+
+    void and8(const Register &dst, const Register &src) {
+        emit_register(0, false, {0x20}, src, dst);
+    }
+
+    void or8(const Register &dst, const Register &src) {
+        emit_register(0, false, {0x08}, src, dst);
+    }
+
+    void movzx8(const Register &dst, const Register &src) {
+        emit_register(0, false, {0x0F, 0xB6}, dst, src);
+    }
+
+    void movsd_load(const int &dst, const Memory &src) {
+        emit_memory(0xF2, false, {0x0F, 0x10}, (Register)dst, src);
+    }
+
+    void movsd_store(const Memory &dst, const int &src) {
+        emit_memory(0xF2, false, {0x0F, 0x11}, (Register)src, dst);
+    }
+
+    void movsd(const int &dst, const int &src) {
+        emit_register(0xF2, false, {0x0F, 0x10}, (Register)dst, (Register)src);
+    }
+
+    // addsd 0x58, mulsd 0x59, subsd 0x5C, divsd 0x5E
+    void sse_arith(const uint8_t &opcode, const int &dst, const Memory &src) {
+        emit_memory(0xF2, false, {0x0F, opcode}, (Register)dst, src);
+    }
+
+    void sse_arith(const uint8_t &opcode, const int &dst, const int &src) {
+        emit_register(0xF2, false, {0x0F, opcode}, (Register)dst, (Register)src);
+    }
+
+    void divsd(const int &dst, const int &src) {
+        emit_register(0xF2, false, {0x0F, 0x5E}, (Register)dst, (Register)src);
+    }
+
+    void ucomisd(const int &left, const Memory &right) {
+        emit_memory(0x66, false, {0x0F, 0x2E}, (Register)left, right);
+    }
+
+    void ucomisd(const int &left, const int &right) {
+        emit_register(0x66, false, {0x0F, 0x2E}, (Register)left, (Register)right);
+    }
+
+    void cvtsi2sd(const int &dst, const Memory &src) {
+        emit_memory(0xF2, false, {0x0F, 0x2A}, (Register)dst, src);
+    }
+
+    void cvtsi2sd(const int &dst, const Register &src) {
+        emit_register(0xF2, false, {0x0F, 0x2A}, (Register)dst, src);
+    }
+
+    void cvttsd2si(const Register &dst, const Memory &src) {
+        emit_memory(0xF2, false, {0x0F, 0x2C}, dst, src);
+    }
+
+    void movq_to_xmm(const int &dst, const Register &src) {
+        emit_register(0x66, true, {0x0F, 0x6E}, (Register)dst, src);
+    }
+
+    void movq_from_xmm(const Register &dst, const int &src) {
+        emit_register(0x66, true, {0x0F, 0x7E}, (Register)src, dst);
+    }
+
+    void jcc(const Condition &condition, const int &label) {
+        byte(0x0F);
+        byte((uint8_t)(0x80 + condition));
+        fixup(label);
+    }
+
+    void jmp(const int &label) {
+        byte(0xE9);
+        fixup(label);
+    }
+
+    // 调用绝对地址处的函数, 会破坏 rax
+    void call(const void *function) {
+        mov_imm64(kRax, (uint64_t)(uintptr_t)function);
+        emit_register(0, false, {0xFF}, kRdx, kRax);
+    }
+
+    void push(const Register &reg) {
+        if (reg >= 8) {
+            byte(0x41);
+        }
+        byte((uint8_t)(0x50 + (reg & 7)));
+    }
+
+    void pop(const Register &reg) {
+        if (reg >= 8) {
+            byte(0x41);
+        }
+        byte((uint8_t)(0x58 + (reg & 7)));
+    }
+
+    void ret() {
+        byte(0xC3);
+    }
+
+private:
+    std::vector<uint8_t> code_;
+    std::vector<int> labels_;                        // 标签在代码中的位置
+    std::vector<std::pair<int, int> > fixups_;       // 待回填的 (偏移位置, 标签)
+
+    void byte(const uint8_t &value) {
+        code_.push_back(value);
+    }
+
+    void emit32(const int32_t &value) {
+        for (int i = 0; i < 4; ++i) {
+            byte((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    void fixup(const int &label) {
+        fixups_.push_back(std::make_pair((int)code_.size(), label));
+        emit32(0);
+    }
+
+    void prefix(const uint8_t &legacy, const bool &wide, const int &reg, const int &rm, const bool &force_rex) {
+        if (legacy != 0) {
+            byte(legacy);
+        }
+        uint8_t rex = (uint8_t)(0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | (rm >> 3));
+        if (rex != 0x40 || force_rex) {
+            byte(rex);
+        }
+    }
+
+    // reg 字段为寄存器, r/m 字段为 [base + disp32]
+    void emit_memory(const uint8_t &legacy, const bool &wide, std::initializer_list<uint8_t> opcode, const Register &reg, const Memory &memory) {
+        prefix(legacy, wide, reg, memory.base, false);
+        for (uint8_t op : opcode) {
+            byte(op);
+        }
+        byte((uint8_t)(0x80 | ((reg & 7) << 3) | (memory.base & 7)));
+        if ((memory.base & 7) == kRsp) {
+            byte(0x24);
+        }
+        emit32(memory.disp);
+    }
+
+    // reg 与 r/m 字段均为寄存器
+    void emit_register(const uint8_t &legacy, const bool &wide, std::initializer_list<uint8_t> opcode, const Register &reg, const Register &rm) {
+        prefix(legacy, wide, reg, rm, false);
+        for (uint8_t op : opcode) {
+            byte(op);
+        }
+        byte((uint8_t)(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+};
+
+// 逐个函数生成本地代码
+class FunctionCompiler {
+public:
+    FunctionCompiler(Assembler &as, const BytecodeProgram &program, const Jit::Helpers &helpers) :
+            as_(as), program_(program), helpers_(helpers) { }
+
+    void compile(const int &begin, const int &end) {
+        begin_ = begin;
+        pc_labels_.clear();
+        for (int pc = begin; pc < end; ++pc) {
+            pc_labels_.push_back(as_.new_label());
+        }
+        failures_.clear();
+        error_exit_ = as_.new_label();
+        epilogue_ = as_.new_label();
+        allocate(begin, end);
+
+        // 保存被调用者保存的寄存器, 压入 5 个寄存器后栈恰好按 16 字节对齐
+        as_.push(kRbx);
+        as_.push(kR12);
+        as_.push(kR13);
+        as_.push(kR14);
+        as_.push(kR15);
+        as_.mov64(kSimulator, kRdi);
+        as_.mov64(kBase, kRsi);
+        as_.mov64(kGlobals, kRdx);
+        as_.mov64(kResult, kRcx);
+        load_arrays();
+        reload_all();
+
+        for (int pc = begin; pc < end; ++pc) {
+            as_.bind(pc_labels_[pc - begin]);
+            compile_instruction(pc);
+        }
+
+        // 运行时错误: 记录错误后返回非零值
+        for (const std::pair<int, int> &failure : failures_) {
+            as_.bind(failure.first);
+            call_helper((const void *)helpers_.fail, failure.second);
+            as_.jmp(error_exit_);
+        }
+        as_.bind(error_exit_);
+        as_.mov_imm32(kRax, 1);
+        as_.bind(epilogue_);
+        as_.pop(kR15);
+        as_.pop(kR14);
+        as_.pop(kR13);
+        as_.pop(kR12);
+        as_.pop(kRbx);
+        as_.ret();
+
+        as_.resolve();
+    }
+
+private:
+    // 局部寄存器的值存放在哪里
+    enum class Kind {
+        kMemory,
+        kInteger,                        // 通用寄存器, 整数与数组句柄
+        kReal,                           // xmm 寄存器
+    };
+
+    struct Home {
+        Kind kind;
+        int reg;
+    };
+
+    // 局部寄存器被直接读写值的方式与加权的次数
+    struct Usage {
+        Kind kind;
+        bool is_mixed;                   // 既按整数又按实数读写, 不能常驻
+        long long weight;
+    };
+
+    enum class IntegerOp {
+        kAdd,
+        kSub,
+        kMul,
+        kCompare,
+    };
+
+    Assembler &as_;
+    const BytecodeProgram &program_;
+    const Jit::Helpers &helpers_;
+    int begin_;
+    std::vector<int> pc_labels_;
+    std::vector<std::pair<int, int> > failures_;     // (标签, 出错的指令位置)
+    int error_exit_;
+    int epilogue_;
+    std::vector<Usage> usages_;
+    std::vector<Home> homes_;                        // 下标为局部寄存器
+
+    // 操作数为非负数时位于当前帧, 否则位于全局区
+    static Memory value(const int &operand) {
+        return operand >= 0 ? Memory(kBase, operand * 16) : Memory(kGlobals, ~operand * 16);
+    }
+
+    static Memory tag(const int &operand) {
+        return value(operand).offset(kTagOffset);
+    }
+
+    static Memory payload(const int &operand) {
+        return value(operand).offset(kPayloadOffset);
+    }
+
+    int target(const int &pc) const {
+        return pc_labels_[pc - begin_];
+    }
+
+    // 跳转至 pc 处指令的错误处理代码
+    int failure(const int &pc) {
+        int label = as_.new_label();
+        failures_.push_back(std::make_pair(label, pc));
+        return label;
+    }
+
+    bool is_constant(const int &operand) const {
+        return operand < 0 && ~operand >= program_.global_size();
+    }
+
+    const Value &constant(const int &operand) const {
+        return program_.constants()[~operand - program_.global_size()];
+    }
+
+    bool is_integer_constant(const int &operand) const {
+        return is_constant(operand) && constant(operand).type() == Value::Type::kInt;
+    }
+
+    Kind kind(const int &operand) const {
+        return operand >= 0 && operand < (int)homes_.size() ? homes_[operand].kind : Kind::kMemory;
+    }
+
+    Register integer_home(const int &operand) const {
+        return (Register)homes_[operand].reg;
+    }
+
+    int real_home(const int &operand) const {
+        return homes_[operand].reg;
+    }
+
+    static int jump_target(const Bytecode &code) {
+        switch (code.type()) {
+            case Bytecode::Type::kJump:
+                return code.a();
+            case Bytecode::Type::kJumpZero:
+            case Bytecode::Type::kJumpNotZero:
+                return code.b();
+            case Bytecode::Type::kJumpZeroEqualInteger:
+            case Bytecode::Type::kJumpZeroEqualReal:
+            case Bytecode::Type::kJumpZeroNotEqualInteger:
+            case Bytecode::Type::kJumpZeroNotEqualReal:
+            case Bytecode::Type::kJumpZeroGreaterThanInteger:
+            case Bytecode::Type::kJumpZeroGreaterThanReal:
+            case Bytecode::Type::kJumpZeroLessThanInteger:
+            case Bytecode::Type::kJumpZeroLessThanReal:
+            case Bytecode::Type::kJumpZeroGreaterEqualInteger:
+            case Bytecode::Type::kJumpZeroGreaterEqualReal:
+            case Bytecode::Type::kJumpZeroLessEqualInteger:
+            case Bytecode::Type::kJumpZeroLessEqualReal:
+                return code.c();
+            default:
+                return -1;
+        }
+    }
+
+    void use(const int &operand, const Kind &kind, const long long &weight) {
+        // 全局变量可能被被调函数修改, 不常驻
+        if (operand < 0) {
+            return;
+        }
+        if (operand >= (int)usages_.size()) {
+            usages_.resize((unsigned long)operand + 1, Usage{Kind::kMemory, false, 0});
+        }
+        Usage &usage = usages_[operand];
+        if (usage.kind != Kind::kMemory && usage.kind != kind) {
+            usage.is_mixed = true;
+        }
+        usage.kind = kind;
+        usage.weight = std::min(usage.weight + weight, kMaxWeight);
+    }
+
+    // 记录指令直接读写值的操作数; 只按类型标记读写的操作数不计入, 它们经由内存访问
+    void classify(const Bytecode &code, const long long &weight) {
+        switch (code.type()) {
+            case Bytecode::Type::kMove:
+                if (is_constant(code.b())) {
+                    use(code.a(), constant(code.b()).type() == Value::Type::kInt ? Kind::kInteger : Kind::kReal, weight);
+                }
+                break;
+            case Bytecode::Type::kMoveInteger:
+            case Bytecode::Type::kVarInteger:
+            case Bytecode::Type::kJumpZero:
+            case Bytecode::Type::kJumpNotZero:
+                use(code.a(), Kind::kInteger, weight);
+                break;
+            case Bytecode::Type::kMoveReal:
+            case Bytecode::Type::kVarReal:
+                use(code.a(), Kind::kReal, weight);
+                break;
+            case Bytecode::Type::kIntegerToReal:
+                use(code.a(), Kind::kReal, weight);
+                use(code.b(), Kind::kInteger, weight);
+                break;
+            case Bytecode::Type::kLoadIntegerArray:
+            case Bytecode::Type::kLoadRealArray:
+                use(code.a(), code.type() == Bytecode::Type::kLoadIntegerArray ? Kind::kInteger : Kind::kReal, weight);
+                use(code.b(), Kind::kInteger, weight);
+                use(code.c(), Kind::kInteger, weight);
+                break;
+            case Bytecode::Type::kStoreIntegerArray:
+            case Bytecode::Type::kStoreRealArray:
+                use(code.a(), Kind::kInteger, weight);
+                use(code.b(), Kind::kInteger, weight);
+                break;
+            case Bytecode::Type::kAddInteger:
+            case Bytecode::Type::kSubInteger:
+            case Bytecode::Type::kMulInteger:
+            case Bytecode::Type::kDivInteger:
+            case Bytecode::Type::kCompareEqualInteger:
+            case Bytecode::Type::kCompareNotEqualInteger:
+            case Bytecode::Type::kCompareGreaterThanInteger:
+            case Bytecode::Type::kCompareLessThanInteger:
+            case Bytecode::Type::kCompareGreaterEqualInteger:
+            case Bytecode::Type::kCompareLessEqualInteger:
+                use(code.a(), Kind::kInteger, weight);
+                use(code.b(), Kind::kInteger, weight);
+                use(code.c(), Kind::kInteger, weight);
+                break;
+            case Bytecode::Type::kAddReal:
+            case Bytecode::Type::kSubReal:
+            case Bytecode::Type::kMulReal:
+            case Bytecode::Type::kDivReal:
+                use(code.a(), Kind::kReal, weight);
+                use(code.b(), Kind::kReal, weight);
+                use(code.c(), Kind::kReal, weight);
+                break;
+            case Bytecode::Type::kCompareEqualReal:
+            case Bytecode::Type::kCompareNotEqualReal:
+            case Bytecode::Type::kCompareGreaterThanReal:
+            case Bytecode::Type::kCompareLessThanReal:
+            case Bytecode::Type::kCompareGreaterEqualReal:
+            case Bytecode::Type::kCompareLessEqualReal:
+                use(code.a(), Kind::kInteger, weight);
+                use(code.b(), Kind::kReal, weight);
+                use(code.c(), Kind::kReal, weight);
+                break;
+            case Bytecode::Type::kJumpZeroEqualInteger:
+            case Bytecode::Type::kJumpZeroNotEqualInteger:
+            case Bytecode::Type::kJumpZeroGreaterThanInteger:
+            case Bytecode::Type::kJumpZeroLessThanInteger:
+            case Bytecode::Type::kJumpZeroGreaterEqualInteger:
+            case Bytecode::Type::kJumpZeroLessEqualInteger:
+                use(code.a(), Kind::kInteger, weight);
+                use(code.b(), Kind::kInteger, weight);
+                break;
+            case Bytecode::Type::kJumpZeroEqualReal:
+            case Bytecode::Type::kJumpZeroNotEqualReal:
+            case Bytecode::Type::kJumpZeroGreaterThanReal:
+            case Bytecode::Type::kJumpZeroLessThanReal:
+            case Bytecode::Type::kJumpZeroGreaterEqualReal:
+            case Bytecode::Type::kJumpZeroLessEqualReal:
+                use(code.a(), Kind::kReal, weight);
+                use(code.b(), Kind::kReal, weight);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // 选出加权使用次数最多的整数与实数局部寄存器常驻机器寄存器, 循环由向后跳转确定
+    // 常驻寄存器的类型标记仍写入内存; 调用辅助函数或按类型标记读取前写回值, 之后重新读取
+    void allocate(const int &begin, const int &end) {
+        std::vector<long long> weights((unsigned long)(end - begin), 1);
+        for (int pc = begin; pc < end; ++pc) {
+            int loop = jump_target(program_.at(pc));
+            if (loop >= begin && loop <= pc) {
+                for (int i = loop; i <= pc; ++i) {
+                    weights[i - begin] = std::min(weights[i - begin] * kLoopWeight, kMaxWeight);
+                }
+            }
+        }
+        usages_.clear();
+        for (int pc = begin; pc < end; ++pc) {
+            classify(program_.at(pc), weights[pc - begin]);
+        }
+
+        std::vector<int> candidates;
+        for (int operand = 0; operand < (int)usages_.size(); ++operand) {
+            if (usages_[operand].kind != Kind::kMemory && !usages_[operand].is_mixed) {
+                candidates.push_back(operand);
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [this](const int &left, const int &right) {
+            return usages_[left].weight > usages_[right].weight;
+        });
+        homes_.assign(usages_.size(), Home{Kind::kMemory, 0});
+        int integers = 0;
+        int reals = 0;
+        for (int operand : candidates) {
+            if (usages_[operand].kind == Kind::kInteger && integers < (int)(sizeof(kIntegerHomes) / sizeof(kIntegerHomes[0]))) {
+                homes_[operand] = Home{Kind::kInteger, kIntegerHomes[integers++]};
+            } else if (usages_[operand].kind == Kind::kReal && reals < (int)(sizeof(kRealHomes) / sizeof(kRealHomes[0]))) {
+                homes_[operand] = Home{Kind::kReal, kRealHomes[reals++]};
+            }
+        }
+    }
+
+    // 将常驻寄存器的值写回内存
+    void spill(const int &operand) {
+        if (kind(operand) == Kind::kInteger) {
+            as_.mov_store32(payload(operand), integer_home(operand));
+        } else if (kind(operand) == Kind::kReal) {
+            as_.movsd_store(payload(operand), real_home(operand));
+        }
+    }
+
+    // 从内存重新读取常驻寄存器的值
+    void reload(const int &operand) {
+        if (kind(operand) == Kind::kInteger) {
+            as_.mov_load32(integer_home(operand), payload(operand));
+        } else if (kind(operand) == Kind::kReal) {
+            as_.movsd_load(real_home(operand), payload(operand));
+        }
+    }
+
+    void spill_all() {
+        for (int operand = 0; operand < (int)homes_.size(); ++operand) {
+            spill(operand);
+        }
+    }
+
+    void reload_all() {
+        for (int operand = 0; operand < (int)homes_.size(); ++operand) {
+            reload(operand);
+        }
+    }
+
+    // 读取数组描述表的位置, 辅助函数定义或释放数组后表可能已重新分配
+    void load_arrays() {
+        as_.mov_imm64(kRcx, (uint64_t)(uintptr_t)helpers_.arrays);
+        as_.mov_load64(kArrays, Memory(kRcx, 0));
+    }
+
+    // 将整数操作数的值读入 dst
+    void load_integer(const Register &dst, const int &operand) {
+        if (kind(operand) == Kind::kInteger) {
+            if (integer_home(operand) != dst) {
+                as_.mov32(dst, integer_home(operand));
+            }
+        } else if (is_integer_constant(operand)) {
+            as_.mov_imm32(dst, constant(operand).int_value());
+        } else {
+            as_.mov_load32(dst, payload(operand));
+        }
+    }
+
+    // 整数操作数所在的寄存器, 不常驻时读入 scratch
+    Register integer_register(const int &operand, const Register &scratch) {
+        if (kind(operand) == Kind::kInteger) {
+            return integer_home(operand);
+        }
+        load_integer(scratch, operand);
+        return scratch;
+    }
+
+    // dst = dst op operand, 比较时只设置标志位; 常量直接编码为立即数
+    void integer_op(const IntegerOp &op, const Register &dst, const int &operand) {
+        if (kind(operand) == Kind::kInteger) {
+            Register src = integer_home(operand);
+            switch (op) {
+                case IntegerOp::kAdd: as_.add32(dst, src); break;
+                case IntegerOp::kSub: as_.sub32(dst, src); break;
+                case IntegerOp::kMul: as_.imul32(dst, src); break;
+                case IntegerOp::kCompare: as_.cmp32(dst, src); break;
+            }
+        } else if (is_integer_constant(operand)) {
+            int32_t imm = constant(operand).int_value();
+            switch (op) {
+                case IntegerOp::kAdd: as_.add32_imm(dst, imm); break;
+                case IntegerOp::kSub: as_.sub32_imm(dst, imm); break;
+                case IntegerOp::kMul: as_.imul32_imm(dst, imm); break;
+                case IntegerOp::kCompare: as_.cmp32_imm(dst, imm); break;
+            }
+        } else {
+            Memory src = payload(operand);
+            switch (op) {
+                case IntegerOp::kAdd: as_.add32(dst, src); break;
+                case IntegerOp::kSub: as_.sub32(dst, src); break;
+                case IntegerOp::kMul: as_.imul32(dst, src); break;
+                case IntegerOp::kCompare: as_.cmp32(dst, src); break;
+            }
+        }
+    }
+
+    // 将实数操作数的值读入 xmm dst
+    void load_real(const int &dst, const int &operand) {
+        if (kind(operand) == Kind::kReal) {
+            if (real_home(operand) != dst) {
+                as_.movsd(dst, real_home(operand));
+            }
+        } else {
+            as_.movsd_load(dst, payload(operand));
+        }
+    }
+
+    // 实数操作数所在的 xmm 寄存器, 不常驻时读入 scratch
+    int real_register(const int &operand, const int &scratch) {
+        if (kind(operand) == Kind::kReal) {
+            return real_home(operand);
+        }
+        load_real(scratch, operand);
+        return scratch;
+    }
+
+    void real_op(const uint8_t &opcode, const int &dst, const int &operand) {
+        if (kind(operand) == Kind::kReal) {
+            as_.sse_arith(opcode, dst, real_home(operand));
+        } else {
+            as_.sse_arith(opcode, dst, payload(operand));
+        }
+    }
+
+    void ucomisd(const int &left, const int &operand) {
+        if (kind(operand) == Kind::kReal) {
+            as_.ucomisd(left, real_home(operand));
+        } else {
+            as_.ucomisd(left, payload(operand));
+        }
+    }
+
+    void store_integer(const Memory &dst, const Register &src) {
+        as_.mov_store_imm32(dst.offset(kTagOffset), (int32_t)Value::Type::kInt);
+        as_.mov_store32(dst.offset(kPayloadOffset), src);
+    }
+
+    void store_real(const Memory &dst, const int &src) {
+        as_.mov_store_imm32(dst.offset(kTagOffset), (int32_t)Value::Type::kReal);
+        as_.movsd_store(dst.offset(kPayloadOffset), src);
+    }
+
+    // 写入整数结果, 值常驻寄存器时内存中只写入类型标记
+    void write_integer(const int &operand, const Register &src) {
+        if (kind(operand) == Kind::kInteger) {
+            if (integer_home(operand) != src) {
+                as_.mov32(integer_home(operand), src);
+            }
+            as_.mov_store_imm32(tag(operand), (int32_t)Value::Type::kInt);
+        } else {
+            store_integer(value(operand), src);
+        }
+    }
+
+    // 写入实数结果, 值常驻寄存器时内存中只写入类型标记
+    void write_real(const int &operand, const int &src) {
+        if (kind(operand) == Kind::kReal) {
+            if (real_home(operand) != src) {
+                as_.movsd(real_home(operand), src);
+            }
+            as_.mov_store_imm32(tag(operand), (int32_t)Value::Type::kReal);
+        } else {
+            store_real(value(operand), src);
+        }
+    }
+
+    void copy_value(const Memory &dst, const Memory &src) {
+        as_.mov_load64(kRcx, src);
+        as_.mov_load64(kRdx, src.offset(8));
+        as_.mov_store64(dst, kRcx);
+        as_.mov_store64(dst.offset(8), kRdx);
+    }
+
+    // 调用辅助函数 helper(虚拟机, 当前帧寄存器, pc)
+    void call_helper(const void *helper, const int &pc) {
+        as_.mov64(kRdi, kSimulator);
+        as_.mov64(kRsi, kBase);
+        as_.mov_imm32(kRdx, pc);
+        as_.call(helper);
+    }
+
+    // 计算数组元素的地址并写入 rdx, 下标越界时跳转至错误处理; 会破坏 rax 与 rcx
+    void element_address(const int &array, const int &index, const int &fail) {
+        load_integer(kRax, array);
+        as_.shl64_imm8(kRax, 4);
+        as_.add64(kRax, kArrays);
+        load_integer(kRcx, index);
+        // 负的下标按无符号数比较时大于任何数组的长度
+        as_.cmp32(kRcx, Memory(kRax, kSizeOffset));
+        as_.jcc(kAboveEqual, fail);
+        as_.shl64_imm8(kRcx, 4);
+        as_.mov_load64(kRdx, Memory(kRax, kElementsOffset));
+        as_.add64(kRdx, kRcx);
+    }
+
+    // 非数值时跳转至错误处理
+    void check_number(const int &operand, const int &fail) {
+        as_.mov_load32(kRax, tag(operand));
+        as_.cmp32_imm8(kRax, (int8_t)Value::Type::kInt);
+        int is_number = as_.new_label();
+        as_.jcc(kEqual, is_number);
+        as_.cmp32_imm8(kRax, (int8_t)Value::Type::kReal);
+        as_.jcc(kNotEqual, fail);
+        as_.bind(is_number);
+    }
+
+    // 将数值按 int 读入 ecx, real 将被截断
+    void load_as_integer(const Memory &src, const int &fail) {
+        int is_real = as_.new_label();
+        int done = as_.new_label();
+        as_.mov_load32(kRax, src.offset(kTagOffset));
+        as_.cmp32_imm8(kRax, (int8_t)Value::Type::kInt);
+        as_.jcc(kNotEqual, is_real);
+        as_.mov_load32(kRcx, src.offset(kPayloadOffset));
+        as_.jmp(done);
+        as_.bind(is_real);
+        as_.cmp32_imm8(kRax, (int8_t)Value::Type::kReal);
+        as_.jcc(kNotEqual, fail);
+        as_.cvttsd2si(kRcx, src.offset(kPayloadOffset));
+        as_.bind(done);
+    }
+
+    // 将数值按 real 读入 xmm0
+    void load_as_real(const Memory &src, const int &fail) {
+        int is_real = as_.new_label();
+        int done = as_.new_label();
+        as_.mov_load32(kRax, src.offset(kTagOffset));
+        as_.cmp32_imm8(kRax, (int8_t)Value::Type::kInt);
+        as_.jcc(kNotEqual, is_real);
+        as_.cvtsi2sd(0, src.offset(kPayloadOffset));
+        as_.jmp(done);
+        as_.bind(is_real);
+        as_.cmp32_imm8(kRax, (int8_t)Value::Type::kReal);
+        as_.jcc(kNotEqual, fail);
+        as_.movsd_load(0, src.offset(kPayloadOffset));
+        as_.bind(done);
+    }
+
+    // 比较两个 real, 结果 (0 或 1) 写入 al; NaN 参与的比较与 C++ 的结果一致
+    void compare_real(const Condition &condition, const int &left, const int &right) {
+        switch (condition) {
+            case kGreater:
+            case kGreaterEqual:
+                ucomisd(real_register(left, 0), right);
+                as_.setcc(condition == kGreater ? kAbove : kAboveEqual, kRax);
+                break;
+            case kLess:
+            case kLessEqual:
+                ucomisd(real_register(right, 0), left);
+                as_.setcc(condition == kLess ? kAbove : kAboveEqual, kRax);
+                break;
+            case kEqual:
+                ucomisd(real_register(left, 0), right);
+                as_.setcc(kEqual, kRax);
+                as_.setcc(kNotParity, kRcx);
+                as_.and8(kRax, kRcx);
+                break;
+            default:
+                ucomisd(real_register(left, 0), right);
+                as_.setcc(kNotEqual, kRax);
+                as_.setcc(kParity, kRcx);
+                as_.or8(kRax, kRcx);
+                break;
+        }
+    }
+
+    static Condition negate(const Condition &condition) {
+        return (Condition)(condition ^ 1);
+    }
+
+    void compile_instruction(const int &pc) {
+        const Bytecode &code = program_.at(pc);
+        int a = code.a();
+        int b = code.b();
+        int c = code.c();
+
+        switch (code.type()) {
+            case Bytecode::Type::kMove:
+                if (is_integer_constant(b) && kind(a) == Kind::kInteger) {
+                    as_.mov_imm32(integer_home(a), constant(b).int_value());
+                    as_.mov_store_imm32(tag(a), (int32_t)Value::Type::kInt);
+                } else if (is_constant(b) && constant(b).type() == Value::Type::kReal && kind(a) == Kind::kReal) {
+                    as_.movsd_load(real_home(a), payload(b));
+                    as_.mov_store_imm32(tag(a), (int32_t)Value::Type::kReal);
+                } else {
+                    spill(b);
+                    copy_value(value(a), value(b));
+                    reload(a);
+                }
+                break;
+            case Bytecode::Type::kMoveInteger:
+                spill(b);
+                load_as_integer(value(b), failure(pc));
+                write_integer(a, kRcx);
+                break;
+            case Bytecode::Type::kMoveReal:
+                spill(b);
+                load_as_real(value(b), failure(pc));
+                write_real(a, 0);
+                break;
+            case Bytecode::Type::kIntegerToReal: {
+                int result = kind(a) == Kind::kReal ? real_home(a) : 0;
+                if (kind(b) == Kind::kInteger) {
+                    as_.cvtsi2sd(result, integer_home(b));
+                } else {
+                    as_.cvtsi2sd(result, payload(b));
+                }
+                write_real(a, result);
+                break;
+            }
+            case Bytecode::Type::kCheck:
+                as_.cmp32_imm8(tag(a), (int8_t)Value::Type::kNone);
+                as_.jcc(kEqual, failure(pc));
+                break;
+            case Bytecode::Type::kVarInteger:
+                as_.mov_store_imm32(tag(a), (int32_t)Value::Type::kNone);
+                if (kind(a) == Kind::kInteger) {
+                    as_.mov_imm32(integer_home(a), 0);
+                } else {
+                    as_.mov_store_imm64(payload(a), 0);
+                }
+                break;
+            case Bytecode::Type::kVarReal:
+                as_.mov_store_imm32(tag(a), (int32_t)Value::Type::kReal);
+                if (kind(a) == Kind::kReal) {
+                    as_.mov_imm32(kRax, 0);
+                    as_.movq_to_xmm(real_home(a), kRax);
+                } else {
+                    as_.mov_store_imm64(payload(a), 0);
+                }
+                break;
+            case Bytecode::Type::kVarIntegerArray:
+            case Bytecode::Type::kVarRealArray:
+            case Bytecode::Type::kPrint:
+            case Bytecode::Type::kReadInt:
+            case Bytecode::Type::kReadReal:
+            case Bytecode::Type::kReadIntArray:
+            case Bytecode::Type::kReadRealArray:
+                spill_all();
+                call_helper((const void *)helpers_.execute, pc);
+                as_.test32(kRax, kRax);
+                as_.jcc(kNotEqual, error_exit_);
+                load_arrays();
+                reload_all();
+                break;
+            case Bytecode::Type::kLoadIntegerArray:
+            case Bytecode::Type::kLoadRealArray:
+                element_address(b, c, failure(pc));
+                if (kind(a) == Kind::kMemory) {
+                    copy_value(value(a), Memory(kRdx, 0));
+                    break;
+                }
+                if (kind(a) == Kind::kInteger) {
+                    as_.mov_load32(integer_home(a), Memory(kRdx, kPayloadOffset));
+                } else {
+                    as_.movsd_load(real_home(a), Memory(kRdx, kPayloadOffset));
+                }
+                as_.mov_load32(kRax, Memory(kRdx, kTagOffset));
+                as_.mov_store32(tag(a), kRax);
+                break;
+            case Bytecode::Type::kStoreIntegerArray:
+            case Bytecode::Type::kStoreRealArray: {
+                int fail = failure(pc);
+                spill(c);
+                check_number(c, fail);
+                element_address(a, b, fail);
+                if (code.type() == Bytecode::Type::kStoreIntegerArray) {
+                    load_as_integer(value(c), fail);
+                    store_integer(Memory(kRdx, 0), kRcx);
+                } else {
+                    load_as_real(value(c), fail);
+                    store_real(Memory(kRdx, 0), 0);
+                }
+                break;
+            }
+            case Bytecode::Type::kAddInteger:
+            case Bytecode::Type::kSubInteger:
+            case Bytecode::Type::kMulInteger: {
+                IntegerOp op = code.type() == Bytecode::Type::kAddInteger ? IntegerOp::kAdd : code.type() == Bytecode::Type::kSubInteger ? IntegerOp::kSub : IntegerOp::kMul;
+                // 结果常驻寄存器且不是右操作数时直接在其中计算
+                Register result = kind(a) == Kind::kInteger && a != c ? integer_home(a) : kRax;
+                load_integer(result, b);
+                integer_op(op, result, c);
+                write_integer(a, result);
+                break;
+            }
+            case Bytecode::Type::kDivInteger: {
+                // 除数为 -1 时取相反数, 避免 INT_MIN / -1 触发硬件异常
+                int divide = as_.new_label();
+                int done = as_.new_label();
+                load_integer(kRcx, c);
+                as_.test32(kRcx, kRcx);
+                as_.jcc(kEqual, failure(pc));
+                load_integer(kRax, b);
+                as_.cmp32_imm8(kRcx, -1);
+                as_.jcc(kNotEqual, divide);
+                as_.neg32(kRax);
+                as_.jmp(done);
+                as_.bind(divide);
+                as_.cdq();
+                as_.idiv32(kRcx);
+                as_.bind(done);
+                write_integer(a, kRax);
+                break;
+            }
+            case Bytecode::Type::kAddReal:
+            case Bytecode::Type::kSubReal:
+            case Bytecode::Type::kMulReal: {
+                uint8_t opcode = code.type() == Bytecode::Type::kAddReal ? 0x58 : code.type() == Bytecode::Type::kSubReal ? 0x5C : 0x59;
+                int result = kind(a) == Kind::kReal && a != c ? real_home(a) : 0;
+                load_real(result, b);
+                real_op(opcode, result, c);
+                write_real(a, result);
+                break;
+            }
+            case Bytecode::Type::kDivReal: {
+                // 与解释器一致, 除数的绝对值小于 1e-8 时报错
+                double epsilon = 1e-8;
+                uint64_t bits;
+                std::memcpy(&bits, &epsilon, sizeof(bits));
+                load_real(1, c);
+                as_.movq_from_xmm(kRax, 1);
+                as_.shl64_1(kRax);
+                as_.shr64_1(kRax);
+                as_.movq_to_xmm(2, kRax);
+                as_.mov_imm64(kRax, bits);
+                as_.movq_to_xmm(3, kRax);
+                as_.ucomisd(3, 2);
+                as_.jcc(kAbove, failure(pc));
+                load_real(0, b);
+                as_.divsd(0, 1);
+                write_real(a, 0);
+                break;
+            }
+            case Bytecode::Type::kCompareEqualInteger:
+            case Bytecode::Type::kCompareNotEqualInteger:
+            case Bytecode::Type::kCompareGreaterThanInteger:
+            case Bytecode::Type::kCompareLessThanInteger:
+            case Bytecode::Type::kCompareGreaterEqualInteger:
+            case Bytecode::Type::kCompareLessEqualInteger:
+                integer_op(IntegerOp::kCompare, integer_register(b, kRax), c);
+                as_.setcc(condition(code.type()), kRax);
+                as_.movzx8(kRax, kRax);
+                write_integer(a, kRax);
+                break;
+            case Bytecode::Type::kCompareEqualReal:
+            case Bytecode::Type::kCompareNotEqualReal:
+            case Bytecode::Type::kCompareGreaterThanReal:
+            case Bytecode::Type::kCompareLessThanReal:
+            case Bytecode::Type::kCompareGreaterEqualReal:
+            case Bytecode::Type::kCompareLessEqualReal:
+                compare_real(condition(code.type()), b, c);
+                as_.movzx8(kRax, kRax);
+                write_integer(a, kRax);
+                break;
+            case Bytecode::Type::kJump:
+                as_.jmp(target(a));
+                break;
+            case Bytecode::Type::kJumpZero:
+            case Bytecode::Type::kJumpNotZero:
+                if (kind(a) == Kind::kInteger) {
+                    as_.test32(integer_home(a), integer_home(a));
+                } else {
+                    as_.cmp32_imm8(payload(a), 0);
+                }
+                as_.jcc(code.type() == Bytecode::Type::kJumpZero ? kEqual : kNotEqual, target(b));
+                break;
+            case Bytecode::Type::kJumpZeroEqualInteger:
+            case Bytecode::Type::kJumpZeroNotEqualInteger:
+            case Bytecode::Type::kJumpZeroGreaterThanInteger:
+            case Bytecode::Type::kJumpZeroLessThanInteger:
+            case Bytecode::Type::kJumpZeroGreaterEqualInteger:
+            case Bytecode::Type::kJumpZeroLessEqualInteger:
+                // 条件不成立时跳转
+                integer_op(IntegerOp::kCompare, integer_register(a, kRax), b);
+                as_.jcc(negate(condition(code.type())), target(c));
+                break;
+            case Bytecode::Type::kJumpZeroEqualReal:
+            case Bytecode::Type::kJumpZeroNotEqualReal:
+            case Bytecode::Type::kJumpZeroGreaterThanReal:
+            case Bytecode::Type::kJumpZeroLessThanReal:
+            case Bytecode::Type::kJumpZeroGreaterEqualReal:
+            case Bytecode::Type::kJumpZeroLessEqualReal:
+                // compare_real 只写入 al, 高位仍是之前的内容, 先零扩展再判断
+                compare_real(condition(code.type()), a, b);
+                as_.movzx8(kRax, kRax);
+                as_.test32(kRax, kRax);
+                as_.jcc(kEqual, target(c));
+                break;
+            case Bytecode::Type::kCall:
+                // 实参与返回值经由内存传递; 调用后寄存器区可能已扩容, 以辅助函数返回的位置为准
+                spill_all();
+                call_helper((const void *)helpers_.call, pc);
+                as_.test64(kRax, kRax);
+                as_.jcc(kEqual, error_exit_);
+                as_.mov64(kBase, kRax);
+                load_arrays();
+                reload_all();
+                break;
+            case Bytecode::Type::kReturn:
+                spill(a);
+                copy_value(Memory(kResult, 0), value(a));
+                as_.mov_imm32(kRax, 0);
+                as_.jmp(epilogue_);
+                break;
+            default:
+                break;
+        }
+    }
+
+    static Condition condition(const Bytecode::Type &type) {
+        switch (type) {
+            case Bytecode::Type::kCompareEqualInteger:
+            case Bytecode::Type::kCompareEqualReal:
+            case Bytecode::Type::kJumpZeroEqualInteger:
+            case Bytecode::Type::kJumpZeroEqualReal:
+                return kEqual;
+            case Bytecode::Type::kCompareNotEqualInteger:
+            case Bytecode::Type::kCompareNotEqualReal:
+            case Bytecode::Type::kJumpZeroNotEqualInteger:
+            case Bytecode::Type::kJumpZeroNotEqualReal:
+                return kNotEqual;
+            case Bytecode::Type::kCompareGreaterThanInteger:
+            case Bytecode::Type::kCompareGreaterThanReal:
+            case Bytecode::Type::kJumpZeroGreaterThanInteger:
+            case Bytecode::Type::kJumpZeroGreaterThanReal:
+                return kGreater;
+            case Bytecode::Type::kCompareLessThanInteger:
+            case Bytecode::Type::kCompareLessThanReal:
+            case Bytecode::Type::kJumpZeroLessThanInteger:
+            case Bytecode::Type::kJumpZeroLessThanReal:
+                return kLess;
+            case Bytecode::Type::kCompareGreaterEqualInteger:
+            case Bytecode::Type::kCompareGreaterEqualReal:
+            case Bytecode::Type::kJumpZeroGreaterEqualInteger:
+            case Bytecode::Type::kJumpZeroGreaterEqualReal:
+                return kGreaterEqual;
+            default:
+                return kLessEqual;
+        }
+    }
+};
+#endif
+
+Jit::~Jit() {
+    release();
+}
+
+void Jit::release() {
+#ifdef CMM_HAS_JIT
+    if (memory_ != nullptr) {
+        munmap(memory_, memory_size_);
+    }
+#endif
+    memory_ = nullptr;
+    memory_size_ = 0;
+    functions_.clear();
+}
+
+bool Jit::is_supported() {
+#ifdef CMM_HAS_JIT
+    // 本地代码假定 Value 的类型标记位于偏移 0, 值位于偏移 8, 数组表的每一项同样占 16 字节
+    Value value(0x12345678);
+    int tag = 0;
+    int payload = 0;
+    std::memcpy(&tag, (const char *)&value + kTagOffset, sizeof(tag));
+    std::memcpy(&payload, (const char *)&value + kPayloadOffset, sizeof(payload));
+    return sizeof(Value) == 16 && tag == (int)Value::Type::kInt && payload == 0x12345678 && sizeof(ArrayView) == 16 &&
+           offsetof(ArrayView, elements) == kElementsOffset && offsetof(ArrayView, size) == kSizeOffset;
+#else
+    return false;
+#endif
+}
+
+bool Jit::is_compilable(const BytecodeProgram &program, const int &begin, const int &end) {
+    for (int pc = begin; pc < end; ++pc) {
+        switch (program.at(pc).type()) {
+            // 停机指令由解释器执行
+            case Bytecode::Type::kHalt:
+                return false;
+            // 跳转目标必须位于函数内部
+            case Bytecode::Type::kJump:
+                if (program.at(pc).a() < begin || program.at(pc).a() >= end) {
+                    return false;
+                }
+                break;
+            case Bytecode::Type::kJumpZero:
+            case Bytecode::Type::kJumpNotZero:
+                if (program.at(pc).b() < begin || program.at(pc).b() >= end) {
+                    return false;
+                }
+                break;
+            case Bytecode::Type::kJumpZeroEqualInteger:
+            case Bytecode::Type::kJumpZeroEqualReal:
+            case Bytecode::Type::kJumpZeroNotEqualInteger:
+            case Bytecode::Type::kJumpZeroNotEqualReal:
+            case Bytecode::Type::kJumpZeroGreaterThanInteger:
+            case Bytecode::Type::kJumpZeroGreaterThanReal:
+            case Bytecode::Type::kJumpZeroLessThanInteger:
+            case Bytecode::Type::kJumpZeroLessThanReal:
+            case Bytecode::Type::kJumpZeroGreaterEqualInteger:
+            case Bytecode::Type::kJumpZeroGreaterEqualReal:
+            case Bytecode::Type::kJumpZeroLessEqualInteger:
+            case Bytecode::Type::kJumpZeroLessEqualReal:
+                if (program.at(pc).c() < begin || program.at(pc).c() >= end) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // 本地代码不能越过函数末尾继续执行
+    if (begin >= end) {
+        return false;
+    }
+    Bytecode::Type last = program.at(end - 1).type();
+    return last == Bytecode::Type::kReturn || last == Bytecode::Type::kJump;
+}
+
+void Jit::compile(const BytecodeProgram &program, const Helpers &helpers) {
+    release();
+    functions_.assign(program.functions().size(), nullptr);
+    if (!is_supported()) {
+        return;
+    }
+
+#ifdef CMM_HAS_JIT
+    // 函数按入口位置排列, 函数体延伸至下一个函数的入口
+    Assembler as;
+    FunctionCompiler compiler(as, program, helpers);
+    std::vector<int> offsets(program.functions().size(), -1);
+    for (int i = 0; i < (int)program.functions().size(); ++i) {
+        if (i == program.entry_function()) {
+            continue;
+        }
+        int begin = program.functions()[i].entry();
+        int end = program.size();
+        for (const BytecodeFunction &function : program.functions()) {
+            if (function.entry() > begin && function.entry() < end) {
+                end = function.entry();
+            }
+        }
+        if (!is_compilable(program, begin, end)) {
+            continue;
+        }
+        offsets[i] = (int)as.code().size();
+        compiler.compile(begin, end);
+    }
+    if (as.code().empty()) {
+        return;
+    }
+
+    // 先写入代码, 再将内存改为只读可执行
+    unsigned long page = (unsigned long)sysconf(_SC_PAGESIZE);
+    unsigned long size = (as.code().size() + page - 1) / page * page;
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return;
+    }
+    std::memcpy(memory, as.code().data(), as.code().size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return;
+    }
+    memory_ = memory;
+    memory_size_ = size;
+
+    for (int i = 0; i < (int)offsets.size(); ++i) {
+        if (offsets[i] >= 0) {
+            functions_[i] = (NativeFunction)((uint8_t *)memory + offsets[i]);
+        }
+    }
+#endif
+}
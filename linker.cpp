@@ -0,0 +1,252 @@
+#include "include/linker.h"
+
+Linker::Linker(const IR &ir) : ir_(ir), global_size_(0), local_size_(0), max_local_size_(0) { }
+
+void Linker::link() {
+    scopes_.clear();
+    scope_marks_.clear();
+    constants_.clear();
+    constant_table_.clear();
+    functions_.clear();
+    function_table_.clear();
+    label_table_.clear();
+    global_size_ = 0;
+
+    collect_targets();
+    link_operands();
+
+    lines_.clear();
+    for (int pos = 0; pos <= ir_.size(); ++pos) {
+        lines_.push_back(pos);
+    }
+}
+
+void Linker::strip() {
+    // 被删除的指令对应其后第一条保留的指令, 因此落在块标记上的跳转目标同样有效
+    std::vector<int> position((unsigned long)ir_.size() + 1);
+    IR result;
+    std::vector<int> lines;
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        position[pos] = result.size();
+        PCode::Type type = ir_.at(pos).type();
+        if (type != PCode::Type::kLabel && type != PCode::Type::kEnterScope && type != PCode::Type::kLeaveScope) {
+            result.add(ir_.at(pos));
+            lines.push_back(lines_[pos]);
+        }
+    }
+    position[ir_.size()] = result.size();
+    lines.push_back(lines_[ir_.size()]);
+
+    for (int pos = 0; pos < result.size(); ++pos) {
+        PCode &code = result.at(pos);
+        switch (code.type()) {
+            case PCode::Type::kStartFunc:
+            case PCode::Type::kJump:
+            case PCode::Type::kJumpZero:
+            case PCode::Type::kJumpNotZero:
+                code.set_target(position[code.target()]);
+                break;
+            default:
+                break;
+        }
+    }
+    for (LinkedFunction &function : functions_) {
+        function.set_start(position[function.start()]);
+        function.set_end(position[function.end()]);
+    }
+    ir_ = result;
+    lines_ = lines;
+}
+
+const IR &Linker::ir() const {
+    return ir_;
+}
+
+int Linker::global_size() const {
+    return global_size_;
+}
+
+const std::vector<Symbol> &Linker::constants() const {
+    return constants_;
+}
+
+const std::vector<LinkedFunction> &Linker::functions() const {
+    return functions_;
+}
+
+const std::vector<int> &Linker::lines() const {
+    return lines_;
+}
+
+// 记录所有 Label 和函数的位置
+void Linker::collect_targets() {
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        const PCode &code = ir_.at(pos);
+
+        if (code.type() == PCode::Type::kLabel) {
+            label_table_[code.first()] = pos;
+        } else if (code.type() == PCode::Type::kStartFunc) {
+            function_table_[code.first()] = (int)functions_.size();
+            functions_.push_back(LinkedFunction(code.first(), pos));
+        } else if (code.type() == PCode::Type::kEndFunc) {
+            functions_[function_target(pos, code.first())].set_end(pos);
+        }
+    }
+}
+
+// 解析变量地址与字面量
+void Linker::link_operands() {
+    scopes_.push_back(std::map<std::string, Address>());
+
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        PCode &code = ir_.at(pos);
+
+        switch (code.type()) {
+            case PCode::Type::kStartFunc:
+                local_size_ = 0;
+                max_local_size_ = 0;
+                push_scope();
+                code.set_target(functions_[function_target(pos, code.first())].end());
+                break;
+            case PCode::Type::kEndFunc:
+                pop_scope();
+                functions_[function_target(pos, code.first())].set_frame_size(max_local_size_);
+                break;
+            case PCode::Type::kCall:
+            case PCode::Type::kTailCall:
+                code.set_target(function_target(pos, code.first()));
+                break;
+            case PCode::Type::kJump:
+            case PCode::Type::kJumpZero:
+            case PCode::Type::kJumpNotZero:
+                code.set_target(label_target(pos, code.first()));
+                break;
+            case PCode::Type::kEnterScope:
+                push_scope();
+                code.set_target(std::stoi(code.first()));
+                break;
+            case PCode::Type::kLeaveScope:
+                pop_scope();
+                code.set_target(std::stoi(code.first()));
+                break;
+            case PCode::Type::kArgInteger:
+            case PCode::Type::kArgIntegerArray:
+            case PCode::Type::kArgReal:
+            case PCode::Type::kArgRealArray:
+            case PCode::Type::kVarInteger:
+            case PCode::Type::kVarReal:
+                code.set_first_address(define(code.first()));
+                break;
+            case PCode::Type::kVarIntegerArray:
+            case PCode::Type::kVarRealArray:
+                code.set_first_address(define(code.first()));
+                code.set_second_address(resolve_integer(pos, code.second()));
+                break;
+            case PCode::Type::kPushInteger:
+                code.set_first_address(resolve_integer(pos, code.first()));
+                break;
+            case PCode::Type::kPushReal:
+                code.set_first_address(resolve_real(pos, code.first()));
+                break;
+            case PCode::Type::kPopInteger:
+            case PCode::Type::kPopReal:
+            case PCode::Type::kReadInt:
+            case PCode::Type::kReadReal:
+                code.set_first_address(resolve(pos, code.first()));
+                break;
+            case PCode::Type::kPushIntegerArray:
+            case PCode::Type::kPushRealArray:
+            case PCode::Type::kPopIntegerArray:
+            case PCode::Type::kPopRealArray:
+            case PCode::Type::kReadIntArray:
+            case PCode::Type::kReadRealArray:
+                code.set_first_address(resolve(pos, code.first()));
+                code.set_second_address(resolve_integer(pos, code.second()));
+                break;
+            default:
+                break;
+        }
+    }
+
+    scopes_.pop_back();
+}
+
+void Linker::push_scope() {
+    scopes_.push_back(std::map<std::string, Address>());
+    scope_marks_.push_back(local_size_);
+}
+
+void Linker::pop_scope() {
+    scopes_.pop_back();
+    local_size_ = scope_marks_.back();  // 块结束后其槽位可被后续的块复用
+    scope_marks_.pop_back();
+}
+
+Address Linker::define(const std::string &name) {
+    Address address;
+    if (scopes_.size() == 1) {
+        address = Address(Address::Frame::kGlobal, global_size_++);
+    } else {
+        address = Address(Address::Frame::kLocal, local_size_++);
+        if (local_size_ > max_local_size_) {
+            max_local_size_ = local_size_;
+        }
+    }
+    scopes_.back()[name] = address;
+    return address;
+}
+
+Address Linker::resolve(const int &pos, const std::string &name) {
+    for (int i = (int)scopes_.size() - 1; i >= 0; --i) {
+        std::map<std::string, Address>::const_iterator it = scopes_[i].find(name);
+        if (it != scopes_[i].end()) {
+            return it->second;
+        }
+    }
+    throw simulator_error(pos, "变量 \"" + name + "\" 未定义, 无法完成链接");
+}
+
+Address Linker::resolve_integer(const int &pos, const std::string &name) {
+    if (Recognition::is_integer(name)) {
+        return constant("i" + name, Symbol(name, std::stoi(name), true));
+    }
+    return resolve(pos, name);
+}
+
+Address Linker::resolve_real(const int &pos, const std::string &name) {
+    if (Recognition::is_real(name)) {
+        return constant("r" + name, Symbol(name, std::stod(name), true));
+    }
+    return resolve(pos, name);
+}
+
+Address Linker::constant(const std::string &key, const Symbol &value) {
+    std::map<std::string, int>::const_iterator it = constant_table_.find(key);
+    if (it != constant_table_.end()) {
+        return Address(Address::Frame::kConstant, it->second);
+    }
+    constant_table_[key] = (int)constants_.size();
+    constants_.push_back(value);
+    return Address(Address::Frame::kConstant, (int)constants_.size() - 1);
+}
+
+int Linker::label_target(const int &pos, const std::string &name) {
+    std::map<std::string, int>::const_iterator it = label_table_.find(name);
+    if (it == label_table_.end()) {
+        throw simulator_error(pos, "跳转目标 \"" + name + "\" 不存在, 无法完成链接");
+    }
+    // Label 不执行任何操作, 跳转直接落在其后的第一条指令上
+    int target = it->second;
+    while (target < ir_.size() && ir_.at(target).type() == PCode::Type::kLabel) {
+        ++target;
+    }
+    return target;
+}
+
+int Linker::function_target(const int &pos, const std::string &name) {
+    std::map<std::string, int>::const_iterator it = function_table_.find(name);
+    if (it == function_table_.end()) {
+        throw simulator_error(pos, "函数 \"" + name + "\" 未定义, 无法完成链接");
+    }
+    return it->second;
+}
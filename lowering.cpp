@@ -0,0 +1,658 @@
+#include <deque>
+#include <cstring>
+#include "include/lowering.h"
+
+Lowering::Lowering(const Linker &linker) : ir_(linker.ir()), functions_(linker.functions()), in_function_(false), begin_(0), frame_size_(0), max_depth_(0) {
+    std::vector<Value> constants;
+    for (const Symbol &symbol : linker.constants()) {
+        if (symbol.type() == Symbol::Type::kReal) {
+            constants.push_back(Value(symbol.real_value()));
+        } else {
+            constants.push_back(Value(symbol.int_value()));
+        }
+    }
+    program_.set_global_size(linker.global_size());
+    program_.set_constants(constants);
+}
+
+void Lowering::lower() {
+    pc_of_.assign((unsigned long)ir_.size(), 0);
+    prepare();
+
+    lower_entry();
+    for (int i = 0; i < (int)functions_.size(); ++i) {
+        lower_function(i);
+    }
+}
+
+const BytecodeProgram &Lowering::program() const {
+    return program_;
+}
+
+// 收集全局变量类型, 函数形参, 以及首次调用函数前已赋值的全局变量
+void Lowering::prepare() {
+    global_types_.assign((unsigned long)program_.global_size(), Value::Type::kNone);
+    global_assigned_.assign((unsigned long)program_.global_size(), 0);
+    top_assigned_.assign((unsigned long)program_.global_size(), 0);
+
+    bool is_called = false;
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        const PCode &code = ir_.at(pos);
+        if (code.type() == PCode::Type::kStartFunc) {
+            pos = code.target();
+            continue;
+        }
+        switch (code.type()) {
+            case PCode::Type::kVarInteger:
+                global_types_[code.first_address().slot()] = Value::Type::kInt;
+                break;
+            case PCode::Type::kVarReal:
+                global_types_[code.first_address().slot()] = Value::Type::kReal;
+                break;
+            case PCode::Type::kVarIntegerArray:
+                global_types_[code.first_address().slot()] = Value::Type::kIntArray;
+                break;
+            case PCode::Type::kVarRealArray:
+                global_types_[code.first_address().slot()] = Value::Type::kRealArray;
+                break;
+            case PCode::Type::kPopInteger:
+            case PCode::Type::kPopReal:
+                if (!is_called) {
+                    global_assigned_[code.first_address().slot()] = 1;
+                }
+                break;
+            case PCode::Type::kCall:
+            case PCode::Type::kTailCall:
+                is_called = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // 入口函数编号为 0, 其余函数依次排列
+    program_.add_function(BytecodeFunction("__entry__", 0));
+    for (const LinkedFunction &function : functions_) {
+        BytecodeFunction result(function.name(), function.frame_size());
+
+        // 形参按出栈顺序声明, 按实参入栈顺序记录
+        std::vector<std::pair<int, Value::Type> > parameters;
+        for (int pos = function.start() + 1; pos < function.end(); ++pos) {
+            const PCode &code = ir_.at(pos);
+            if (code.type() == PCode::Type::kArgReal || code.type() == PCode::Type::kArgRealArray) {
+                parameters.push_back(std::make_pair(code.first_address().slot(), Value::Type::kReal));
+            } else if (code.type() == PCode::Type::kArgInteger || code.type() == PCode::Type::kArgIntegerArray) {
+                parameters.push_back(std::make_pair(code.first_address().slot(), Value::Type::kInt));
+            } else {
+                break;
+            }
+        }
+        for (int i = (int)parameters.size() - 1; i >= 0; --i) {
+            result.add_parameter(parameters[i].first, parameters[i].second);
+        }
+        if (ir_.at(function.end()).second() == "real") {
+            result.set_return_type(Value::Type::kReal);
+        }
+        program_.add_function(result);
+    }
+}
+
+// 翻译全局语句, 作为程序入口函数
+void Lowering::lower_entry() {
+    in_function_ = false;
+    begin_function(0);
+    program_.function(0).set_entry(program_.size());
+
+    for (int pos = 0; pos < ir_.size(); ++pos) {
+        if (ir_.at(pos).type() == PCode::Type::kStartFunc) {
+            pos = ir_.at(pos).target();
+            continue;
+        }
+        lower_instruction(pos);
+    }
+    emit(Bytecode(Bytecode::Type::kHalt), ir_.size() - 1);
+
+    end_function(0);
+}
+
+// 翻译函数体
+void Lowering::lower_function(const int &index) {
+    const LinkedFunction &function = functions_[index];
+
+    in_function_ = true;
+    begin_function(function.frame_size());
+    slot_types_.assign((unsigned long)function.frame_size(), Value::Type::kNone);
+    analyse_assignment(function.start(), function.end());
+    program_.function(index + 1).set_entry(program_.size());
+
+    for (int pos = function.start(); pos <= function.end(); ++pos) {
+        lower_instruction(pos);
+    }
+
+    end_function(index + 1);
+}
+
+void Lowering::begin_function(const int &frame_size) {
+    stack_.clear();
+    jumps_.clear();
+    frame_size_ = frame_size;
+    max_depth_ = 0;
+}
+
+void Lowering::end_function(const int &function) {
+    // 回填跳转目标
+    for (int pc : jumps_) {
+        Bytecode &code = program_.at(pc);
+        switch (code.type()) {
+            case Bytecode::Type::kJump:
+                code.set_a(pc_of_[code.a()]);
+                break;
+            case Bytecode::Type::kJumpZero:
+            case Bytecode::Type::kJumpNotZero:
+                code.set_b(pc_of_[code.b()]);
+                break;
+            default:
+                code.set_c(pc_of_[code.c()]);
+                break;
+        }
+    }
+    program_.function(function).set_registers(frame_size_ + max_depth_);
+}
+
+// 分析函数中每个位置一定已赋值的局部变量, 据此省略未初始化检查
+// 对函数的控制流图做前向的必然赋值数据流分析, 交汇运算为交集
+void Lowering::analyse_assignment(const int &begin, const int &end) {
+    int size = end - begin + 1;
+    begin_ = begin;
+    assigned_.assign((unsigned long)size, std::vector<char>((unsigned long)frame_size_, 1));
+    std::vector<char> is_reached((unsigned long)size, 0);
+    std::deque<int> worklist;
+
+    assigned_[0].assign((unsigned long)frame_size_, 0);
+    is_reached[0] = 1;
+    worklist.push_back(0);
+
+    while (!worklist.empty()) {
+        int index = worklist.front();
+        worklist.pop_front();
+
+        const PCode &code = ir_.at(begin + index);
+        std::vector<char> out = assigned_[index];
+        if (code.first_address().frame() == Address::Frame::kLocal) {
+            switch (code.type()) {
+                case PCode::Type::kVarInteger:
+                    out[code.first_address().slot()] = 0;
+                    break;
+                case PCode::Type::kArgInteger:
+                case PCode::Type::kArgReal:
+                case PCode::Type::kPopInteger:
+                case PCode::Type::kPopReal:
+                case PCode::Type::kReadInt:
+                case PCode::Type::kReadReal:
+                    out[code.first_address().slot()] = 1;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        std::vector<int> successors;
+        switch (code.type()) {
+            case PCode::Type::kJump:
+                successors.push_back(code.target() - begin);
+                break;
+            case PCode::Type::kJumpZero:
+            case PCode::Type::kJumpNotZero:
+                successors.push_back(code.target() - begin);
+                successors.push_back(index + 1);
+                break;
+            case PCode::Type::kReturn:
+            case PCode::Type::kEndFunc:
+                break;
+            default:
+                successors.push_back(index + 1);
+                break;
+        }
+
+        for (int successor : successors) {
+            if (successor < 0 || successor >= size) {
+                continue;
+            }
+            if (!is_reached[successor]) {
+                is_reached[successor] = 1;
+                assigned_[successor] = out;
+                worklist.push_back(successor);
+                continue;
+            }
+            bool is_changed = false;
+            for (int slot = 0; slot < frame_size_; ++slot) {
+                if (assigned_[successor][slot] && !out[slot]) {
+                    assigned_[successor][slot] = 0;
+                    is_changed = true;
+                }
+            }
+            if (is_changed) {
+                worklist.push_back(successor);
+            }
+        }
+    }
+}
+
+// 翻译一条中间代码
+void Lowering::lower_instruction(const int &pos) {
+    const PCode &code = ir_.at(pos);
+    pc_of_[pos] = program_.size();
+
+    switch (code.type()) {
+        case PCode::Type::kStartFunc:
+        case PCode::Type::kLabel:
+        case PCode::Type::kEnterScope:
+        case PCode::Type::kLeaveScope:
+        case PCode::Type::kExit:
+            break;
+        case PCode::Type::kArgInteger:
+        case PCode::Type::kArgIntegerArray:
+            // 形参由 call 指令赋值
+            declare(code.first_address(), Value::Type::kInt);
+            break;
+        case PCode::Type::kArgReal:
+        case PCode::Type::kArgRealArray:
+            declare(code.first_address(), Value::Type::kReal);
+            break;
+        case PCode::Type::kVarInteger:
+            declare(code.first_address(), Value::Type::kInt);
+            set_assigned(code.first_address(), false);
+            emit(Bytecode(Bytecode::Type::kVarInteger, operand(code.first_address())), pos);
+            break;
+        case PCode::Type::kVarReal:
+            declare(code.first_address(), Value::Type::kReal);
+            emit(Bytecode(Bytecode::Type::kVarReal, operand(code.first_address())), pos);
+            break;
+        case PCode::Type::kVarIntegerArray:
+            declare(code.first_address(), Value::Type::kIntArray);
+            emit(Bytecode(Bytecode::Type::kVarIntegerArray, operand(code.first_address()), operand(code.second_address())), pos);
+            break;
+        case PCode::Type::kVarRealArray:
+            declare(code.first_address(), Value::Type::kRealArray);
+            emit(Bytecode(Bytecode::Type::kVarRealArray, operand(code.first_address()), operand(code.second_address())), pos);
+            break;
+        case PCode::Type::kPushInteger:
+            if (code.first_address().frame() == Address::Frame::kConstant) {
+                push(StackEntry::Kind::kConstant, operand(code.first_address()), Value::Type::kInt, -1);
+            } else {
+                if (!is_assigned(pos, code.first_address())) {
+                    emit(Bytecode(Bytecode::Type::kCheck, operand(code.first_address()), program_.add_name(code.first())), pos);
+                }
+                push(StackEntry::Kind::kVariable, operand(code.first_address()), Value::Type::kInt, -1);
+            }
+            break;
+        case PCode::Type::kPushReal:
+            push(code.first_address().frame() == Address::Frame::kConstant ? StackEntry::Kind::kConstant : StackEntry::Kind::kVariable,
+                 operand(code.first_address()), Value::Type::kReal, -1);
+            break;
+        case PCode::Type::kPushIntegerArray: {
+            int dst = temp((int)stack_.size());
+            int pc = emit(Bytecode(Bytecode::Type::kLoadIntegerArray, dst, operand(code.first_address()), operand(code.second_address())), pos);
+            push(StackEntry::Kind::kTemp, dst, Value::Type::kInt, pc);
+            break;
+        }
+        case PCode::Type::kPushRealArray: {
+            int dst = temp((int)stack_.size());
+            int pc = emit(Bytecode(Bytecode::Type::kLoadRealArray, dst, operand(code.first_address()), operand(code.second_address())), pos);
+            push(StackEntry::Kind::kTemp, dst, Value::Type::kReal, pc);
+            break;
+        }
+        case PCode::Type::kPop:
+            pop(pos);
+            break;
+        case PCode::Type::kPopInteger:
+        case PCode::Type::kPopReal:
+            lower_store(pos, code.first_address());
+            set_assigned(code.first_address(), true);
+            break;
+        case PCode::Type::kPopIntegerArray: {
+            StackEntry value = pop(pos);
+            emit(Bytecode(Bytecode::Type::kStoreIntegerArray, operand(code.first_address()), operand(code.second_address()), value.operand), pos);
+            break;
+        }
+        case PCode::Type::kPopRealArray: {
+            StackEntry value = pop(pos);
+            emit(Bytecode(Bytecode::Type::kStoreRealArray, operand(code.first_address()), operand(code.second_address()), value.operand), pos);
+            break;
+        }
+        case PCode::Type::kAddInteger:
+            lower_binary(pos, Bytecode::Type::kAddInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kAddReal:
+            lower_binary(pos, Bytecode::Type::kAddReal, Value::Type::kReal);
+            break;
+        case PCode::Type::kSubInteger:
+            lower_binary(pos, Bytecode::Type::kSubInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kSubReal:
+            lower_binary(pos, Bytecode::Type::kSubReal, Value::Type::kReal);
+            break;
+        case PCode::Type::kMulInteger:
+            lower_binary(pos, Bytecode::Type::kMulInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kMulReal:
+            lower_binary(pos, Bytecode::Type::kMulReal, Value::Type::kReal);
+            break;
+        case PCode::Type::kDivInteger:
+            lower_binary(pos, Bytecode::Type::kDivInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kDivReal:
+            lower_binary(pos, Bytecode::Type::kDivReal, Value::Type::kReal);
+            break;
+        case PCode::Type::kCompareEqualInteger:
+            lower_binary(pos, Bytecode::Type::kCompareEqualInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareEqualReal:
+            lower_binary(pos, Bytecode::Type::kCompareEqualReal, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareNotEqualInteger:
+            lower_binary(pos, Bytecode::Type::kCompareNotEqualInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareNotEqualReal:
+            lower_binary(pos, Bytecode::Type::kCompareNotEqualReal, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareGreaterThanInteger:
+            lower_binary(pos, Bytecode::Type::kCompareGreaterThanInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareGreaterThanReal:
+            lower_binary(pos, Bytecode::Type::kCompareGreaterThanReal, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareLessThanInteger:
+            lower_binary(pos, Bytecode::Type::kCompareLessThanInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareLessThanReal:
+            lower_binary(pos, Bytecode::Type::kCompareLessThanReal, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareGreaterEqualInteger:
+            lower_binary(pos, Bytecode::Type::kCompareGreaterEqualInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareGreaterEqualReal:
+            lower_binary(pos, Bytecode::Type::kCompareGreaterEqualReal, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareLessEqualInteger:
+            lower_binary(pos, Bytecode::Type::kCompareLessEqualInteger, Value::Type::kInt);
+            break;
+        case PCode::Type::kCompareLessEqualReal:
+            lower_binary(pos, Bytecode::Type::kCompareLessEqualReal, Value::Type::kInt);
+            break;
+        case PCode::Type::kIntegerToReal:
+            lower_integer_to_real(pos);
+            break;
+        case PCode::Type::kJump:
+            jumps_.push_back(emit(Bytecode(Bytecode::Type::kJump, code.target()), pos));
+            break;
+        case PCode::Type::kJumpZero:
+            lower_jump_zero(pos, code);
+            break;
+        case PCode::Type::kJumpNotZero: {
+            StackEntry condition = pop(pos);
+            jumps_.push_back(emit(Bytecode(Bytecode::Type::kJumpNotZero, condition.operand, code.target()), pos));
+            break;
+        }
+        case PCode::Type::kPrint: {
+            StackEntry value = pop(pos);
+            emit(Bytecode(Bytecode::Type::kPrint, value.operand), pos);
+            break;
+        }
+        case PCode::Type::kReadInt:
+            emit(Bytecode(Bytecode::Type::kReadInt, operand(code.first_address())), pos);
+            set_assigned(code.first_address(), true);
+            break;
+        case PCode::Type::kReadReal:
+            emit(Bytecode(Bytecode::Type::kReadReal, operand(code.first_address())), pos);
+            set_assigned(code.first_address(), true);
+            break;
+        case PCode::Type::kReadIntArray:
+            emit(Bytecode(Bytecode::Type::kReadIntArray, operand(code.first_address()), operand(code.second_address())), pos);
+            break;
+        case PCode::Type::kReadRealArray:
+            emit(Bytecode(Bytecode::Type::kReadRealArray, operand(code.first_address()), operand(code.second_address())), pos);
+            break;
+        // 寄存器虚拟机不复用帧, 尾调用按普通调用执行, 由其后的 ret 返回
+        case PCode::Type::kCall:
+        case PCode::Type::kTailCall:
+            lower_call(pos, code);
+            break;
+        case PCode::Type::kReturn: {
+            StackEntry value = pop(pos);
+            emit(Bytecode(Bytecode::Type::kReturn, value.operand), pos);
+            break;
+        }
+        case PCode::Type::kEndFunc:
+            // 函数末尾没有 return 时按返回类型返回 0
+            if (code.second() == "real") {
+                emit(Bytecode(Bytecode::Type::kReturn, constant(Value(0.0))), pos);
+            } else {
+                emit(Bytecode(Bytecode::Type::kReturn, constant(Value(0))), pos);
+            }
+            break;
+        default:
+            throw simulator_error(pos, "不支持的指令");
+    }
+}
+
+void Lowering::lower_binary(const int &pos, const Bytecode::Type &type, const Value::Type &result) {
+    StackEntry right = pop(pos);
+    StackEntry left = pop(pos);
+    int dst = temp((int)stack_.size());
+    int pc = emit(Bytecode(type, dst, left.operand, right.operand), pos);
+    push(StackEntry::Kind::kTemp, dst, result, pc);
+}
+
+// 整数常量直接转换为实数常量
+void Lowering::lower_integer_to_real(const int &pos) {
+    StackEntry value = pop(pos);
+    if (value.kind == StackEntry::Kind::kConstant) {
+        const Value &integer = program_.constants()[~value.operand - program_.global_size()];
+        push(StackEntry::Kind::kConstant, constant(Value((double)integer.int_value())), Value::Type::kReal, -1);
+        return;
+    }
+
+    int dst = temp((int)stack_.size());
+    int pc = emit(Bytecode(Bytecode::Type::kIntegerToReal, dst, value.operand), pos);
+    push(StackEntry::Kind::kTemp, dst, Value::Type::kReal, pc);
+}
+
+// 赋值时按变量声明的类型转换
+void Lowering::lower_store(const int &pos, const Address &address) {
+    StackEntry value = pop(pos);
+    Value::Type type = declared_type(address);
+    int dst = operand(address);
+
+    if (value.type == type && value.kind == StackEntry::Kind::kTemp && value.pc == program_.size() - 1) {
+        program_.at(value.pc).set_a(dst);
+    } else if (value.type == type) {
+        emit(Bytecode(Bytecode::Type::kMove, dst, value.operand), pos);
+    } else if (type == Value::Type::kInt) {
+        emit(Bytecode(Bytecode::Type::kMoveInteger, dst, value.operand), pos);
+    } else if (type == Value::Type::kReal) {
+        emit(Bytecode(Bytecode::Type::kMoveReal, dst, value.operand), pos);
+    } else {
+        throw simulator_error(pos, "错误的目标类型");
+    }
+}
+
+// 条件恰为上一条比较指令的结果时, 合并为一条比较跳转指令
+void Lowering::lower_jump_zero(const int &pos, const PCode &code) {
+    StackEntry condition = pop(pos);
+
+    if (condition.kind == StackEntry::Kind::kTemp && condition.pc == program_.size() - 1) {
+        Bytecode &last = program_.at(condition.pc);
+        Bytecode::Type type = Bytecode::Type::kJumpZero;
+        switch (last.type()) {
+            case Bytecode::Type::kCompareEqualInteger:
+                type = Bytecode::Type::kJumpZeroEqualInteger;
+                break;
+            case Bytecode::Type::kCompareEqualReal:
+                type = Bytecode::Type::kJumpZeroEqualReal;
+                break;
+            case Bytecode::Type::kCompareNotEqualInteger:
+                type = Bytecode::Type::kJumpZeroNotEqualInteger;
+                break;
+            case Bytecode::Type::kCompareNotEqualReal:
+                type = Bytecode::Type::kJumpZeroNotEqualReal;
+                break;
+            case Bytecode::Type::kCompareGreaterThanInteger:
+                type = Bytecode::Type::kJumpZeroGreaterThanInteger;
+                break;
+            case Bytecode::Type::kCompareGreaterThanReal:
+                type = Bytecode::Type::kJumpZeroGreaterThanReal;
+                break;
+            case Bytecode::Type::kCompareLessThanInteger:
+                type = Bytecode::Type::kJumpZeroLessThanInteger;
+                break;
+            case Bytecode::Type::kCompareLessThanReal:
+                type = Bytecode::Type::kJumpZeroLessThanReal;
+                break;
+            case Bytecode::Type::kCompareGreaterEqualInteger:
+                type = Bytecode::Type::kJumpZeroGreaterEqualInteger;
+                break;
+            case Bytecode::Type::kCompareGreaterEqualReal:
+                type = Bytecode::Type::kJumpZeroGreaterEqualReal;
+                break;
+            case Bytecode::Type::kCompareLessEqualInteger:
+                type = Bytecode::Type::kJumpZeroLessEqualInteger;
+                break;
+            case Bytecode::Type::kCompareLessEqualReal:
+                type = Bytecode::Type::kJumpZeroLessEqualReal;
+                break;
+            default:
+                break;
+        }
+        if (type != Bytecode::Type::kJumpZero) {
+            last = Bytecode(type, last.b(), last.c(), code.target());
+            jumps_.push_back(condition.pc);
+            return;
+        }
+    }
+
+    jumps_.push_back(emit(Bytecode(Bytecode::Type::kJumpZero, condition.operand, code.target()), pos));
+}
+
+// 实参在调用时才读取, 但被调用函数可能修改全局变量, 因此实参之下尚未读取的全局变量需要先复制到临时寄存器中
+void Lowering::lower_call(const int &pos, const PCode &code) {
+    int function = code.target() + 1;
+    int count = (int)program_.function(function).parameters().size();
+    int base = (int)stack_.size() - count;
+    if (base < 0) {
+        throw simulator_error(pos, "函数 \"" + code.first() + "\" 的实参数量不足");
+    }
+
+    for (int depth = 0; depth < base; ++depth) {
+        if (stack_[depth].kind == StackEntry::Kind::kVariable && !BytecodeProgram::is_local_operand(stack_[depth].operand)) {
+            materialize(depth, pos);
+        }
+    }
+
+    std::vector<int> arguments;
+    for (int depth = base; depth < (int)stack_.size(); ++depth) {
+        arguments.push_back(stack_[depth].operand);
+    }
+    stack_.resize((unsigned long)base);
+
+    int dst = temp(base);
+    int pc = emit(Bytecode(Bytecode::Type::kCall, dst, function, program_.add_arguments(arguments)), pos);
+    push(StackEntry::Kind::kTemp, dst, program_.function(function).return_type(), pc);
+}
+
+int Lowering::emit(const Bytecode &code, const int &pos) {
+    return program_.add(code, pos);
+}
+
+Lowering::StackEntry Lowering::pop(const int &pos) {
+    if (stack_.empty()) {
+        throw simulator_error(pos, "栈为空, 无法取出栈顶元素");
+    }
+    StackEntry entry = stack_.back();
+    stack_.pop_back();
+    return entry;
+}
+
+void Lowering::push(const StackEntry::Kind &kind, const int &operand, const Value::Type &type, const int &pc) {
+    StackEntry entry;
+    entry.kind = kind;
+    entry.operand = operand;
+    entry.type = type;
+    entry.pc = pc;
+    stack_.push_back(entry);
+    temp((int)stack_.size() - 1);
+}
+
+// 栈中第 depth 个元素对应的临时寄存器
+int Lowering::temp(const int &depth) {
+    if (depth + 1 > max_depth_) {
+        max_depth_ = depth + 1;
+    }
+    return BytecodeProgram::local_operand(frame_size_ + depth);
+}
+
+// 将栈中第 depth 个元素复制到临时寄存器中
+void Lowering::materialize(const int &depth, const int &pos) {
+    StackEntry &entry = stack_[depth];
+    int dst = temp(depth);
+    entry.pc = emit(Bytecode(Bytecode::Type::kMove, dst, entry.operand), pos);
+    entry.kind = StackEntry::Kind::kTemp;
+    entry.operand = dst;
+}
+
+int Lowering::operand(const Address &address) const {
+    switch (address.frame()) {
+        case Address::Frame::kLocal:
+            return BytecodeProgram::local_operand(address.slot());
+        case Address::Frame::kConstant:
+            return program_.constant_operand(address.slot());
+        default:
+            return BytecodeProgram::global_operand(address.slot());
+    }
+}
+
+Value::Type Lowering::declared_type(const Address &address) const {
+    if (address.frame() == Address::Frame::kLocal) {
+        return slot_types_[address.slot()];
+    }
+    return global_types_[address.slot()];
+}
+
+void Lowering::declare(const Address &address, const Value::Type &type) {
+    if (address.frame() == Address::Frame::kLocal) {
+        slot_types_[address.slot()] = type;
+    }
+}
+
+bool Lowering::is_assigned(const int &pos, const Address &address) const {
+    if (address.frame() == Address::Frame::kLocal) {
+        return assigned_[pos - begin_][address.slot()] != 0;
+    }
+    if (in_function_) {
+        return global_assigned_[address.slot()] != 0;
+    }
+    return top_assigned_[address.slot()] != 0;
+}
+
+void Lowering::set_assigned(const Address &address, const bool &assigned) {
+    if (!in_function_ && address.frame() == Address::Frame::kGlobal) {
+        top_assigned_[address.slot()] = (char)assigned;
+    }
+}
+
+int Lowering::constant(const Value &value) {
+    const std::vector<Value> &constants = program_.constants();
+    for (int i = 0; i < (int)constants.size(); ++i) {
+        if (constants[i].type() != value.type()) {
+            continue;
+        }
+        if ((value.type() == Value::Type::kReal && std::memcmp(&constants[i], &value, sizeof(Value)) == 0) ||
+            (value.type() != Value::Type::kReal && constants[i].int_value() == value.int_value())) {
+            return program_.constant_operand(i);
+        }
+    }
+    std::vector<Value> extended = constants;
+    extended.push_back(value);
+    program_.set_constants(extended);
+    return program_.constant_operand((int)extended.size() - 1);
+}
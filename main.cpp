@@ -1,55 +1,412 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
-#include "include/token.h"
-#include "include/lexer.h"
-#include "include/parser.h"
-#include "include/semantic.h"
+#include <sstream>
+#include <cstdlib>
+#include <csignal>
+#include <chrono>
+#include "include/cmm.h"
 #include "include/simulator.h"
+#include "include/register_simulator.h"
+#include "include/c_emitter.h"
+#include "include/inliner.h"
 
 using namespace std;
 
+// 有燃料上限时至多消耗 fuel 份燃料, 否则运行至结束或暂停
+static void advance(Simulator &simulator, const long long &fuel) {
+    if (fuel > 0) {
+        simulator.run_for(fuel);
+    } else {
+        simulator.resume();
+    }
+}
+
+// 解析内存大小, 可带 K, M, G 后缀 (按 1024 进位), 不合法时返回 0
+static unsigned long long parse_size(const std::string &text) {
+    char *end = nullptr;
+    unsigned long long size = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str() || text[0] == '-') {
+        return 0;
+    }
+    std::string suffix(end);
+    if (suffix == "K" || suffix == "k") {
+        size <<= 10;
+    } else if (suffix == "M" || suffix == "m") {
+        size <<= 20;
+    } else if (suffix == "G" || suffix == "g") {
+        size <<= 30;
+    } else if (!suffix.empty()) {
+        return 0;
+    }
+    return size;
+}
+
+// 输出运行时内存的峰值
+static void print_memory(const unsigned long long &peak, const unsigned long long &limit) {
+    cout << endl << "内存峰值: " << peak << " 字节 (配额 " << limit << " 字节)" << endl;
+}
+
+// 输出运行中止的原因与位置
+static void print_abort(const std::string &reason, const int &position) {
+    cout << endl << "[运行中止] " << reason << ", 停在指令 " << position << endl;
+}
+
+// 收到 SIGUSR1 时在下一次调用或向后跳转时输出执行轨迹
+static void request_trace_dump(int) {
+    TraceBuffer::request_dump();
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        std::cout << "Error: 需要传入源码所在路径作为第一个参数" << std::endl;
+    std::string path;
+    bool use_stack_engine = false;
+    bool use_jit = false;
+    std::string c_path;
+    bool use_fusion = true;
+    int statistics_length = 0;
+    bool use_profile = false;
+    std::string call_graph_path;
+    int trace_capacity = 0;
+    int inline_budget = 0;
+    std::string input_path;
+    std::string checkpoint_path;
+    std::string restore_path;
+    long long fuel = 0;
+    int time_limit = 0;
+    unsigned long long memory_limit = 0;
+    const Simulator::Dispatch default_dispatch = Simulator::has_threaded_dispatch() ? Simulator::Dispatch::kThreaded : Simulator::Dispatch::kSwitch;
+    Simulator::Dispatch dispatch = default_dispatch;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--engine=register") {
+            use_stack_engine = false;
+        } else if (arg == "--engine=stack") {
+            use_stack_engine = true;
+        } else if (arg == "--dispatch=switch") {
+            dispatch = Simulator::Dispatch::kSwitch;
+        } else if (arg == "--dispatch=threaded") {
+            if (!Simulator::has_threaded_dispatch()) {
+                std::cout << "Error: 当前编译器不支持线索化分派" << std::endl;
+                exit(1);
+            }
+            dispatch = Simulator::Dispatch::kThreaded;
+        } else if (arg == "--jit") {
+            if (!Jit::is_supported()) {
+                std::cout << "Error: 当前平台不支持即时编译" << std::endl;
+                exit(1);
+            }
+            use_jit = true;
+        } else if (arg == "--fusion=on") {
+            use_fusion = true;
+        } else if (arg == "--fusion=off") {
+            use_fusion = false;
+        } else if (arg == "--profile") {
+            use_profile = true;
+        } else if (arg == "--opcode-stats") {
+            statistics_length = 3;
+        } else if (arg.compare(0, 15, "--opcode-stats=") == 0) {
+            statistics_length = std::atoi(arg.substr(15).c_str());
+            if (statistics_length < 1 || statistics_length > OpcodeStatistics::kMaxLength) {
+                std::cout << "Error: 指令序列长度应在 1 至 " << OpcodeStatistics::kMaxLength << " 之间" << std::endl;
+                exit(1);
+            }
+        } else if (arg.compare(0, 8, "--trace=") == 0) {
+            trace_capacity = std::atoi(arg.substr(8).c_str());
+            if (trace_capacity < 1 || trace_capacity > (1 << 20)) {
+                std::cout << "Error: 轨迹容量应在 1 至 " << (1 << 20) << " 之间" << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--inline") {
+            inline_budget = Inliner::kDefaultBudget;
+        } else if (arg.compare(0, 9, "--inline=") == 0) {
+            inline_budget = std::atoi(arg.substr(9).c_str());
+            if (inline_budget < 1) {
+                std::cout << "Error: 内联的函数体上限应为正整数" << std::endl;
+                exit(1);
+            }
+        } else if (arg.compare(0, 12, "--callgraph=") == 0 && arg.size() > 12) {
+            call_graph_path = arg.substr(12);
+        } else if (arg.compare(0, 8, "--input=") == 0 && arg.size() > 8) {
+            input_path = arg.substr(8);
+        } else if (arg.compare(0, 13, "--checkpoint=") == 0 && arg.size() > 13) {
+            checkpoint_path = arg.substr(13);
+        } else if (arg.compare(0, 10, "--restore=") == 0 && arg.size() > 10) {
+            restore_path = arg.substr(10);
+        } else if (arg.compare(0, 7, "--fuel=") == 0) {
+            fuel = std::atoll(arg.substr(7).c_str());
+            if (fuel < 1) {
+                std::cout << "Error: 燃料上限应为正整数" << std::endl;
+                exit(1);
+            }
+        } else if (arg.compare(0, 13, "--time-limit=") == 0) {
+            time_limit = std::atoi(arg.substr(13).c_str());
+            if (time_limit < 1) {
+                std::cout << "Error: 运行时间上限应为正整数 (毫秒)" << std::endl;
+                exit(1);
+            }
+        } else if (arg.compare(0, 15, "--memory-limit=") == 0) {
+            memory_limit = parse_size(arg.substr(15));
+            if (memory_limit == 0) {
+                std::cout << "Error: 内存配额应为正整数, 可带 K, M, G 后缀" << std::endl;
+                exit(1);
+            }
+        } else if (arg.compare(0, 9, "--emit-c=") == 0 && arg.size() > 9) {
+            c_path = arg.substr(9);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cout << "Error: 未知选项 \"" << arg << "\"" << std::endl;
+            exit(1);
+        } else {
+            path = arg;
+        }
+    }
+    if ((statistics_length > 0 || use_profile || !call_graph_path.empty()) && !use_stack_engine) {
+        std::cout << "Error: 指令序列统计与性能剖析仅适用于栈式虚拟机 (--engine=stack)" << std::endl;
+        exit(1);
+    }
+    if (trace_capacity > 0 && !c_path.empty()) {
+        std::cout << "Error: 输出 C 代码时不能记录执行轨迹" << std::endl;
+        exit(1);
+    }
+    if ((!checkpoint_path.empty() || !restore_path.empty() || fuel > 0 || time_limit > 0) && (!use_stack_engine || !c_path.empty())) {
+        std::cout << "Error: 检查点, 燃料与运行时间上限仅适用于栈式虚拟机 (--engine=stack)" << std::endl;
+        exit(1);
+    }
+    if (!checkpoint_path.empty() && !restore_path.empty()) {
+        std::cout << "Error: 不能同时保存与恢复检查点" << std::endl;
+        exit(1);
+    }
+    if (memory_limit > 0 && !c_path.empty()) {
+        std::cout << "Error: 输出 C 代码时不能指定内存配额" << std::endl;
+        exit(1);
+    }
+    if (!input_path.empty() && !c_path.empty()) {
+        std::cout << "Error: 输出 C 代码时不能指定输入文件" << std::endl;
+        exit(1);
+    }
+    // 使用调试功能或指定分派方式时由命令行程序直接驱动栈式虚拟机
+    bool use_tools = statistics_length > 0 || use_profile || !call_graph_path.empty() || trace_capacity > 0 ||
+                     !checkpoint_path.empty() || !restore_path.empty() || dispatch != default_dispatch;
+    // read 语句默认读取标准输入
+    std::ifstream input_file;
+    if (!input_path.empty()) {
+        input_file.open(input_path, std::ios::binary);
+        if (!input_file) {
+            std::cout << "Error: 无法读取文件 \"" << input_path << "\"" << std::endl;
+            exit(1);
+        }
+    }
+    std::istream &input = input_path.empty() ? std::cin : input_file;
+    if (path.empty()) {
+        std::cout << "Error: 需要传入源码所在路径作为参数" << std::endl;
         exit(1);
     }
-    std::ifstream t(argv[1]);
+    std::ifstream t(path);
     std::stringstream buffer;
     buffer << t.rdbuf();
 
-    try {
-        Lexer lexer(buffer.str());
-        Parser parser(lexer, 2);
-        parser.parse_program();
-        cout << endl << "语法树:" << endl << endl;
-        parser.print_ast();
-        cout << endl;
-        Semantic semantic(parser.ast());
-        try {
-            semantic.analyse();
-            cout << endl << "中间代码:" << endl << endl;
-            semantic.print_ir();
-            semantic.print_warning_messages();
-        } catch (const scope_critical_error &e) {
-            semantic.print_error_messages();
-            semantic.print_warning_messages();
-            return 0;
+    // 前端由 libcmm 完成, 命令行程序只负责显示编译过程与运行结果
+    cmm::CompileOptions compile_options;
+    compile_options.fusion = use_fusion;
+    compile_options.inline_budget = inline_budget;
+    compile_options.listing = true;
+    cmm::Program program = cmm::compile(buffer.str(), compile_options);
+    const std::vector<cmm::Diagnostic> &diagnostics = program.diagnostics();
+    if (!diagnostics.empty() && (diagnostics[0].stage == cmm::Diagnostic::Stage::kLexer || diagnostics[0].stage == cmm::Diagnostic::Stage::kParser)) {
+        std::cout << diagnostics[0].text() << std::endl;
+        exit(0);
+    }
+    for (const cmm::Diagnostic &diagnostic : diagnostics) {
+        if (diagnostic.stage == cmm::Diagnostic::Stage::kInternal) {
+            std::cout << diagnostic.text() << std::endl;
+            exit(1);
+        }
+    }
+    cout << endl << "语法树:" << endl << endl << program.listing().syntax_tree << endl;
+    bool has_semantic_error = false;
+    for (const cmm::Diagnostic &diagnostic : diagnostics) {
+        if (diagnostic.stage == cmm::Diagnostic::Stage::kSemantic && diagnostic.severity == cmm::Diagnostic::Severity::kError) {
+            has_semantic_error = true;
+        }
+    }
+    if (!has_semantic_error) {
+        cout << endl << "中间代码:" << endl << endl << program.listing().ir << endl;
+    }
+    for (const cmm::Diagnostic &diagnostic : diagnostics) {
+        if (diagnostic.stage == cmm::Diagnostic::Stage::kSemantic) {
+            cout << diagnostic.text() << endl;
         }
+    }
+    if (has_semantic_error) {
+        return 0;
+    }
+    if (inline_budget > 0) {
+        cout << endl << program.listing().inline_report;
+        if (program.inlined_calls() > 0) {
+            cout << endl << "内联后的中间代码:" << endl << endl << program.ir();
+        }
+    }
+#ifdef SIGUSR1
+    if (trace_capacity > 0) {
+        std::signal(SIGUSR1, request_trace_dump);
+    }
+#endif
 
-        Simulator simulator(semantic.ir());
-        try {
+    try {
+        if (!c_path.empty()) {
+            // 输出 C 代码而不运行, 由系统的 C 编译器生成本地程序
+            std::ofstream output(c_path);
+            if (!output) {
+                std::cout << "Error: 无法写入文件 \"" << c_path << "\"" << std::endl;
+                exit(1);
+            }
+            CEmitter emitter(program.ir());
+            emitter.emit(output);
+            cout << endl << "C 代码已写入 " << c_path << endl;
+        } else if (use_stack_engine && !program.is_ok()) {
+            // 链接失败
             cout << endl << "运行结果:" << endl << endl;
-            simulator.run();
-        } catch (const simulator_error &e) {
-            std::cout << "[中间代码错误] " << e.what() << std::endl;
+            for (const cmm::Diagnostic &diagnostic : diagnostics) {
+                if (diagnostic.stage == cmm::Diagnostic::Stage::kLinker) {
+                    cout << diagnostic.text() << endl;
+                }
+            }
+        } else if (use_stack_engine && !use_tools) {
+            // 不需要调试功能时直接由 libcmm 运行
+            cmm::RunOptions run_options;
+            run_options.fuel = fuel;
+            run_options.time_limit = time_limit;
+            run_options.memory_limit = memory_limit;
+            cout << endl << "运行结果:" << endl << endl;
+            cmm::RunResult result = cmm::run(program, input, cout, run_options);
+            for (const cmm::Diagnostic &diagnostic : result.diagnostics) {
+                cout << diagnostic.text() << endl;
+            }
+            if (result.status == cmm::RunResult::Status::kOutOfFuel) {
+                print_abort("燃料已耗尽 (" + std::to_string(fuel) + ")", result.position);
+            } else if (result.status == cmm::RunResult::Status::kTimeout) {
+                print_abort("运行时间超过 " + std::to_string(time_limit) + " 毫秒", result.position);
+            }
+            if (memory_limit > 0) {
+                print_memory(result.peak_memory, memory_limit);
+            }
+        } else if (use_stack_engine) {
+            // 栈式虚拟机直接解释中间代码, 作为参考实现
+            Simulator simulator(program.compiled());
+            simulator.set_dispatch(dispatch);
+            simulator.set_input(input);
+            simulator.set_memory_limit(memory_limit);
+            simulator.set_statistics(statistics_length);
+            simulator.set_profile(use_profile);
+            simulator.set_call_graph(!call_graph_path.empty());
+            simulator.set_trace(trace_capacity);
+            cout << endl << "运行结果:" << endl << endl;
+            try {
+                if (time_limit > 0) {
+                    simulator.set_deadline(Simulator::Clock::now() + std::chrono::milliseconds(time_limit));
+                }
+                if (!restore_path.empty()) {
+                    // 从检查点恢复, 跳过保存前已完成的初始化
+                    std::ifstream snapshot(restore_path, std::ios::binary);
+                    if (!snapshot) {
+                        std::cout << "Error: 无法读取文件 \"" << restore_path << "\"" << std::endl;
+                        exit(1);
+                    }
+                    simulator.restore(snapshot);
+                } else {
+                    simulator.load();
+                }
+                if (!checkpoint_path.empty()) {
+                    // 在第一次读取输入前保存检查点, 之后继续运行
+                    simulator.set_pause_before_read(true);
+                    advance(simulator, fuel);
+                    if (simulator.pause_reason() == Simulator::Pause::kBeforeRead) {
+                        std::ofstream snapshot(checkpoint_path, std::ios::binary);
+                        if (!snapshot) {
+                            std::cout << "Error: 无法写入文件 \"" << checkpoint_path << "\"" << std::endl;
+                            exit(1);
+                        }
+                        simulator.save(snapshot);
+                        snapshot.close();
+                        cout << "检查点已写入 " << checkpoint_path << endl;
+                        advance(simulator, fuel);
+                    } else if (simulator.is_finished()) {
+                        cout << endl << "程序没有读取输入, 未写入检查点" << endl;
+                    }
+                } else {
+                    advance(simulator, fuel);
+                }
+                if (simulator.pause_reason() == Simulator::Pause::kFuel) {
+                    print_abort("燃料已耗尽 (" + std::to_string(fuel) + ")", simulator.position());
+                } else if (simulator.pause_reason() == Simulator::Pause::kDeadline) {
+                    print_abort("运行时间超过 " + std::to_string(time_limit) + " 毫秒", simulator.position());
+                }
+            } catch (const simulator_error &e) {
+                // 出错时仍输出已收集的统计与剖析结果
+                std::cout << "[中间代码错误] " << e.what() << std::endl;
+                if (trace_capacity > 0) {
+                    cout << endl;
+                    simulator.trace().print(cout, simulator.ir());
+                }
+            }
+            if (!call_graph_path.empty()) {
+                std::ofstream output(call_graph_path);
+                if (!output) {
+                    std::cout << "Error: 无法写入文件 \"" << call_graph_path << "\"" << std::endl;
+                    exit(1);
+                }
+                simulator.call_graph().print_folded(output);
+                cout << endl;
+                simulator.call_graph().print(cout);
+                cout << endl << "折叠栈已写入 " << call_graph_path << endl;
+            }
+            if (statistics_length > 0) {
+                cout << endl;
+                simulator.statistics().print(cout);
+            }
+            if (use_profile) {
+                cout << endl;
+                simulator.profiler().print(cout, simulator.ir());
+            }
+            if (memory_limit > 0) {
+                print_memory(simulator.memory().peak(), simulator.memory().limit());
+            }
+        } else {
+            RegisterSimulator simulator(program.ir());
+            simulator.set_jit(use_jit);
+            simulator.set_input(input);
+            simulator.set_memory_limit(memory_limit);
+            simulator.set_trace(trace_capacity);
+            simulator.load();
+            cout << endl << "字节码:" << endl << endl << simulator.program();
+            if (use_jit) {
+                // 列出已编译为本地代码的函数
+                cout << endl << "本地代码:" << endl << endl;
+                const std::vector<BytecodeFunction> &functions = simulator.program().functions();
+                for (int i = 0; i < (int)functions.size(); ++i) {
+                    if (simulator.jit().function(i) != nullptr) {
+                        cout << functions[i].name() << endl;
+                    }
+                }
+            }
+            cout << endl << "运行结果:" << endl << endl;
+            try {
+                simulator.run();
+            } catch (const simulator_error &e) {
+                std::cout << "[中间代码错误] " << e.what() << std::endl;
+                if (trace_capacity > 0) {
+                    cout << endl;
+                    simulator.trace().print(cout, simulator.program());
+                }
+            }
+            if (memory_limit > 0) {
+                print_memory(simulator.memory().peak(), simulator.memory().limit());
+            }
         }
-    } catch (const parser_exception &e) {
-        std::cout << e.what() << std::endl;
-        exit(0);
-    } catch (const lexer_exception &e) {
-        std::cout << e.what() << std::endl;
-        exit(0);
+    } catch (const simulator_error &e) {
+        std::cout << "[中间代码错误] " << e.what() << std::endl;
+    } catch (const snapshot_error &e) {
+        std::cout << "Error: " << e.what() << std::endl;
     }
 
     return 0;
@@ -13,6 +13,10 @@ Parser::Parser(const Lexer &lexer, const int &total) {
     }
 }
 
+Parser::~Parser() {
+    delete root_;
+}
+
 // 获取下一个 Token 并移动当前位置
 void Parser::consume() {
     lookahead_[index_] = lexer_.next_token();
@@ -57,6 +61,7 @@ AbstractSyntaxNode *Parser::ast() {
 
 // 解析整个程序
 void Parser::parse_program() {
+    delete root_;
     root_ = new AbstractSyntaxNode(Token(Token::Type::kProgram, TokenPosition(1, 0, 0)));
     current_ = root_;
 
@@ -573,8 +578,8 @@ void Parser::parse_function_call() {
     current_ = current_->parent();
 }
 
-void Parser::print_ast() const {
-    root_->print();
+void Parser::print_ast(std::ostream &os) const {
+    root_->print(os);
 }
 
 bool Parser::is_declare_keyword(const Token::Type &type) {
@@ -0,0 +1,689 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include "include/register_simulator.h"
+
+void RegisterSimulator::load() {
+    if (is_loaded_) {
+        return;
+    }
+
+    // 添加主函数调用
+    ir_.add(PCode(PCode::Type::kCall, "main"));
+
+    Linker linker(ir_);
+    linker.link();
+    Lowering lowering(linker);
+    lowering.lower();
+    program_ = lowering.program();
+    is_loaded_ = true;
+
+    if (use_jit_ && trace_capacity_ == 0 && Jit::is_supported()) {
+        Jit::Helpers helpers;
+        helpers.call = &RegisterSimulator::native_call;
+        helpers.execute = &RegisterSimulator::native_execute;
+        helpers.fail = &RegisterSimulator::native_fail;
+        helpers.arrays = &array_table_;
+        jit_.compile(program_, helpers);
+    }
+}
+
+void RegisterSimulator::run() {
+    load();
+
+    const BytecodeFunction &entry = program_.functions()[program_.entry_function()];
+    arrays_.clear();
+    array_owners_.clear();
+    array_views_.clear();
+    array_table_ = array_views_.data();
+    frames_.clear();
+    native_depth_ = 0;
+    trace_.reset(trace_capacity_);
+    try {
+        globals_.assign((unsigned long)program_.global_size(), Value());
+        globals_.insert(globals_.end(), program_.constants().begin(), program_.constants().end());
+        registers_.assign((unsigned long)std::max(entry.registers(), 256), Value());
+
+        Frame frame;
+        frame.return_pc = -1;
+        frame.base = 0;
+        frame.dst = 0;
+        frame.registers = entry.registers();
+        frame.array_mark = 0;
+        frames_.push_back(frame);
+    } catch (const memory_quota_error &e) {
+        throw simulator_error(0, e.what());
+    }
+
+    try {
+        execute(program_.function(program_.entry_function()).entry(), 1, nullptr);
+    } catch (const simulator_error &e) {
+        // 先写出已有的输出, 再由调用者报告错误
+        output_.flush();
+        throw;
+    }
+    output_.flush();
+}
+
+void RegisterSimulator::define_array(Value &target, const int &operand, const Value::Type &type, const int &size, const int &pc) {
+    if (size < 0) {
+        throw simulator_error(program_.line(pc), "数组大小不合法");
+    }
+
+    // 局部数组以寄存器在寄存器区中的位置为所有者, 全局数组以全局变量的编号 (负数) 为所有者
+    int owner = operand >= 0 ? frames_.back().base + operand : operand;
+    int mark = frames_.back().array_mark;
+    bool is_array = target.type() == Value::Type::kIntArray || target.type() == Value::Type::kRealArray;
+    int handle = is_array ? target.handle() : -1;
+    if (handle < mark || handle >= (int)arrays_.size() || array_owners_[handle] != owner) {
+        // 寄存器可能在兄弟语句块中被标量覆盖, 在本帧的数组中查找它原先拥有的数组
+        handle = -1;
+        for (int i = mark; i < (int)arrays_.size(); ++i) {
+            if (array_owners_[i] == owner) {
+                handle = i;
+                break;
+            }
+        }
+    }
+
+    // 分配器不知道指令位置, 超出配额时在此补上
+    Value zero = type == Value::Type::kIntArray ? Value(0) : Value(0.0);
+    try {
+        if (handle >= 0) {
+            arrays_[handle].assign((unsigned long)size, zero);
+        } else {
+            arrays_.push_back(Array((unsigned long)size, zero, AccountingAllocator<Value>(&quota_)));
+            array_owners_.push_back(owner);
+            array_views_.push_back(Jit::ArrayView());
+            array_table_ = array_views_.data();
+            handle = (int)arrays_.size() - 1;
+        }
+        array_views_[handle].elements = arrays_[handle].data();
+        array_views_[handle].size = size;
+    } catch (const memory_quota_error &e) {
+        throw simulator_error(program_.line(pc), e.what());
+    }
+    target = Value(type, handle);
+}
+
+Value &RegisterSimulator::element(const Value &array, const Value &index, const int &pc) {
+    Array &elements = arrays_[array.handle()];
+    int offset = index.int_value();
+    if (offset < 0 || offset >= (int)elements.size()) {
+        throw simulator_error(program_.line(pc), "数组下标越界");
+    }
+    return elements[offset];
+}
+
+Value *RegisterSimulator::enter_function(const int &pc, Value *base) {
+    const Bytecode &call = program_.at(pc);
+    const BytecodeFunction &callee = program_.function(call.b());
+    const Frame &caller = frames_.back();
+    Value *globals = globals_.data();
+
+    // 新帧紧接在调用者的寄存器之后, 寄存器区扩容后需要重新定位当前帧
+    int callee_base = caller.base + caller.registers;
+    unsigned long required = (unsigned long)(callee_base + callee.registers());
+    if (registers_.size() < required) {
+        try {
+            registers_.resize(std::max(required, registers_.size() * 2));
+        } catch (const memory_quota_error &e) {
+            throw simulator_error(program_.line(pc), e.what());
+        }
+        base = registers_.data() + caller.base;
+    }
+
+    // 清空局部变量, 避免定义数组时误用上一次调用残留的句柄
+    Value *callee_registers = registers_.data() + callee_base;
+    for (int i = 0; i < callee.frame_size(); ++i) {
+        callee_registers[i] = Value();
+    }
+
+    // 实参按形参类型转换
+    const int *argument = program_.arguments().data() + call.c();
+    for (const std::pair<int, Value::Type> &parameter : callee.parameters()) {
+        int operand = *argument++;
+        const Value &value = operand >= 0 ? base[operand] : globals[~operand];
+        if (!value.is_number()) {
+            throw simulator_error(program_.line(pc), "不支持的函数调用实参类型");
+        }
+        if (parameter.second == Value::Type::kInt) {
+            callee_registers[parameter.first] = Value(value.to_int());
+        } else {
+            callee_registers[parameter.first] = Value(value.to_real());
+        }
+    }
+
+    Frame frame;
+    frame.return_pc = pc + 1;
+    frame.base = callee_base;
+    frame.dst = call.a();
+    frame.registers = callee.registers();
+    frame.array_mark = (int)arrays_.size();
+    try {
+        frames_.push_back(frame);
+    } catch (const memory_quota_error &e) {
+        throw simulator_error(program_.line(pc), e.what());
+    }
+
+    return callee_registers;
+}
+
+Value *RegisterSimulator::leave_function(const Value &value, int &return_pc) {
+    Frame frame = frames_.back();
+    frames_.pop_back();
+
+    if ((int)arrays_.size() > frame.array_mark) {
+        arrays_.resize((unsigned long)frame.array_mark);
+        array_owners_.resize((unsigned long)frame.array_mark);
+        array_views_.resize((unsigned long)frame.array_mark);
+    }
+
+    Value *base = registers_.data() + frames_.back().base;
+    (frame.dst >= 0 ? base[frame.dst] : globals_[~frame.dst]) = value;
+    return_pc = frame.return_pc;
+    return base;
+}
+
+Value *RegisterSimulator::native_call(void *simulator, Value *base, int pc) {
+    RegisterSimulator &self = *(RegisterSimulator *)simulator;
+    try {
+        int function = self.program_.at(pc).b();
+        base = self.enter_function(pc, base);
+        Value value;
+        Jit::NativeFunction native = self.native_function(function);
+        if (native != nullptr) {
+            if (self.run_native(native, base, &value) != 0) {
+                return nullptr;
+            }
+        } else {
+            self.execute(self.program_.function(function).entry(), (int)self.frames_.size(), &value);
+        }
+        return self.leave_function(value, pc);
+    } catch (...) {
+        self.jit_error_ = std::current_exception();
+        return nullptr;
+    }
+}
+
+int RegisterSimulator::native_execute(void *simulator, Value *base, int pc) {
+    RegisterSimulator &self = *(RegisterSimulator *)simulator;
+    const Bytecode &code = self.program_.at(pc);
+    Value *globals = self.globals_.data();
+    Value &target = code.a() >= 0 ? base[code.a()] : globals[~code.a()];
+    try {
+        switch (code.type()) {
+            case Bytecode::Type::kVarIntegerArray:
+            case Bytecode::Type::kVarRealArray: {
+                Value::Type type = code.type() == Bytecode::Type::kVarIntegerArray ? Value::Type::kIntArray : Value::Type::kRealArray;
+                int size = (code.b() >= 0 ? base[code.b()] : globals[~code.b()]).int_value();
+                self.define_array(target, code.a(), type, size, pc);
+                break;
+            }
+            case Bytecode::Type::kPrint:
+                if (target.type() == Value::Type::kInt) {
+                    self.output_.write(target.int_value());
+                } else if (target.type() == Value::Type::kReal) {
+                    self.output_.write(target.real_value());
+                } else {
+                    throw simulator_error(self.program_.line(pc), "不合法的输出参数");
+                }
+                break;
+            case Bytecode::Type::kReadInt: {
+                int input = self.input_.read_integer(self.program_.line(pc));
+                target = Value(input);
+                break;
+            }
+            case Bytecode::Type::kReadReal: {
+                double input = self.input_.read_real(self.program_.line(pc));
+                target = Value(input);
+                break;
+            }
+            case Bytecode::Type::kReadIntArray: {
+                int input = self.input_.read_integer(self.program_.line(pc));
+                self.element(target, code.b() >= 0 ? base[code.b()] : globals[~code.b()], pc) = Value(input);
+                break;
+            }
+            case Bytecode::Type::kReadRealArray: {
+                double input = self.input_.read_real(self.program_.line(pc));
+                self.element(target, code.b() >= 0 ? base[code.b()] : globals[~code.b()], pc) = Value(input);
+                break;
+            }
+            default:
+                break;
+        }
+    } catch (...) {
+        self.jit_error_ = std::current_exception();
+        return 1;
+    }
+    return 0;
+}
+
+void RegisterSimulator::native_fail(void *simulator, Value *base, int pc) {
+    RegisterSimulator &self = *(RegisterSimulator *)simulator;
+    const Bytecode &code = self.program_.at(pc);
+    std::string message;
+    switch (code.type()) {
+        case Bytecode::Type::kLoadIntegerArray:
+        case Bytecode::Type::kLoadRealArray:
+            message = "数组下标越界";
+            break;
+        case Bytecode::Type::kStoreIntegerArray:
+        case Bytecode::Type::kStoreRealArray:
+            // 与解释器一致, 先检查写入的值再检查下标
+            if ((code.c() >= 0 ? base[code.c()] : self.globals_[~code.c()]).is_number()) {
+                message = "数组下标越界";
+            } else {
+                message = "无法取出栈顶元素";
+            }
+            break;
+        case Bytecode::Type::kCheck:
+            message = "变量 \"" + self.program_.name(code.b()) + "\" 未初始化而直接使用";
+            break;
+        case Bytecode::Type::kDivInteger:
+        case Bytecode::Type::kDivReal:
+            message = "除数不能为 0";
+            break;
+        default:
+            message = "无法取出栈顶元素";
+            break;
+    }
+    self.jit_error_ = std::make_exception_ptr(simulator_error(self.program_.line(pc), message));
+}
+
+void RegisterSimulator::execute(int pc, const int &depth, Value *result) {
+    const Bytecode *code = program_.code().data();
+    Value *globals = globals_.data();
+    Value *base = registers_.data() + frames_.back().base;
+
+    // 操作数为非负数时位于当前帧, 否则位于全局区
+#define CMM_REG(operand) (*((operand) >= 0 ? base + (operand) : globals + ~(operand)))
+
+#ifdef CMM_HAS_THREADED_DISPATCH
+    // 处理代码的顺序必须与 Bytecode::Type 一致
+    static const void *handlers[] = {
+        &&op_move, &&op_move_integer, &&op_move_real, &&op_integer_to_real, &&op_check, &&op_var_integer,
+        &&op_var_real, &&op_var_integer_array, &&op_var_real_array, &&op_load_integer_array,
+        &&op_load_real_array, &&op_store_integer_array, &&op_store_real_array, &&op_add_integer, &&op_add_real,
+        &&op_sub_integer, &&op_sub_real, &&op_mul_integer, &&op_mul_real, &&op_div_integer, &&op_div_real,
+        &&op_compare_equal_integer, &&op_compare_equal_real, &&op_compare_not_equal_integer,
+        &&op_compare_not_equal_real, &&op_compare_greater_than_integer, &&op_compare_greater_than_real,
+        &&op_compare_less_than_integer, &&op_compare_less_than_real, &&op_compare_greater_equal_integer,
+        &&op_compare_greater_equal_real, &&op_compare_less_equal_integer, &&op_compare_less_equal_real,
+        &&op_jump, &&op_jump_zero, &&op_jump_not_zero, &&op_jump_zero_equal_integer, &&op_jump_zero_equal_real,
+        &&op_jump_zero_not_equal_integer, &&op_jump_zero_not_equal_real, &&op_jump_zero_greater_than_integer,
+        &&op_jump_zero_greater_than_real, &&op_jump_zero_less_than_integer, &&op_jump_zero_less_than_real,
+        &&op_jump_zero_greater_equal_integer, &&op_jump_zero_greater_equal_real,
+        &&op_jump_zero_less_equal_integer, &&op_jump_zero_less_equal_real, &&op_call, &&op_return, &&op_print,
+        &&op_read_int, &&op_read_real, &&op_read_int_array, &&op_read_real_array, &&op_halt,
+    };
+
+    // 记录轨迹时改用另一张表, 每条指令先经过记录轨迹的处理代码, 调用与跳转处还检查输出请求; 不记录时的执行路径不受影响
+    static const int kHandlers = sizeof(handlers) / sizeof(handlers[0]);
+    const void *traced_handlers[kHandlers];
+    const void *const *table = handlers;
+    if (trace_.is_enabled()) {
+        for (int type = 0; type < kHandlers; ++type) {
+            traced_handlers[type] = &&op_trace;
+        }
+        traced_handlers[(int)Bytecode::Type::kJump] = &&op_trace_and_poll;
+        traced_handlers[(int)Bytecode::Type::kCall] = &&op_trace_and_poll;
+        table = traced_handlers;
+    }
+#define CMM_OP(name, type) name:
+#define CMM_NEXT() goto *table[(int)code[pc].type()]
+
+    CMM_NEXT();
+
+    op_trace_and_poll:
+        if (TraceBuffer::take_dump_request()) {
+            trace_.print(std::cerr, program_);
+        }
+    op_trace:
+        trace_.record(pc, (int)frames_.size(), Value());
+        goto *handlers[(int)code[pc].type()];
+#else
+#define CMM_OP(name, type) case Bytecode::Type::type:
+#define CMM_NEXT() continue
+
+    bool is_traced = trace_.is_enabled();
+    while (true) {
+        if (is_traced) {
+            if ((code[pc].type() == Bytecode::Type::kJump || code[pc].type() == Bytecode::Type::kCall) && TraceBuffer::take_dump_request()) {
+                trace_.print(std::cerr, program_);
+            }
+            trace_.record(pc, (int)frames_.size(), Value());
+        }
+        switch (code[pc].type()) {
+#endif
+
+    CMM_OP(op_move, kMove) {
+        CMM_REG(code[pc].a()) = CMM_REG(code[pc].b());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_move_integer, kMoveInteger) {
+        const Value &value = CMM_REG(code[pc].b());
+        if (value.type() == Value::Type::kInt) {
+            CMM_REG(code[pc].a()) = value;
+        } else if (value.type() == Value::Type::kReal) {
+            CMM_REG(code[pc].a()) = Value((int)value.real_value());
+        } else {
+            throw simulator_error(program_.line(pc), "无法取出栈顶元素");
+        }
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_move_real, kMoveReal) {
+        const Value &value = CMM_REG(code[pc].b());
+        if (!value.is_number()) {
+            throw simulator_error(program_.line(pc), "无法取出栈顶元素");
+        }
+        CMM_REG(code[pc].a()) = Value(value.to_real());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_integer_to_real, kIntegerToReal) {
+        CMM_REG(code[pc].a()) = Value((double)CMM_REG(code[pc].b()).int_value());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_check, kCheck) {
+        if (CMM_REG(code[pc].a()).type() == Value::Type::kNone) {
+            throw simulator_error(program_.line(pc), "变量 \"" + program_.name(code[pc].b()) + "\" 未初始化而直接使用");
+        }
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_var_integer, kVarInteger) {
+        CMM_REG(code[pc].a()) = Value();
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_var_real, kVarReal) {
+        CMM_REG(code[pc].a()) = Value(0.0);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_var_integer_array, kVarIntegerArray) {
+        define_array(CMM_REG(code[pc].a()), code[pc].a(), Value::Type::kIntArray, CMM_REG(code[pc].b()).int_value(), pc);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_var_real_array, kVarRealArray) {
+        define_array(CMM_REG(code[pc].a()), code[pc].a(), Value::Type::kRealArray, CMM_REG(code[pc].b()).int_value(), pc);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_load_integer_array, kLoadIntegerArray)
+    CMM_OP(op_load_real_array, kLoadRealArray) {
+        Value value = element(CMM_REG(code[pc].b()), CMM_REG(code[pc].c()), pc);
+        CMM_REG(code[pc].a()) = value;
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_store_integer_array, kStoreIntegerArray) {
+        const Value &value = CMM_REG(code[pc].c());
+        if (!value.is_number()) {
+            throw simulator_error(program_.line(pc), "无法取出栈顶元素");
+        }
+        element(CMM_REG(code[pc].a()), CMM_REG(code[pc].b()), pc) = Value(value.to_int());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_store_real_array, kStoreRealArray) {
+        const Value &value = CMM_REG(code[pc].c());
+        if (!value.is_number()) {
+            throw simulator_error(program_.line(pc), "无法取出栈顶元素");
+        }
+        element(CMM_REG(code[pc].a()), CMM_REG(code[pc].b()), pc) = Value(value.to_real());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_add_integer, kAddInteger) {
+        CMM_REG(code[pc].a()) = Value((int)((unsigned)CMM_REG(code[pc].b()).int_value() + (unsigned)CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_add_real, kAddReal) {
+        CMM_REG(code[pc].a()) = Value(CMM_REG(code[pc].b()).real_value() + CMM_REG(code[pc].c()).real_value());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_sub_integer, kSubInteger) {
+        CMM_REG(code[pc].a()) = Value((int)((unsigned)CMM_REG(code[pc].b()).int_value() - (unsigned)CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_sub_real, kSubReal) {
+        CMM_REG(code[pc].a()) = Value(CMM_REG(code[pc].b()).real_value() - CMM_REG(code[pc].c()).real_value());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_mul_integer, kMulInteger) {
+        CMM_REG(code[pc].a()) = Value((int)((unsigned)CMM_REG(code[pc].b()).int_value() * (unsigned)CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_mul_real, kMulReal) {
+        CMM_REG(code[pc].a()) = Value(CMM_REG(code[pc].b()).real_value() * CMM_REG(code[pc].c()).real_value());
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_div_integer, kDivInteger) {
+        int left = CMM_REG(code[pc].b()).int_value();
+        int right = CMM_REG(code[pc].c()).int_value();
+        if (right == 0) {
+            throw simulator_error(program_.line(pc), "除数不能为 0");
+        }
+        CMM_REG(code[pc].a()) = Value(right == -1 ? (int)(0u - (unsigned)left) : left / right);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_div_real, kDivReal) {
+        double right = CMM_REG(code[pc].c()).real_value();
+        if (std::fabs(right) < 1e-8) {
+            throw simulator_error(program_.line(pc), "除数不能为 0");
+        }
+        CMM_REG(code[pc].a()) = Value(CMM_REG(code[pc].b()).real_value() / right);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_equal_integer, kCompareEqualInteger) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).int_value() == CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_equal_real, kCompareEqualReal) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).real_value() == CMM_REG(code[pc].c()).real_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_not_equal_integer, kCompareNotEqualInteger) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).int_value() != CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_not_equal_real, kCompareNotEqualReal) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).real_value() != CMM_REG(code[pc].c()).real_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_greater_than_integer, kCompareGreaterThanInteger) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).int_value() > CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_greater_than_real, kCompareGreaterThanReal) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).real_value() > CMM_REG(code[pc].c()).real_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_less_than_integer, kCompareLessThanInteger) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).int_value() < CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_less_than_real, kCompareLessThanReal) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).real_value() < CMM_REG(code[pc].c()).real_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_greater_equal_integer, kCompareGreaterEqualInteger) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).int_value() >= CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_greater_equal_real, kCompareGreaterEqualReal) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).real_value() >= CMM_REG(code[pc].c()).real_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_less_equal_integer, kCompareLessEqualInteger) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).int_value() <= CMM_REG(code[pc].c()).int_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_compare_less_equal_real, kCompareLessEqualReal) {
+        CMM_REG(code[pc].a()) = Value((int)(CMM_REG(code[pc].b()).real_value() <= CMM_REG(code[pc].c()).real_value()));
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump, kJump) {
+        pc = code[pc].a();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero, kJumpZero) {
+        pc = CMM_REG(code[pc].a()).int_value() == 0 ? code[pc].b() : pc + 1;
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_not_zero, kJumpNotZero) {
+        pc = CMM_REG(code[pc].a()).int_value() != 0 ? code[pc].b() : pc + 1;
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_equal_integer, kJumpZeroEqualInteger) {
+        pc = CMM_REG(code[pc].a()).int_value() == CMM_REG(code[pc].b()).int_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_equal_real, kJumpZeroEqualReal) {
+        pc = CMM_REG(code[pc].a()).real_value() == CMM_REG(code[pc].b()).real_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_not_equal_integer, kJumpZeroNotEqualInteger) {
+        pc = CMM_REG(code[pc].a()).int_value() != CMM_REG(code[pc].b()).int_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_not_equal_real, kJumpZeroNotEqualReal) {
+        pc = CMM_REG(code[pc].a()).real_value() != CMM_REG(code[pc].b()).real_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_greater_than_integer, kJumpZeroGreaterThanInteger) {
+        pc = CMM_REG(code[pc].a()).int_value() > CMM_REG(code[pc].b()).int_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_greater_than_real, kJumpZeroGreaterThanReal) {
+        pc = CMM_REG(code[pc].a()).real_value() > CMM_REG(code[pc].b()).real_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_less_than_integer, kJumpZeroLessThanInteger) {
+        pc = CMM_REG(code[pc].a()).int_value() < CMM_REG(code[pc].b()).int_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_less_than_real, kJumpZeroLessThanReal) {
+        pc = CMM_REG(code[pc].a()).real_value() < CMM_REG(code[pc].b()).real_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_greater_equal_integer, kJumpZeroGreaterEqualInteger) {
+        pc = CMM_REG(code[pc].a()).int_value() >= CMM_REG(code[pc].b()).int_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_greater_equal_real, kJumpZeroGreaterEqualReal) {
+        pc = CMM_REG(code[pc].a()).real_value() >= CMM_REG(code[pc].b()).real_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_less_equal_integer, kJumpZeroLessEqualInteger) {
+        pc = CMM_REG(code[pc].a()).int_value() <= CMM_REG(code[pc].b()).int_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_jump_zero_less_equal_real, kJumpZeroLessEqualReal) {
+        pc = CMM_REG(code[pc].a()).real_value() <= CMM_REG(code[pc].b()).real_value() ? pc + 1 : code[pc].c();
+        CMM_NEXT();
+    }
+    CMM_OP(op_call, kCall) {
+        int function = code[pc].b();
+        base = enter_function(pc, base);
+#ifdef CMM_HAS_JIT
+        // 已编译的函数直接执行本地代码
+        Jit::NativeFunction native = native_function(function);
+        if (native != nullptr) {
+            Value value;
+            if (run_native(native, base, &value) != 0) {
+                std::rethrow_exception(jit_error_);
+            }
+            base = leave_function(value, pc);
+            CMM_NEXT();
+        }
+#endif
+        pc = program_.function(function).entry();
+        CMM_NEXT();
+    }
+    CMM_OP(op_return, kReturn) {
+        Value value = CMM_REG(code[pc].a());
+        // 返回到 execute 的调用者时结束解释执行
+        if ((int)frames_.size() == depth) {
+            *result = value;
+            return;
+        }
+        base = leave_function(value, pc);
+        CMM_NEXT();
+    }
+    CMM_OP(op_print, kPrint) {
+        const Value &value = CMM_REG(code[pc].a());
+        if (value.type() == Value::Type::kInt) {
+            output_.write(value.int_value());
+        } else if (value.type() == Value::Type::kReal) {
+            output_.write(value.real_value());
+        } else {
+            throw simulator_error(program_.line(pc), "不合法的输出参数");
+        }
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_read_int, kReadInt) {
+        int input = input_.read_integer(program_.line(pc));
+        CMM_REG(code[pc].a()) = Value(input);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_read_real, kReadReal) {
+        double input = input_.read_real(program_.line(pc));
+        CMM_REG(code[pc].a()) = Value(input);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_read_int_array, kReadIntArray) {
+        int input = input_.read_integer(program_.line(pc));
+        element(CMM_REG(code[pc].a()), CMM_REG(code[pc].b()), pc) = Value(input);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_read_real_array, kReadRealArray) {
+        double input = input_.read_real(program_.line(pc));
+        element(CMM_REG(code[pc].a()), CMM_REG(code[pc].b()), pc) = Value(input);
+        ++pc;
+        CMM_NEXT();
+    }
+    CMM_OP(op_halt, kHalt) {
+        return;
+    }
+
+#ifndef CMM_HAS_THREADED_DISPATCH
+        }
+    }
+#endif
+
+#undef CMM_OP
+#undef CMM_NEXT
+#undef CMM_REG
+}
+
@@ -12,6 +12,12 @@ ScopeNode::ScopeNode(ScopeNode *enclosing_scope) : enclosing_scope_(enclosing_sc
     }
 }
 
+ScopeNode::~ScopeNode() {
+    for (std::list<ScopeNode *>::iterator it = children_.begin(); it != children_.end(); ++it) {
+        delete *it;
+    }
+}
+
 Symbol &ScopeNode::resolve(const std::string &name) {
     std::map<std::string, Symbol>::iterator it = symbols_.find(name);
     if (it != symbols_.end()) {
@@ -80,6 +86,10 @@ ScopeTree::ScopeTree() {
     current_ = root_;
 }
 
+ScopeTree::~ScopeTree() {
+    delete root_;
+}
+
 Symbol &ScopeTree::resolve(const std::string &name) {
     return current_->resolve(name);
 }
@@ -109,7 +109,7 @@ Token Semantic::analyse_function(const int &pos) {
     }
     tree_.pop(); // 作用域递减
 
-    build_function_ir_end(identity);        // 生成函数结尾 IR
+    build_function_ir_end(identity, declare_keyword);   // 生成函数结尾 IR
     current_ = current_->parent();
     return Token(Token::Type::kFunction, current_->token().position());
 }
@@ -157,22 +157,24 @@ Token Semantic::analyse_if_statement(const int &pos, const Symbol &function_symb
 
     build_if_statement_ir_begin(if_signature);
     Token condition = analyse_condition(0);
-    build_if_statement_ir_jz(if_signature);
     tree_.push();
+    build_if_statement_ir_jz(if_signature);
     current_ = child(1);
     for (int i = 0; i < children_size(); ++i) {
         analyse_statement(i, function_symbol);
     }
     current_ = current_->parent();
-    tree_.pop();
     build_if_statement_ir_else(if_signature);
+    tree_.pop();
     if (children_size() > 2) {
         tree_.push();
+        build_enter_scope_ir();
         current_ = child(2);
         for (int i = 0; i < children_size(); ++i) {
             analyse_statement(i, function_symbol);
         }
         current_ = current_->parent();
+        build_leave_scope_ir();
         tree_.pop();
     }
     build_if_statement_ir_end(if_signature);
@@ -190,15 +192,15 @@ Token Semantic::analyse_while_statement(const int &pos, const Symbol &function_s
 
     build_while_statement_ir_begin(while_signature);
     Token condition = analyse_condition(0);
-    build_while_statement_ir_jz(while_signature);
     tree_.push();
+    build_while_statement_ir_jz(while_signature);
     current_ = child(1);
     for (int i = 0; i < children_size(); ++i) {
         analyse_statement(i, function_symbol);
     }
     current_ = current_->parent();
-    tree_.pop();
     build_while_statement_ir_end(while_signature);
+    tree_.pop();
 
     current_ = current_->parent();
     return result;
@@ -286,7 +288,7 @@ Token Semantic::analyse_assign_statement(const int &pos) {
         throw scope_critical_error();
     }
 
-    build_assign_statement_ir(left_identity, right_expression);
+    build_assign_statement_ir(left_identity, left_identity_symbol, right_expression);
     tree_.resolve(left_identity.content()).set_assigned();  // 直接修改AST树种的节点
 
     current_ = current_->parent();
@@ -351,6 +353,7 @@ Token Semantic::analyse_return_statement(const int &pos, const Symbol &function_
     Token result = analyse_expression(0);
     if (function_symbol.ret_type() != Symbol::convert_token_type(result.type())) {
         if (result.type() == Token::Type::kInt && function_symbol.type() == Symbol::Type::kReal) {
+            ir_.add(PCode(PCode::Type::kIntegerToReal, ir_indent_));
             result.set_type(Token::Type::kReal);
         } else {
             add_error_messages(result.position(), "函数 \"" + function_symbol.name() + "\" 的返回类型不相符");
@@ -439,9 +442,10 @@ Token Semantic::analyse_condition(const int &pos) {
 
     Token first = analyse_expression(0);
     Token op = analyse_comparison_op(1);
+    int first_end = ir_.size();
     Token second = analyse_expression(2);
 
-    build_condition_ir(op);
+    build_condition_ir(op, build_conversion_ir(first_end, first, second));
 
     current_ = current_->parent();
     return result;
@@ -485,13 +489,12 @@ Token Semantic::analyse_expression(const int &pos) {
     result = analyse_term(offset++);
     while (offset < children_size()) {
         Token op = analyse_add_op(offset++);
+        int result_end = ir_.size();
         Token term = analyse_term(offset++);
 
-        if (result.type() == Token::Type::kReal || term.type() == Token::Type::kReal) {
-            result.set_type(Token::Type::kReal);
-        }
+        result.set_type(build_conversion_ir(result_end, result, term));
 
-        build_expression_ir(op);
+        build_expression_ir(op, result);
     }
 
     current_ = current_->parent();
@@ -507,13 +510,12 @@ Token Semantic::analyse_term(const int &pos) {
     result = analyse_factor(offset++);
     while (offset < children_size()) {
         Token op = analyse_mul_op(offset++);
+        int result_end = ir_.size();
         Token factor = analyse_factor(offset++);
 
-        if (result.type() == Token::Type::kReal || factor.type() == Token::Type::kReal) {
-            result.set_type(Token::Type::kReal);
-        }
+        result.set_type(build_conversion_ir(result_end, result, factor));
 
-        build_term_ir(op);
+        build_term_ir(op, result);
     }
 
     current_ = current_->parent();
@@ -658,6 +660,14 @@ const IR &Semantic::ir() const {
     return ir_;
 }
 
+const std::vector<std::pair<Position, std::string> > &Semantic::error_messages() const {
+    return error_messages_;
+}
+
+const std::vector<std::pair<Position, std::string> > &Semantic::warning_messages() const {
+    return warning_messages_;
+}
+
 void Semantic::print_error_messages() const {
     for (int i = 0; i < error_messages_.size(); ++i) {
         std::cout << "[错误] 第 " << error_messages_[i].first.row() << " 行 第 " << error_messages_[i].first.col() << " 列: " << error_messages_[i].second << std::endl;
@@ -723,11 +733,17 @@ void Semantic::build_function_ir_args(const std::vector<std::pair<Token, Token>
     }
 }
 
-void Semantic::build_function_ir_end(const Token &identity) {
-    ir_.add(PCode(PCode::Type::kEndFunc, identity.content(), ir_indent_));
+// ENDFUNC 记录函数的返回类型, 函数末尾没有 return 时按该类型返回 0
+void Semantic::build_function_ir_end(const Token &identity, const Token &declare_keyword) {
+    ir_.add(PCode(PCode::Type::kEndFunc, identity.content(), Symbol::symbol_type_name(Symbol::convert_token_type(declare_keyword.type())), ir_indent_));
 }
 
+// 返回值直接是函数调用的结果时, 调用处于尾位置, 改为尾调用以复用当前函数的帧
+// ret 仍保留在尾调用之后, 不支持尾调用的执行方式可以按普通调用执行后返回
 void Semantic::build_return_statement_ir(const Token &literal) {
+    if (ir_.size() > 0 && ir_.at(ir_.size() - 1).type() == PCode::Type::kCall) {
+        ir_.at(ir_.size() - 1).set(PCode::Type::kTailCall);
+    }
     ir_.add(PCode(PCode::Type::kReturn, ir_indent_));
 }
 
@@ -750,19 +766,24 @@ void Semantic::build_declare_statement_ir(const Token &declare_keyword, const To
     }
 }
 
-void Semantic::build_assign_statement_ir(const Token &left_identity, const Token &right_expression) {
+// 按左值的定义类型生成出栈指令, int 赋值给 real 时先显式转换
+void Semantic::build_assign_statement_ir(const Token &left_identity, const Symbol &left_symbol, const Token &right_expression) {
+    if (right_expression.type() != Token::Type::kReal && (left_symbol.type() == Symbol::Type::kReal || left_symbol.type() == Symbol::Type::kRealArray)) {
+        ir_.add(PCode(PCode::Type::kIntegerToReal, ir_indent_));
+    }
+
     if (left_identity.type() == Token::Type::kIdentityArray) {
-        if (right_expression.type() == Token::Type::kInt) {
+        if (left_symbol.type() == Symbol::Type::kIntArray) {
             ir_.add(PCode(PCode::Type::kPopIntegerArray, left_identity.content(), left_identity.extra().at(1), ir_indent_));
-        } else if (right_expression.type() == Token::Type::kReal) {
+        } else if (left_symbol.type() == Symbol::Type::kRealArray) {
             ir_.add(PCode(PCode::Type::kPopRealArray, left_identity.content(), left_identity.extra().at(1), ir_indent_));
         } else {
             throw std::invalid_argument("build_assign_statement_ir 1 failed, not expected.");
         }
     } else if (left_identity.type() == Token::Type::kIdentity) {
-        if (right_expression.type() == Token::Type::kInt) {
+        if (left_symbol.type() == Symbol::Type::kInt) {
             ir_.add(PCode(PCode::Type::kPopInteger, left_identity.content(), ir_indent_));
-        } else if (right_expression.type() == Token::Type::kReal) {
+        } else if (left_symbol.type() == Symbol::Type::kReal) {
             ir_.add(PCode(PCode::Type::kPopReal, left_identity.content(), ir_indent_));
         } else {
             throw std::invalid_argument("build_assign_statement_ir 2 failed, not expected.");
@@ -772,19 +793,35 @@ void Semantic::build_assign_statement_ir(const Token &left_identity, const Token
     }
 }
 
-void Semantic::build_expression_ir(const Token &op) {
+// 统一双操作数的类型: 任一操作数为 real 时, 将另一个 int 操作数转换为 real
+// 左操作数的中间代码结束于 left_end, 需要在该处插入转换指令
+Token::Type Semantic::build_conversion_ir(const int &left_end, const Token &left, const Token &right) {
+    if (left.type() != Token::Type::kReal && right.type() != Token::Type::kReal) {
+        return Token::Type::kInt;
+    }
+    if (left.type() != Token::Type::kReal) {
+        ir_.insert(left_end, PCode(PCode::Type::kIntegerToReal, ir_indent_));
+    } else if (right.type() != Token::Type::kReal) {
+        ir_.add(PCode(PCode::Type::kIntegerToReal, ir_indent_));
+    }
+    return Token::Type::kReal;
+}
+
+void Semantic::build_expression_ir(const Token &op, const Token &operand) {
+    bool is_real = operand.type() == Token::Type::kReal;
     if (op.type() == Token::Type::kPlus) {
-        ir_.add(PCode(PCode::Type::kAdd, ir_indent_));
+        ir_.add(PCode(is_real ? PCode::Type::kAddReal : PCode::Type::kAddInteger, ir_indent_));
     } else {
-        ir_.add(PCode(PCode::Type::kSub, ir_indent_));
+        ir_.add(PCode(is_real ? PCode::Type::kSubReal : PCode::Type::kSubInteger, ir_indent_));
     }
 }
 
-void Semantic::build_term_ir(const Token &op) {
+void Semantic::build_term_ir(const Token &op, const Token &operand) {
+    bool is_real = operand.type() == Token::Type::kReal;
     if (op.type() == Token::Type::kTimes) {
-        ir_.add(PCode(PCode::Type::kMul, ir_indent_));
+        ir_.add(PCode(is_real ? PCode::Type::kMulReal : PCode::Type::kMulInteger, ir_indent_));
     } else {
-        ir_.add(PCode(PCode::Type::kDiv, ir_indent_));
+        ir_.add(PCode(is_real ? PCode::Type::kDivReal : PCode::Type::kDivInteger, ir_indent_));
     }
 }
 
@@ -818,40 +855,52 @@ void Semantic::build_read_statement_ir(const Token &token, const Symbol &symbol)
     }
 }
 
-void Semantic::build_condition_ir(const Token &op) {
+void Semantic::build_condition_ir(const Token &op, const Token::Type &type) {
+    bool is_real = type == Token::Type::kReal;
     switch (op.type()) {
         case Token::Type::kLT:
-            ir_.add(PCode(PCode::Type::kCompareLessThan, ir_indent_));
+            ir_.add(PCode(is_real ? PCode::Type::kCompareLessThanReal : PCode::Type::kCompareLessThanInteger, ir_indent_));
             break;
         case Token::Type::kLTE:
-            ir_.add(PCode(PCode::Type::kCompareLessEqual, ir_indent_));
+            ir_.add(PCode(is_real ? PCode::Type::kCompareLessEqualReal : PCode::Type::kCompareLessEqualInteger, ir_indent_));
             break;
         case Token::Type::kGT:
-            ir_.add(PCode(PCode::Type::kCompareGreaterThan, ir_indent_));
+            ir_.add(PCode(is_real ? PCode::Type::kCompareGreaterThanReal : PCode::Type::kCompareGreaterThanInteger, ir_indent_));
             break;
         case Token::Type::kGTE:
-            ir_.add(PCode(PCode::Type::kCompareGreaterEqual, ir_indent_));
+            ir_.add(PCode(is_real ? PCode::Type::kCompareGreaterEqualReal : PCode::Type::kCompareGreaterEqualInteger, ir_indent_));
             break;
         case Token::Type::kEqual:
-            ir_.add(PCode(PCode::Type::kCompareEqual, ir_indent_));
+            ir_.add(PCode(is_real ? PCode::Type::kCompareEqualReal : PCode::Type::kCompareEqualInteger, ir_indent_));
             break;
         case Token::Type::kNotEqual:
-            ir_.add(PCode(PCode::Type::kCompareNotEqual, ir_indent_));
+            ir_.add(PCode(is_real ? PCode::Type::kCompareNotEqualReal : PCode::Type::kCompareNotEqualInteger, ir_indent_));
             break;
         default:
             throw std::invalid_argument("build_condition_ir failed, not expected.");
     }
 }
 
+// 块的嵌套层次即当前作用域的层次, 需在块的作用域打开时调用
+void Semantic::build_enter_scope_ir() {
+    ir_.add(PCode(PCode::Type::kEnterScope, std::to_string(tree_.current()->level()), ir_indent_));
+}
+
+void Semantic::build_leave_scope_ir() {
+    ir_.add(PCode(PCode::Type::kLeaveScope, std::to_string(tree_.current()->level()), ir_indent_));
+}
+
 void Semantic::build_while_statement_ir_begin(const std::string &signature) {
     ir_.add(PCode(PCode::Type::kLabel, "_begin_while" + signature, ir_indent_));
 }
 
 void Semantic::build_while_statement_ir_jz(const std::string &signature) {
     ir_.add(PCode(PCode::Type::kJumpZero, "_end_while" + signature, ir_indent_));
+    build_enter_scope_ir();
 }
 
 void Semantic::build_while_statement_ir_end(const std::string &signature) {
+    build_leave_scope_ir();
     ir_.add(PCode(PCode::Type::kJump, "_begin_while" + signature, ir_indent_));
     ir_.add(PCode(PCode::Type::kLabel, "_end_while" + signature, ir_indent_));
 }
@@ -862,9 +911,11 @@ void Semantic::build_if_statement_ir_begin(const std::string &signature) {
 
 void Semantic::build_if_statement_ir_jz(const std::string &signature) {
     ir_.add(PCode(PCode::Type::kJumpZero, "_else" + signature, ir_indent_));
+    build_enter_scope_ir();
 }
 
 void Semantic::build_if_statement_ir_else(const std::string &signature) {
+    build_leave_scope_ir();
     ir_.add(PCode(PCode::Type::kJump, "_end_if" + signature, ir_indent_));
     ir_.add(PCode(PCode::Type::kLabel, "_else" + signature, ir_indent_));
 }
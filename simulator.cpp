@@ -0,0 +1,519 @@
+#include "include/simulator.h"
+
+void Simulator::start_func(const PCode &code) {
+    set_eip(code.target() + 1);
+}
+
+void Simulator::arg_integer(const PCode &code) {
+    Value back = stack_.back();
+    stack_.pop_back();
+    Symbol &symbol = resolve(code.first_address());
+    release_array(symbol);
+
+    if (back.type() == Value::Type::kInt) {
+        symbol = Symbol(code.first(), (int)back.int_value(), true);
+    } else if (back.type() == Value::Type::kReal) {
+        symbol = Symbol(code.first(), (int)back.real_value(), true);
+    } else {
+        throw simulator_error(line(), "不支持的函数调用实参类型");
+    }
+
+    inc_eip();
+}
+
+void Simulator::arg_real(const PCode &code) {
+    Value back = stack_.back();
+    stack_.pop_back();
+    Symbol &symbol = resolve(code.first_address());
+    release_array(symbol);
+
+    if (back.type() == Value::Type::kInt) {
+        symbol = Symbol(code.first(), (double)back.int_value(), true);
+    } else if (back.type() == Value::Type::kReal) {
+        symbol = Symbol(code.first(), (double)back.real_value(), true);
+    } else {
+        throw simulator_error(line(), "不支持的函数调用实参类型");
+    }
+
+    inc_eip();
+}
+
+void Simulator::call(const PCode &code) {
+    const LinkedFunction &function = functions_[code.target()];
+    // 新帧紧接在调用者的槽位之后, 槽位由 VAR 和 ARG 指令初始化, 因此无需清空
+    int base = frames_.empty() ? 0 : frames_.back().base + frames_.back().size;
+    if (slots_.size() < (unsigned long)(base + function.frame_size())) {
+        slots_.resize(std::max(slots_.size() * 2, (unsigned long)(base + function.frame_size())));
+    }
+    if (call_graph_.is_enabled()) {
+        call_graph_.enter(code.target());
+    }
+    frames_.push_back(Frame{eip() + 1, base, function.frame_size()});
+    locals_ = slots_.data() + base;
+    set_eip(function.start() + 1);
+    consume_fuel(function.end() - function.start());
+}
+
+// 尾调用复用当前函数的活动记录: 返回地址不变, 被调用函数返回时直接回到当前函数的调用者
+// 实参已位于操作数栈中, 由被调用函数的 ARG 指令写入复用的槽位, 因此尾递归只占用固定的栈空间
+void Simulator::tail_call(const PCode &code) {
+    if (frames_.empty()) {
+        call(code);
+        return;
+    }
+    const LinkedFunction &function = functions_[code.target()];
+    Frame &frame = frames_.back();
+    if (slots_.size() < (unsigned long)(frame.base + function.frame_size())) {
+        slots_.resize(std::max(slots_.size() * 2, (unsigned long)(frame.base + function.frame_size())));
+        locals_ = slots_.data() + frame.base;
+    }
+    release_frame(frame.base, frame.size);
+    frame.size = function.frame_size();
+    if (call_graph_.is_enabled()) {
+        call_graph_.leave();
+        call_graph_.enter(code.target());
+    }
+    set_eip(function.start() + 1);
+    consume_fuel(function.end() - function.start());
+}
+
+void Simulator::return_function(const PCode &code) {
+    leave_frame();
+}
+
+void Simulator::end_func(const PCode &code) {
+    // 按 ENDFUNC 记录的返回类型返回 0
+    if (code.second() == "real") {
+        stack_.push_back(Value(0.0));
+    } else {
+        stack_.push_back(Value(0));
+    }
+    leave_frame();
+}
+
+void Simulator::var_integer(const PCode &code) {
+    Symbol &symbol = resolve(code.first_address());
+    release_array(symbol);
+    symbol = Symbol(code.first(), 0, false);
+    inc_eip();
+}
+
+void Simulator::var_integer_array(const PCode &code) {
+    Symbol &symbol = resolve(code.first_address());
+    unsigned long size = (unsigned long)get_second_parameter(code);
+    release_array(symbol);
+    symbol = Symbol();
+    charge_array(size * sizeof(int));
+    symbol = Symbol(code.first(), std::vector<int>(size, 0), true);
+    inc_eip();
+}
+
+void Simulator::var_real(const PCode &code) {
+    Symbol &symbol = resolve(code.first_address());
+    release_array(symbol);
+    symbol = Symbol(code.first(), 0.0, false);
+    inc_eip();
+}
+
+void Simulator::var_real_array(const PCode &code) {
+    Symbol &symbol = resolve(code.first_address());
+    unsigned long size = (unsigned long)get_second_parameter(code);
+    release_array(symbol);
+    symbol = Symbol();
+    charge_array(size * sizeof(double));
+    symbol = Symbol(code.first(), std::vector<double>(size, 0.0), true);
+    inc_eip();
+}
+
+void Simulator::push_integer(const PCode &code) {
+    const Symbol &symbol = value_of(code.first_address());
+    if (symbol.is_assigned()) {
+        stack_.push_back(Value(symbol.int_value()));
+    } else {
+        throw simulator_error(line(), "变量 \"" + code.first() + "\" 未初始化而直接使用");
+    }
+    inc_eip();
+}
+
+void Simulator::push_integer_array(const PCode &code) {
+    stack_.push_back(Value(int_element(resolve(code.first_address()), code)));
+    inc_eip();
+}
+
+void Simulator::push_real(const PCode &code) {
+    const Symbol &symbol = value_of(code.first_address());
+    stack_.push_back(Value(symbol.real_value()));
+    inc_eip();
+}
+
+void Simulator::push_real_array(const PCode &code) {
+    stack_.push_back(Value(real_element(resolve(code.first_address()), code)));
+    inc_eip();
+}
+
+void Simulator::pop(const PCode &code) {
+    stack_.pop_back();
+    inc_eip();
+}
+
+void Simulator::pop_integer(const PCode &code) {
+    Symbol &symbol = resolve(code.first_address());
+    symbol.set_value(stack_.back().int_value());
+    stack_.pop_back();
+    inc_eip();
+}
+
+void Simulator::pop_real(const PCode &code) {
+    Symbol &symbol = resolve(code.first_address());
+    symbol.set_value(stack_.back().real_value());
+    stack_.pop_back();
+    inc_eip();
+}
+
+void Simulator::pop_array(const PCode &code) {
+    Value back = stack_.back();
+    stack_.pop_back();
+    Symbol &symbol = resolve(code.first_address());
+
+    if (symbol.type() == Symbol::Type::kIntArray) {
+        if (back.type() == Value::Type::kInt) {
+            int_element(symbol, code) = (int) back.int_value();
+        } else if (back.type() == Value::Type::kReal) {
+            int_element(symbol, code) = (int) back.real_value();
+        } else {
+            throw simulator_error(line(), "无法取出栈顶元素");
+        }
+    } else if (symbol.type() == Symbol::Type::kRealArray) {
+        if (back.type() == Value::Type::kInt) {
+            real_element(symbol, code) = (double) back.int_value();
+        } else if (back.type() == Value::Type::kReal) {
+            real_element(symbol, code) = (double) back.real_value();
+        } else {
+            throw simulator_error(line(), "无法取出栈顶元素");
+        }
+    } else {
+        throw simulator_error(line(), "错误的目标类型");
+    }
+
+    symbol.set_assigned();
+
+    inc_eip();
+}
+
+void Simulator::add_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    int left = stack_.back().int_value();
+    stack_.back() = Value((int)((unsigned)left + (unsigned)right));
+    inc_eip();
+}
+
+void Simulator::add_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    double left = stack_.back().real_value();
+    stack_.back() = Value(left + right);
+    inc_eip();
+}
+
+void Simulator::sub_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    int left = stack_.back().int_value();
+    stack_.back() = Value((int)((unsigned)left - (unsigned)right));
+    inc_eip();
+}
+
+void Simulator::sub_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    double left = stack_.back().real_value();
+    stack_.back() = Value(left - right);
+    inc_eip();
+}
+
+void Simulator::mul_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    int left = stack_.back().int_value();
+    stack_.back() = Value((int)((unsigned)left * (unsigned)right));
+    inc_eip();
+}
+
+void Simulator::mul_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    double left = stack_.back().real_value();
+    stack_.back() = Value(left * right);
+    inc_eip();
+}
+
+void Simulator::div_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    int left = stack_.back().int_value();
+    if (right == 0) {
+        throw simulator_error(line(), "除数不能为 0");
+    }
+    stack_.back() = Value(right == -1 ? (int)(0u - (unsigned)left) : left / right);
+    inc_eip();
+}
+
+void Simulator::div_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    double left = stack_.back().real_value();
+    if (std::fabs(right) < 1e-8) {
+        throw simulator_error(line(), "除数不能为 0");
+    }
+    stack_.back() = Value(left / right);
+    inc_eip();
+}
+
+void Simulator::compare_equal_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().int_value() == right));
+    inc_eip();
+}
+
+void Simulator::compare_equal_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().real_value() == right));
+    inc_eip();
+}
+
+void Simulator::compare_not_equal_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().int_value() != right));
+    inc_eip();
+}
+
+void Simulator::compare_not_equal_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().real_value() != right));
+    inc_eip();
+}
+
+void Simulator::compare_greater_than_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().int_value() > right));
+    inc_eip();
+}
+
+void Simulator::compare_greater_than_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().real_value() > right));
+    inc_eip();
+}
+
+void Simulator::compare_less_than_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().int_value() < right));
+    inc_eip();
+}
+
+void Simulator::compare_less_than_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().real_value() < right));
+    inc_eip();
+}
+
+void Simulator::compare_greater_equal_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().int_value() >= right));
+    inc_eip();
+}
+
+void Simulator::compare_greater_equal_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().real_value() >= right));
+    inc_eip();
+}
+
+void Simulator::compare_less_equal_integer(const PCode &code) {
+    int right = stack_.back().int_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().int_value() <= right));
+    inc_eip();
+}
+
+void Simulator::compare_less_equal_real(const PCode &code) {
+    double right = stack_.back().real_value();
+    stack_.pop_back();
+    stack_.back() = Value((int)(stack_.back().real_value() <= right));
+    inc_eip();
+}
+
+void Simulator::integer_to_real(const PCode &code) {
+    stack_.back() = Value((double)stack_.back().int_value());
+    inc_eip();
+}
+
+void Simulator::jump(const PCode &code) {
+    int pos = eip();
+    set_eip(code.target());
+    // 循环由末尾向后跳转至开头, 其余跳转都向前
+    if (code.target() < pos) {
+        consume_fuel(pos - code.target());
+    }
+}
+
+void Simulator::jump_zero(const PCode &code) {
+    Value symbol = stack_.back();
+    stack_.pop_back();
+    if (symbol.int_value() == 0) {
+        set_eip(code.target());
+    } else {
+        inc_eip();
+    }
+}
+
+void Simulator::jump_not_zero(const PCode &code) {
+    Value symbol = stack_.back();
+    stack_.pop_back();
+    if (symbol.int_value() != 0) {
+        set_eip(code.target());
+    } else {
+        inc_eip();
+    }
+}
+
+void Simulator::print(const PCode &code) {
+    Value symbol = stack_.back();
+    stack_.pop_back();
+
+    if (symbol.type() == Value::Type::kInt) {
+        output_.write(symbol.int_value());
+    } else if (symbol.type() == Value::Type::kReal) {
+        output_.write(symbol.real_value());
+    } else {
+        throw simulator_error(line(), "不合法的输出参数");
+    }
+
+    inc_eip();
+}
+
+void Simulator::read_int(const PCode &code) {
+    if (pause_if_requested()) {
+        return;
+    }
+    int input = input_.read_integer(line());
+    Symbol &symbol = resolve(code.first_address());
+    symbol.set_value(input);
+    symbol.set_assigned();
+
+    inc_eip();
+}
+
+void Simulator::read_int_array(const PCode &code) {
+    if (pause_if_requested()) {
+        return;
+    }
+    Symbol &symbol = resolve(code.first_address());
+    int input = input_.read_integer(line());
+    int_element(symbol, code) = input;
+    symbol.set_assigned();
+
+    inc_eip();
+}
+
+void Simulator::read_real(const PCode &code) {
+    if (pause_if_requested()) {
+        return;
+    }
+    double input = input_.read_real(line());
+    Symbol &symbol = resolve(code.first_address());
+    symbol.set_value(input);
+    symbol.set_assigned();
+
+    inc_eip();
+}
+
+void Simulator::read_real_array(const PCode &code) {
+    if (pause_if_requested()) {
+        return;
+    }
+    Symbol &symbol = resolve(code.first_address());
+    double input = input_.read_real(line());
+    real_element(symbol, code) = input;
+    symbol.set_assigned();
+
+    inc_eip();
+}
+
+void Simulator::exit_program(const PCode &code) {
+    inc_eip();
+}
+
+void Simulator::increment_integer(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    resolve(code.first_address()).set_value((int)((unsigned)left + (unsigned)right));
+    set_eip(eip() + 4);
+}
+
+void Simulator::decrement_integer(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    resolve(code.first_address()).set_value((int)((unsigned)left - (unsigned)right));
+    set_eip(eip() + 4);
+}
+
+void Simulator::move_integer(const PCode &code) {
+    int value = assigned_integer(code.second_address(), code.second(), eip());
+    resolve(code.first_address()).set_value(value);
+    set_eip(eip() + 2);
+}
+
+void Simulator::move_real(const PCode &code) {
+    double value = value_of(code.second_address()).real_value();
+    resolve(code.first_address()).set_value(value);
+    set_eip(eip() + 2);
+}
+
+// 比较结果为假时跳转, 否则越过 pushi b; cmp<op>i; jz L
+void Simulator::compare_equal_jump_zero(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    set_eip(left == right ? eip() + 4 : code.target());
+}
+
+void Simulator::compare_not_equal_jump_zero(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    set_eip(left != right ? eip() + 4 : code.target());
+}
+
+void Simulator::compare_greater_than_jump_zero(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    set_eip(left > right ? eip() + 4 : code.target());
+}
+
+void Simulator::compare_less_than_jump_zero(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    set_eip(left < right ? eip() + 4 : code.target());
+}
+
+void Simulator::compare_greater_equal_jump_zero(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    set_eip(left >= right ? eip() + 4 : code.target());
+}
+
+void Simulator::compare_less_equal_jump_zero(const PCode &code) {
+    int left = assigned_integer(code.first_address(), code.first(), eip());
+    int right = assigned_integer(code.second_address(), code.second(), eip() + 1);
+    set_eip(left <= right ? eip() + 4 : code.target());
+}